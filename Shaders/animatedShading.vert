@@ -0,0 +1,59 @@
+//#version 130
+#version 400
+
+//The vertex shader operates on each vertex
+
+//input data from the instance VBO, see AnimatedSpriteBatch. Every vertex of
+//a sprite reads the same values.
+layout(location = 0) in vec4 instanceDestRect;
+layout(location = 1) in vec4 instanceColor;
+//The angle, the start time and the frames per second
+layout(location = 2) in vec3 instanceTiming;
+//The tiles across and down the sheet, the start frame and the frame count
+layout(location = 3) in uvec4 instanceFrames;
+
+out vec2 fragmentPosition;
+out vec4 fragmentColor;
+out vec2 fragmentUV;
+
+//Per frame data from FrameUniforms, shared by every program
+layout(std140) uniform FrameUniforms {
+    mat4 viewProjection;
+    vec4 viewport; //x, y, width and height in pixels
+    float time;
+} frame;
+
+//Where each of the 6 vertices sits on the quad, in the same order as SpriteBatch
+const vec2 corners[6] = vec2[](vec2(0.0, 1.0), vec2(0.0, 0.0), vec2(1.0, 0.0),
+                               vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+
+void main() {
+    vec2 corner = corners[gl_VertexID];
+
+    //Rotate the corner about the center of the sprite
+    vec2 halfDims = instanceDestRect.zw * 0.5;
+    vec2 offset = (corner - 0.5) * instanceDestRect.zw;
+    float c = cos(instanceTiming.x);
+    float s = sin(instanceTiming.x);
+    vec2 position = instanceDestRect.xy + halfDims + vec2(offset.x * c - offset.y * s, offset.x * s + offset.y * c);
+
+    //Set the x,y position on the screen
+    gl_Position.xy = (frame.viewProjection * vec4(position, 0.0, 1.0)).xy;
+    //the z position is zero since we are in 2D
+    gl_Position.z = 0.0;
+    
+    //Indicate that the coordinates are normalized
+    gl_Position.w = 1.0;
+    
+    fragmentPosition = position;
+    
+    fragmentColor = instanceColor;
+
+    //Pick the current frame and find its tile, like TileSheet::getUVs
+    float elapsed = max(frame.time - instanceTiming.y, 0.0);
+    uint tileIndex = instanceFrames.z + uint(elapsed * instanceTiming.z) % instanceFrames.w;
+    vec2 tile = vec2(tileIndex % instanceFrames.x, tileIndex / instanceFrames.x);
+    vec2 uv = (tile + corner) / vec2(instanceFrames.xy);
+    
+    fragmentUV = vec2(uv.x, 1.0 - uv.y);
+}
\ No newline at end of file
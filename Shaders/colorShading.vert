@@ -12,11 +12,16 @@ out vec2 fragmentPosition;
 out vec4 fragmentColor;
 out vec2 fragmentUV;
 
-uniform mat4 P;
+//Per frame data from FrameUniforms, shared by every program
+layout(std140) uniform FrameUniforms {
+    mat4 viewProjection;
+    vec4 viewport; //x, y, width and height in pixels
+    float time;
+} frame;
 
 void main() {
     //Set the x,y position on the screen
-    gl_Position.xy = (P * vec4(vertexPosition, 0.0, 1.0)).xy;
+    gl_Position.xy = (frame.viewProjection * vec4(vertexPosition, 0.0, 1.0)).xy;
     //the z position is zero since we are in 2D
     gl_Position.z = 0.0;
     
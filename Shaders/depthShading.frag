@@ -0,0 +1,28 @@
+//#version 130
+#version 400
+
+//The fragment shader operates on each pixel in a given polygon
+
+in vec2 fragmentPosition;
+in vec4 fragmentColor;
+in vec2 fragmentUV;
+
+//This is the 3 component float vector that gets outputted to the screen
+//for each pixel.
+out vec4 color;
+
+uniform sampler2D mySampler;
+//Pixels below this alpha are dropped, so they don't write depth. SpriteBatch
+//sets it for each pass.
+uniform float alphaCutoff;
+
+void main() {
+
+    vec4 textureColor = texture(mySampler, fragmentUV);
+    
+    color = fragmentColor * textureColor;
+
+    if (color.a < alphaCutoff) {
+        discard;
+    }
+}
\ No newline at end of file
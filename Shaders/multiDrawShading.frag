@@ -0,0 +1,24 @@
+//#version 130
+#version 400
+
+//The fragment shader operates on each pixel in a given polygon
+
+in vec2 fragmentPosition;
+in vec4 fragmentColor;
+in vec2 fragmentUV;
+flat in int fragmentDrawUnit;
+
+//This is the 3 component float vector that gets outputted to the screen
+//for each pixel.
+out vec4 color;
+
+//One sampler per texture unit, must match SpriteBatch::MULTI_DRAW_TEXTURE_UNITS
+uniform sampler2D mySamplers[16];
+
+void main() {
+    
+    //The unit is the same for the whole draw command
+    vec4 textureColor = texture(mySamplers[fragmentDrawUnit], fragmentUV);
+    
+    color = fragmentColor * textureColor;
+}
\ No newline at end of file
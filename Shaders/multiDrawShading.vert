@@ -0,0 +1,41 @@
+//#version 130
+#version 400
+
+//The vertex shader operates on each vertex
+
+//input data from the VBO. Each vertex is 2 floats
+in vec2 vertexPosition;
+in vec4 vertexColor;
+in vec2 vertexUV;
+//The texture unit of the current draw command, set up by SpriteBatch
+layout(location = 4) in int vertexDrawUnit;
+
+out vec2 fragmentPosition;
+out vec4 fragmentColor;
+out vec2 fragmentUV;
+flat out int fragmentDrawUnit;
+
+//Per frame data from FrameUniforms, shared by every program
+layout(std140) uniform FrameUniforms {
+    mat4 viewProjection;
+    vec4 viewport; //x, y, width and height in pixels
+    float time;
+} frame;
+
+void main() {
+    //Set the x,y position on the screen
+    gl_Position.xy = (frame.viewProjection * vec4(vertexPosition, 0.0, 1.0)).xy;
+    //the z position is zero since we are in 2D
+    gl_Position.z = 0.0;
+    
+    //Indicate that the coordinates are normalized
+    gl_Position.w = 1.0;
+    
+    fragmentPosition = vertexPosition;
+    
+    fragmentColor = vertexColor;
+    
+    fragmentUV = vec2(vertexUV.x, 1.0 - vertexUV.y);
+
+    fragmentDrawUnit = vertexDrawUnit;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+//#version 130
+#version 400
+
+//The vertex shader operates on each vertex
+
+//input data from the VBO. The position is 2 half floats relative to batchOrigin,
+//the UV is 2 normalized shorts
+in vec2 vertexPosition;
+in vec4 vertexColor;
+in vec2 vertexUV;
+
+out vec2 fragmentPosition;
+out vec4 fragmentColor;
+out vec2 fragmentUV;
+
+//Per frame data from FrameUniforms, shared by every program
+layout(std140) uniform FrameUniforms {
+    mat4 viewProjection;
+    vec4 viewport; //x, y, width and height in pixels
+    float time;
+} frame;
+//Set by SpriteBatch::renderBatch
+uniform vec2 batchOrigin;
+
+void main() {
+    vec2 worldPosition = batchOrigin + vertexPosition;
+
+    //Set the x,y position on the screen
+    gl_Position.xy = (frame.viewProjection * vec4(worldPosition, 0.0, 1.0)).xy;
+    //the z position is zero since we are in 2D
+    gl_Position.z = 0.0;
+    
+    //Indicate that the coordinates are normalized
+    gl_Position.w = 1.0;
+    
+    fragmentPosition = worldPosition;
+    
+    fragmentColor = vertexColor;
+    
+    fragmentUV = vec2(vertexUV.x, 1.0 - vertexUV.y);
+}
\ No newline at end of file
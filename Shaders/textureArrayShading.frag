@@ -0,0 +1,23 @@
+//#version 130
+#version 400
+
+//The fragment shader operates on each pixel in a given polygon
+
+in vec2 fragmentPosition;
+in vec4 fragmentColor;
+in vec2 fragmentUV;
+flat in float fragmentLayer;
+
+//This is the 3 component float vector that gets outputted to the screen
+//for each pixel.
+out vec4 color;
+
+//All the textures of one size live in the layers of this array
+uniform sampler2DArray mySampler;
+
+void main() {
+    
+    vec4 textureColor = texture(mySampler, vec3(fragmentUV, fragmentLayer));
+    
+    color = fragmentColor * textureColor;
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+// Compares the ways of adding rotated glyphs to a SpriteBatch.
+// Only the CPU side is measured, so no window or GL context is needed.
+//
+// Usage: glyph_bench [numGlyphs] [numRuns]
+
+#include <Bengine/SpriteBatch.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+
+    // What the rotated Glyph constructor used to do: every corner calls
+    // cos and sin twice, 16 transcendental calls per glyph
+    glm::vec2 legacyRotatePoint(const glm::vec2& pos, float angle) {
+        glm::vec2 newv;
+        newv.x = pos.x * cos(angle) - pos.y * sin(angle);
+        newv.y = pos.x * sin(angle) + pos.y * cos(angle);
+        return newv;
+    }
+
+    Bengine::Position toPosition(const glm::vec4& destRect, const glm::vec2& p) {
+        Bengine::Position position;
+        position.x = destRect.x + p.x;
+        position.y = destRect.y + p.y;
+        return position;
+    }
+
+    Bengine::Glyph legacyGlyph(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth,
+                               const Bengine::ColorRGBA8& color, float angle) {
+        glm::vec2 halfDims(destRect.z / 2.0f, destRect.w / 2.0f);
+        glm::vec2 tl = legacyRotatePoint(glm::vec2(-halfDims.x, halfDims.y), angle) + halfDims;
+        glm::vec2 bl = legacyRotatePoint(glm::vec2(-halfDims.x, -halfDims.y), angle) + halfDims;
+        glm::vec2 br = legacyRotatePoint(glm::vec2(halfDims.x, -halfDims.y), angle) + halfDims;
+        glm::vec2 tr = legacyRotatePoint(glm::vec2(halfDims.x, halfDims.y), angle) + halfDims;
+        return Bengine::Glyph(toPosition(destRect, tl), toPosition(destRect, bl), toPosition(destRect, br),
+                              toPosition(destRect, tr), uvRect, texture, depth, color);
+    }
+
+    // Runs body numRuns times and returns the fastest run in milliseconds
+    double timeBest(int numRuns, const std::function<void()>& body) {
+        double best = 1e30;
+        for (int i = 0; i < numRuns; i++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            body();
+            auto end = std::chrono::high_resolution_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            if (ms < best) best = ms;
+        }
+        return best;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    int numGlyphs = (argc > 1) ? std::atoi(argv[1]) : 100000;
+    int numRuns = (argc > 2) ? std::atoi(argv[2]) : 20;
+
+    std::mt19937 randomEngine(1234);
+    std::uniform_real_distribution<float> posDist(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> sizeDist(4.0f, 64.0f);
+    std::uniform_real_distribution<float> angleDist(-3.14159265f, 3.14159265f);
+
+    std::vector<glm::vec4> destRects(numGlyphs);
+    std::vector<float> angles(numGlyphs);
+    std::vector<glm::vec2> dirs(numGlyphs);
+    for (int i = 0; i < numGlyphs; i++) {
+        destRects[i] = glm::vec4(posDist(randomEngine), posDist(randomEngine), sizeDist(randomEngine), sizeDist(randomEngine));
+        angles[i] = angleDist(randomEngine);
+        dirs[i] = glm::vec2(cos(angles[i]), sin(angles[i]));
+    }
+
+    const glm::vec4 uvRect(0.0f, 0.0f, 1.0f, 1.0f);
+    const Bengine::ColorRGBA8 color(255, 255, 255, 255);
+    const GLuint texture = 1;
+
+    Bengine::SpriteBatch spriteBatch;
+    std::vector<Bengine::Glyph> legacyGlyphs;
+    legacyGlyphs.reserve(numGlyphs);
+
+    struct Result {
+        const char* name;
+        double ms;
+    };
+    std::vector<Result> results;
+
+    results.push_back({ "legacy Glyph (16 trig)", timeBest(numRuns, [&]() {
+        legacyGlyphs.clear();
+        for (int i = 0; i < numGlyphs; i++) {
+            legacyGlyphs.push_back(legacyGlyph(destRects[i], uvRect, texture, 0.0f, color, angles[i]));
+        }
+    }) });
+
+    results.push_back({ "draw(angle)", timeBest(numRuns, [&]() {
+        spriteBatch.begin();
+        for (int i = 0; i < numGlyphs; i++) {
+            spriteBatch.draw(destRects[i], uvRect, texture, 0.0f, color, angles[i]);
+        }
+    }) });
+
+    results.push_back({ "draw(dir)", timeBest(numRuns, [&]() {
+        spriteBatch.begin();
+        for (int i = 0; i < numGlyphs; i++) {
+            spriteBatch.draw(destRects[i], uvRect, texture, 0.0f, color, dirs[i]);
+        }
+    }) });
+
+    results.push_back({ "drawRotated(angles)", timeBest(numRuns, [&]() {
+        spriteBatch.begin();
+        spriteBatch.drawRotated(destRects.data(), angles.data(), numGlyphs, uvRect, texture, 0.0f, color);
+    }) });
+
+    results.push_back({ "drawRotated(dirs)", timeBest(numRuns, [&]() {
+        spriteBatch.begin();
+        spriteBatch.drawRotated(destRects.data(), dirs.data(), numGlyphs, uvRect, texture, 0.0f, color);
+    }) });
+
+    std::printf("%d glyphs, best of %d runs\n", numGlyphs, numRuns);
+    for (auto& r : results) {
+        std::printf("%-26s %10.3f ms %10.2f ns/glyph %8.2fx\n", r.name, r.ms,
+                    r.ms * 1e6 / numGlyphs, results[0].ms / r.ms);
+    }
+
+    return 0;
+}
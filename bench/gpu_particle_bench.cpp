@@ -0,0 +1,158 @@
+// Spawns the same particles into a ParticleBatch2D on the CPU and a
+// GPUParticleBatch2D, which makes them in its spawn shader, runs both with the
+// same modules, times the spawns and updates, and reads the GPU particles back
+// to check them against the CPU ones. Positions, velocities, life and width
+// have to agree to TOLERANCE of their size, which leaves room for the GPU
+// rounding floats differently, and colors to COLOR_TOLERANCE. The exit code
+// is 1 if they don't.
+//
+// Usage: gpu_particle_bench [numParticles] [numFrames]
+//
+// Must be run from the repository root. Runs without a display with
+// SDL_VIDEODRIVER=offscreen, and without a GPU with LIBGL_ALWAYS_SOFTWARE=1.
+
+#include <Bengine/Bengine.h>
+#include <Bengine/FrameUniforms.h>
+#include <Bengine/GPUParticleBatch2D.h>
+#include <Bengine/ParticleBatch2D.h>
+#include <Bengine/ParticleEmitter2D.h>
+#include <Bengine/ParticleModules.h>
+#include <Bengine/Window.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+    const int SCREEN_WIDTH = 256;
+    const int SCREEN_HEIGHT = 256;
+
+    const float DELTA_TIME = 1.0f / 60.0f;
+    // Slow enough that every particle outlives the frames
+    const float DECAY_RATE = 0.01f;
+    const glm::vec2 GRAVITY(0.0f, -98.0f);
+    const float DRAG = 0.5f;
+    const float TURBULENCE_STRENGTH = 50.0f;
+    const float TURBULENCE_FREQUENCY = 0.05f;
+
+    // Spawned before the timing, so the driver has compiled the spawn shader
+    const int NUM_WARMUP_PARTICLES = 4;
+
+    const float TOLERANCE = 1e-3f;
+    // A blend that rounds the other way changes a channel by 1
+    const int COLOR_TOLERANCE = 1;
+
+    double millisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // The difference of a and b relative to their size, with values below 1
+    // compared absolutely
+    float relativeError(float a, float b) {
+        return std::fabs(a - b) / std::max(std::max(std::fabs(a), std::fabs(b)), 1.0f);
+    }
+
+    int colorError(const Bengine::ColorRGBA8& a, const Bengine::ColorRGBA8& b) {
+        return std::max(std::max(std::abs(a.r - b.r), std::abs(a.g - b.g)),
+                        std::max(std::abs(a.b - b.b), std::abs(a.a - b.a)));
+    }
+
+    // Bursts count particles into batch from a circle, a cone and a box, with
+    // the same seed whichever batch it is
+    void spawnParticles(Bengine::IParticleBatch2D* batch, int count) {
+        Bengine::ParticleEmitter2D emitter;
+        emitter.init(batch);
+        emitter.setSeed(1);
+        emitter.setSpeed(10.0f, 200.0f);
+        emitter.setWidth(2.0f, 6.0f);
+        emitter.setColor(Bengine::ColorRGBA8(255, 200, 50, 255), Bengine::ColorRGBA8(40, 40, 120, 128));
+        emitter.setCircle(500.0f);
+        emitter.burst(count / 2);
+        emitter.setDirection(1.0f, 0.8f);
+        emitter.setCone(300.0f);
+        emitter.burst(count / 4);
+        emitter.setBox(glm::vec2(800.0f, 200.0f));
+        emitter.burst(count - count / 2 - count / 4);
+    }
+
+}
+
+int main(int argc, char** argv) {
+    int numParticles = (argc > 1) ? std::atoi(argv[1]) : 100000;
+    int numFrames = (argc > 2) ? std::atoi(argv[2]) : 100;
+
+    Bengine::init();
+    Bengine::Window window;
+    window.create("gpu_particle_bench", SCREEN_WIDTH, SCREEN_HEIGHT, Bengine::HEADLESS);
+
+    Bengine::GLTexture texture = {};
+    Bengine::ParticleBatch2D cpuBatch;
+    cpuBatch.init(numParticles + NUM_WARMUP_PARTICLES, DECAY_RATE, texture);
+    cpuBatch.setModules(Bengine::makeParticleModules(Bengine::GravityModule(GRAVITY), Bengine::DragModule(DRAG),
+                                                     Bengine::TurbulenceModule(TURBULENCE_STRENGTH, TURBULENCE_FREQUENCY)));
+    Bengine::GPUParticleBatch2D gpuBatch;
+    gpuBatch.init(numParticles + NUM_WARMUP_PARTICLES, DECAY_RATE, texture);
+    gpuBatch.setModule(Bengine::GravityModule(GRAVITY));
+    gpuBatch.setModule(Bengine::DragModule(DRAG));
+    gpuBatch.setModule(Bengine::TurbulenceModule(TURBULENCE_STRENGTH, TURBULENCE_FREQUENCY));
+
+    // The CPU batch gets the particles through addParticles(), the GPU batch
+    // only gets the emitter's settings
+    spawnParticles(&cpuBatch, NUM_WARMUP_PARTICLES);
+    spawnParticles(&gpuBatch, NUM_WARMUP_PARTICLES);
+    glFinish();
+    auto start = std::chrono::high_resolution_clock::now();
+    spawnParticles(&cpuBatch, numParticles);
+    double cpuSpawnMs = millisecondsSince(start);
+    start = std::chrono::high_resolution_clock::now();
+    spawnParticles(&gpuBatch, numParticles);
+    glFinish();
+    double gpuSpawnMs = millisecondsSince(start);
+
+    double cpuMs = 0.0;
+    double gpuMs = 0.0;
+    for (int frame = 0; frame < numFrames; frame++) {
+        start = std::chrono::high_resolution_clock::now();
+        cpuBatch.update(DELTA_TIME);
+        cpuMs += millisecondsSince(start);
+
+        start = std::chrono::high_resolution_clock::now();
+        gpuBatch.update(DELTA_TIME);
+        glFinish();
+        gpuMs += millisecondsSince(start);
+    }
+
+    // Nothing died, so both still hold the particles in the order they were added
+    std::vector<Bengine::Particle2D> gpuParticles;
+    gpuBatch.readParticles(gpuParticles);
+    const Bengine::ParticlePool2D& cpuParticles = cpuBatch.getParticles();
+    bool sameCount = gpuParticles.size() == cpuParticles.getNumAlive();
+    float maxError = 0.0f;
+    int maxColorError = 0;
+    for (size_t i = 0; sameCount && i < gpuParticles.size(); i++) {
+        const Bengine::Particle2D& p = gpuParticles[i];
+        maxError = std::max(maxError, relativeError(p.position.x, cpuParticles.x[i]));
+        maxError = std::max(maxError, relativeError(p.position.y, cpuParticles.y[i]));
+        maxError = std::max(maxError, relativeError(p.velocity.x, cpuParticles.vx[i]));
+        maxError = std::max(maxError, relativeError(p.velocity.y, cpuParticles.vy[i]));
+        maxError = std::max(maxError, relativeError(p.life, cpuParticles.life[i]));
+        maxError = std::max(maxError, relativeError(p.width, cpuParticles.width[i]));
+        maxColorError = std::max(maxColorError, colorError(p.color, cpuParticles.color[i]));
+    }
+    bool passed = sameCount && maxError <= TOLERANCE && maxColorError <= COLOR_TOLERANCE;
+
+    std::printf("%d particles, %d frames\n", numParticles, numFrames);
+    std::printf("cpu spawn  %10.3f ms\n", cpuSpawnMs);
+    std::printf("gpu spawn  %10.3f ms, with glFinish\n", gpuSpawnMs);
+    std::printf("cpu update %10.3f ms/frame\n", cpuMs / numFrames);
+    std::printf("gpu update %10.3f ms/frame, with glFinish\n", gpuMs / numFrames);
+    std::printf("gpu vs cpu: %zu vs %zu particles, largest relative error %g, largest color error %d, %s\n",
+                gpuParticles.size(), cpuParticles.getNumAlive(), maxError, maxColorError, passed ? "match" : "DIFFER");
+
+    gpuBatch.dispose();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,455 @@
+// Compares the ways of updating a ParticleBatch2D: the old array of Particle2D
+// with a std::function call per particle, the callback path of the
+// structure of arrays pool, and the SIMD kernel. Then compares gravity, drag,
+// color over life and size over life written as a callback and as
+// ParticleModules. Last, updates the effect split over several batches of a
+// ParticleEngine2D, on one thread, on a ThreadPool and with a Camera2D that
+// only sees one of the batches, and spawning an explosion one addParticle()
+// at a time against one ParticleEmitter2D burst. Last, checks that a fixed
+// step gives the same particles however the time is cut into frames, and
+// that ParticleEngine2D::skipAhead() gives the same particles as taking the
+// steps one at a time, with and without a camera, and that particles
+// bounce around inside a box baked from a b2World however long the update.
+// The exit code is 1 if not.
+// Only the CPU side is measured, so no window or GL context is needed.
+//
+// Usage: particle_bench [numParticles] [numRuns]
+
+#include <Box2D/Box2D.h>
+#include <Bengine/Camera2D.h>
+#include <Bengine/ParticleBatch2D.h>
+#include <Bengine/ParticleCollisionGrid.h>
+#include <Bengine/ParticleEmitter2D.h>
+#include <Bengine/ParticleEngine2D.h>
+#include <Bengine/ParticleKernels.h>
+#include <Bengine/ParticleModules.h>
+#include <Bengine/ThreadPool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+    const float DELTA_TIME = 1.0f / 60.0f;
+    const float DECAY_RATE = 0.01f;
+
+    const glm::vec2 GRAVITY(0.0f, -98.0f);
+    const float DRAG = 0.5f;
+    const Bengine::ColorRGBA8 START_COLOR(255, 200, 50, 255);
+    const Bengine::ColorRGBA8 END_COLOR(80, 0, 0, 0);
+    const float START_WIDTH = 8.0f;
+    const float END_WIDTH = 1.0f;
+
+    const int NUM_ENGINE_BATCHES = 8;
+    // How far apart the batches of the LOD engine are, so the camera only sees one
+    const float LOD_BATCH_SPACING = 5000.0f;
+
+    const int EXPLOSION_SIZE = 20000;
+
+    // Short lived, so skipAhead() has steps to skip
+    const float REPLAY_DECAY_RATE = 1.0f;
+    const int REPLAY_FRAMES = 240;
+    const int REPLAY_SKIP_STEPS = 600;
+
+    // A hollow box of chain edges, centered on the origin
+    const float COLLISION_BOX_SIZE = 200.0f;
+    const float COLLISION_CELL_SIZE = 2.0f;
+    const int COLLISION_UPDATES = 30;
+
+    // Runs body numRuns times and returns the fastest run in milliseconds
+    double timeBest(int numRuns, const std::function<void()>& body) {
+        double best = 1e30;
+        for (int i = 0; i < numRuns; i++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            body();
+            auto end = std::chrono::high_resolution_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            if (ms < best) best = ms;
+        }
+        return best;
+    }
+
+    // Does what defaultParticleUpdate does, but isn't it, so the batch takes
+    // the callback path
+    void customUpdate(Bengine::Particle2D& particle, float deltaTime) {
+        particle.position += particle.velocity * deltaTime;
+    }
+
+    GLubyte lerpChannel(GLubyte end, GLubyte start, float t) {
+        return (GLubyte)((float)end + ((float)start - (float)end) * t + 0.5f);
+    }
+
+    // The modules of the benchmark as one callback, like games had to write them
+    void effectUpdate(Bengine::Particle2D& particle, float deltaTime) {
+        particle.velocity += GRAVITY * deltaTime;
+        particle.velocity *= std::max(1.0f - DRAG * deltaTime, 0.0f);
+        float t = std::min(std::max(particle.life, 0.0f), 1.0f);
+        particle.color.r = lerpChannel(END_COLOR.r, START_COLOR.r, t);
+        particle.color.g = lerpChannel(END_COLOR.g, START_COLOR.g, t);
+        particle.color.b = lerpChannel(END_COLOR.b, START_COLOR.b, t);
+        particle.color.a = lerpChannel(END_COLOR.a, START_COLOR.a, t);
+        particle.width = END_WIDTH + (START_WIDTH - END_WIDTH) * t;
+        particle.position += particle.velocity * deltaTime;
+    }
+
+    // Sums the positions, so the paths can be checked against each other
+    double checksum(const Bengine::ParticlePool2D& pool) {
+        double sum = 0.0;
+        for (size_t i = 0; i < pool.getNumAlive(); i++) {
+            sum += pool.x[i] + pool.y[i];
+        }
+        return sum;
+    }
+
+    // A fixed step engine with two seeded emitters, the second one far
+    // enough away that a camera on the first doesn't see it
+    struct ReplayScene {
+        Bengine::ParticleEngine2D engine;
+        Bengine::ParticleBatch2D* batches[2];
+        Bengine::ParticleEmitter2D emitters[2];
+
+        explicit ReplayScene(const Bengine::Camera2D* camera) {
+            Bengine::GLTexture texture = {};
+            for (int i = 0; i < 2; i++) {
+                batches[i] = new Bengine::ParticleBatch2D();
+                batches[i]->init(10000, REPLAY_DECAY_RATE, texture);
+                batches[i]->setModules(Bengine::makeParticleModules(Bengine::GravityModule(GRAVITY),
+                                                                    Bengine::TurbulenceModule(50.0f, 0.05f)));
+                engine.addParticleBatch(batches[i]);
+                emitters[i].init(batches[i]);
+                emitters[i].setSeed(100 + i);
+                emitters[i].setPosition(glm::vec2(LOD_BATCH_SPACING * (float)i, 0.0f));
+                emitters[i].setCircle(20.0f);
+                emitters[i].setSpeed(50.0f, 200.0f);
+                emitters[i].setRate(1000.0f);
+                engine.addEmitter(&emitters[i]);
+            }
+            engine.setFixedStep(DELTA_TIME);
+            engine.setCamera(camera);
+        }
+    };
+
+    typedef std::tuple<float, float, float, float, float, float> ParticleFields;
+
+    // The fields of every live particle of the scene, sorted if storage
+    // order doesn't matter
+    std::vector<ParticleFields> replayParticles(const ReplayScene& scene, bool sorted) {
+        std::vector<ParticleFields> fields;
+        for (const Bengine::ParticleBatch2D* batch : scene.batches) {
+            const Bengine::ParticlePool2D& pool = batch->getParticles();
+            for (size_t i = 0; i < pool.getNumAlive(); i++) {
+                fields.emplace_back(pool.x[i], pool.y[i], pool.vx[i], pool.vy[i], pool.life[i], pool.width[i]);
+            }
+        }
+        if (sorted) {
+            std::sort(fields.begin(), fields.end());
+        }
+        return fields;
+    }
+
+    // Runs the replay checks with camera, or without one for nullptr.
+    // Returns whether they all passed.
+    bool checkReplays(const Bengine::Camera2D* camera) {
+        const char* name = camera ? "camera" : "no camera";
+        bool passed = true;
+
+        // The same time as 60 and as 120 frames per second
+        ReplayScene whole(camera);
+        ReplayScene halves(camera);
+        for (int frame = 0; frame < REPLAY_FRAMES; frame++) {
+            whole.engine.update(DELTA_TIME);
+            halves.engine.update(DELTA_TIME * 0.5f);
+            halves.engine.update(DELTA_TIME * 0.5f);
+        }
+        bool framesMatch = replayParticles(whole, false) == replayParticles(halves, false);
+        std::printf("replay %s: %zu particles, 1/60 s and 2 x 1/120 s frames %s\n", name,
+                    replayParticles(whole, false).size(), framesMatch ? "identical" : "DIFFERENT");
+        passed = passed && framesMatch;
+
+        // Both go on from the frames above, so the camera has already held
+        // batches back and scaled their spawning down
+        for (int step = 0; step < REPLAY_SKIP_STEPS; step++) {
+            halves.engine.skipAhead(1);
+        }
+        whole.engine.skipAhead(REPLAY_SKIP_STEPS);
+        bool skipMatches = replayParticles(whole, true) == replayParticles(halves, true);
+        std::printf("replay %s: %zu particles, skipAhead(%d) and %d single steps %s\n", name,
+                    replayParticles(whole, true).size(), REPLAY_SKIP_STEPS, REPLAY_SKIP_STEPS,
+                    skipMatches ? "match" : "DIFFER");
+        passed = passed && skipMatches;
+        return passed;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    int numParticles = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+    int numRuns = (argc > 2) ? std::atoi(argv[2]) : 20;
+
+    std::mt19937 randomEngine(1234);
+    std::uniform_real_distribution<float> posDist(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> velDist(-100.0f, 100.0f);
+
+    // Every path starts from the same particles, and each run only moves them
+    // a little, so they all stay alive
+    std::vector<Bengine::Particle2D> legacyParticles(numParticles);
+    for (auto& p : legacyParticles) {
+        p.position = glm::vec2(posDist(randomEngine), posDist(randomEngine));
+        p.velocity = glm::vec2(velDist(randomEngine), velDist(randomEngine));
+        p.color = Bengine::ColorRGBA8(255, 255, 255, 255);
+        p.life = 1.0f;
+        p.width = 4.0f;
+    }
+
+    Bengine::GLTexture texture = {};
+    Bengine::ParticleBatch2D callbackBatch;
+    callbackBatch.init(numParticles, DECAY_RATE, texture, customUpdate);
+    Bengine::ParticleBatch2D kernelBatch;
+    kernelBatch.init(numParticles, DECAY_RATE, texture);
+    Bengine::ParticleBatch2D effectCallbackBatch;
+    effectCallbackBatch.init(numParticles, DECAY_RATE, texture, effectUpdate);
+    Bengine::ParticleBatch2D effectModulesBatch;
+    effectModulesBatch.init(numParticles, DECAY_RATE, texture);
+    effectModulesBatch.setModules(Bengine::makeParticleModules(Bengine::GravityModule(GRAVITY), Bengine::DragModule(DRAG),
+                                                               Bengine::ColorOverLifeModule(START_COLOR, END_COLOR),
+                                                               Bengine::SizeOverLifeModule(START_WIDTH, END_WIDTH)));
+    Bengine::ParticleBatch2D turbulenceBatch;
+    turbulenceBatch.init(numParticles, DECAY_RATE, texture);
+    turbulenceBatch.setModules(Bengine::makeParticleModules(Bengine::GravityModule(GRAVITY), Bengine::DragModule(DRAG),
+                                                            Bengine::ColorOverLifeModule(START_COLOR, END_COLOR),
+                                                            Bengine::SizeOverLifeModule(START_WIDTH, END_WIDTH),
+                                                            Bengine::TurbulenceModule(50.0f, 0.05f)));
+
+    Bengine::ParticleBatch2D* batches[] = { &callbackBatch, &kernelBatch, &effectCallbackBatch,
+                                            &effectModulesBatch, &turbulenceBatch };
+    for (auto& p : legacyParticles) {
+        for (Bengine::ParticleBatch2D* batch : batches) {
+            batch->addParticle(p.position, p.velocity, p.color, p.width);
+        }
+    }
+
+    // The engines own their batches. Both get the same particles, dealt out
+    // over the batches in turn.
+    Bengine::ParticleEngine2D serialEngine;
+    Bengine::ParticleEngine2D threadedEngine;
+    Bengine::ThreadPool threadPool;
+    threadPool.init();
+    threadedEngine.setThreadPool(&threadPool);
+    std::vector<Bengine::ParticleBatch2D*> engineBatches;
+    for (Bengine::ParticleEngine2D* engine : { &serialEngine, &threadedEngine }) {
+        for (int i = 0; i < NUM_ENGINE_BATCHES; i++) {
+            Bengine::ParticleBatch2D* batch = new Bengine::ParticleBatch2D();
+            batch->init(numParticles / NUM_ENGINE_BATCHES + 1, DECAY_RATE, texture);
+            batch->setModules(Bengine::makeParticleModules(Bengine::GravityModule(GRAVITY), Bengine::DragModule(DRAG),
+                                                           Bengine::ColorOverLifeModule(START_COLOR, END_COLOR),
+                                                           Bengine::SizeOverLifeModule(START_WIDTH, END_WIDTH)));
+            engine->addParticleBatch(batch);
+            engineBatches.push_back(batch);
+        }
+    }
+    for (size_t i = 0; i < legacyParticles.size(); i++) {
+        const Bengine::Particle2D& p = legacyParticles[i];
+        engineBatches[i % NUM_ENGINE_BATCHES]->addParticle(p.position, p.velocity, p.color, p.width);
+        engineBatches[NUM_ENGINE_BATCHES + i % NUM_ENGINE_BATCHES]->addParticle(p.position, p.velocity, p.color, p.width);
+    }
+
+    // The same batches again, side by side, with a camera on the first
+    Bengine::ParticleEngine2D lodEngine;
+    Bengine::Camera2D camera;
+    camera.init(1920, 1080);
+    camera.update();
+    lodEngine.setCamera(&camera);
+    std::vector<Bengine::ParticleBatch2D*> lodBatches;
+    for (int i = 0; i < NUM_ENGINE_BATCHES; i++) {
+        Bengine::ParticleBatch2D* batch = new Bengine::ParticleBatch2D();
+        batch->init(numParticles / NUM_ENGINE_BATCHES + 1, DECAY_RATE, texture);
+        batch->setModules(Bengine::makeParticleModules(Bengine::GravityModule(GRAVITY), Bengine::DragModule(DRAG),
+                                                       Bengine::ColorOverLifeModule(START_COLOR, END_COLOR),
+                                                       Bengine::SizeOverLifeModule(START_WIDTH, END_WIDTH)));
+        lodEngine.addParticleBatch(batch);
+        lodBatches.push_back(batch);
+    }
+    for (size_t i = 0; i < legacyParticles.size(); i++) {
+        const Bengine::Particle2D& p = legacyParticles[i];
+        int batch = (int)(i % NUM_ENGINE_BATCHES);
+        glm::vec2 offset(LOD_BATCH_SPACING * (float)batch, 0.0f);
+        lodBatches[batch]->addParticle(p.position + offset, p.velocity, p.color, p.width);
+    }
+
+    struct Result {
+        const char* name;
+        double ms;
+    };
+    std::vector<Result> results;
+
+    std::function<void(Bengine::Particle2D&, float)> legacyUpdate = Bengine::defaultParticleUpdate;
+    results.push_back({ "AoS std::function", timeBest(numRuns, [&]() {
+        for (auto& p : legacyParticles) {
+            if (p.life > 0.0f) {
+                legacyUpdate(p, DELTA_TIME);
+                p.life -= DECAY_RATE * DELTA_TIME;
+            }
+        }
+    }) });
+
+    results.push_back({ "SoA callback", timeBest(numRuns, [&]() {
+        callbackBatch.update(DELTA_TIME);
+    }) });
+
+    results.push_back({ "SoA kernel", timeBest(numRuns, [&]() {
+        kernelBatch.update(DELTA_TIME);
+    }) });
+
+    results.push_back({ "effect callback", timeBest(numRuns, [&]() {
+        effectCallbackBatch.update(DELTA_TIME);
+    }) });
+
+    results.push_back({ "effect modules", timeBest(numRuns, [&]() {
+        effectModulesBatch.update(DELTA_TIME);
+    }) });
+
+    results.push_back({ "effect + turbulence", timeBest(numRuns, [&]() {
+        turbulenceBatch.update(DELTA_TIME);
+    }) });
+
+    results.push_back({ "engine serial", timeBest(numRuns, [&]() {
+        serialEngine.update(DELTA_TIME);
+    }) });
+
+    results.push_back({ "engine thread pool", timeBest(numRuns, [&]() {
+        threadedEngine.update(DELTA_TIME);
+    }) });
+
+    // The off-screen batches only update every OFFSCREEN_UPDATE_INTERVAL
+    // frames, so that many frames are timed together
+    const int numLodFrames = Bengine::ParticleEngine2D::OFFSCREEN_UPDATE_INTERVAL;
+    Bengine::ParticleEngineStats lodStats;
+    results.push_back({ "engine camera LOD", timeBest(numRuns, [&]() {
+        lodStats = Bengine::ParticleEngineStats();
+        for (int frame = 0; frame < numLodFrames; frame++) {
+            lodEngine.update(DELTA_TIME);
+            lodStats.numSimulated += lodEngine.getStats().numSimulated;
+            lodStats.numSkipped += lodEngine.getStats().numSkipped;
+        }
+    }) / numLodFrames });
+
+    // Every run adds its explosion after the ones before, so the batches
+    // have room for all of them
+    Bengine::ParticleBatch2D loopExplosionBatch;
+    loopExplosionBatch.init(EXPLOSION_SIZE * numRuns, DECAY_RATE, texture);
+    Bengine::ParticleBatch2D burstExplosionBatch;
+    burstExplosionBatch.init(EXPLOSION_SIZE * numRuns, DECAY_RATE, texture);
+    Bengine::ParticleEmitter2D emitter;
+    emitter.init(&burstExplosionBatch);
+    emitter.setCircle(10.0f);
+    emitter.setSpeed(50.0f, 200.0f);
+    emitter.setWidth(2.0f, 6.0f);
+    emitter.setColor(START_COLOR, END_COLOR);
+
+    std::uniform_real_distribution<float> unitDist(0.0f, 1.0f);
+    double loopExplosionMs = timeBest(numRuns, [&]() {
+        for (int i = 0; i < EXPLOSION_SIZE; i++) {
+            float angle = unitDist(randomEngine) * 6.28318531f;
+            float radius = 10.0f * std::sqrt(unitDist(randomEngine));
+            float spawnAngle = unitDist(randomEngine) * 6.28318531f;
+            float speed = 50.0f + 150.0f * unitDist(randomEngine);
+            float width = 2.0f + 4.0f * unitDist(randomEngine);
+            float t = unitDist(randomEngine);
+            Bengine::ColorRGBA8 color((GLubyte)(END_COLOR.r + (START_COLOR.r - END_COLOR.r) * t),
+                                      (GLubyte)(END_COLOR.g + (START_COLOR.g - END_COLOR.g) * t),
+                                      (GLubyte)(END_COLOR.b + (START_COLOR.b - END_COLOR.b) * t),
+                                      (GLubyte)(END_COLOR.a + (START_COLOR.a - END_COLOR.a) * t));
+            loopExplosionBatch.addParticle(glm::vec2(std::cos(angle), std::sin(angle)) * radius,
+                                           glm::vec2(std::cos(spawnAngle), std::sin(spawnAngle)) * speed, color, width);
+        }
+    });
+    double burstExplosionMs = timeBest(numRuns, [&]() {
+        emitter.burst(EXPLOSION_SIZE);
+    });
+
+    std::printf("%d particles, best of %d runs, %u worker threads\n", numParticles, numRuns,
+                threadPool.getNumThreads());
+    for (auto& r : results) {
+        std::printf("%-20s %10.3f ms %10.2f ns/particle %8.2fx\n", r.name, r.ms,
+                    r.ms * 1e6 / numParticles, results[0].ms / r.ms);
+    }
+
+    std::printf("camera LOD: %.1f%% of the particle updates skipped\n",
+                100.0 * lodStats.numSkipped / (double)(lodStats.numSimulated + lodStats.numSkipped));
+
+    std::printf("explosion of %d: addParticle loop %.3f ms, emitter burst %.3f ms, %.2fx\n", EXPLOSION_SIZE,
+                loopExplosionMs, burstExplosionMs, loopExplosionMs / burstExplosionMs);
+
+    // All paths ran the same number of steps, so they should agree
+    double legacySum = 0.0;
+    for (auto& p : legacyParticles) {
+        legacySum += p.position.x + p.position.y;
+    }
+    std::printf("checksums: %.3f %.3f %.3f\n", legacySum, checksum(callbackBatch.getParticles()),
+                checksum(kernelBatch.getParticles()));
+    std::printf("effect checksums: %.3f %.3f\n", checksum(effectCallbackBatch.getParticles()),
+                checksum(effectModulesBatch.getParticles()));
+
+    double serialSum = 0.0;
+    double threadedSum = 0.0;
+    for (int i = 0; i < NUM_ENGINE_BATCHES; i++) {
+        serialSum += checksum(engineBatches[i]->getParticles());
+        threadedSum += checksum(engineBatches[NUM_ENGINE_BATCHES + i]->getParticles());
+    }
+    std::printf("engine checksums: %.3f %.3f\n", serialSum, threadedSum);
+
+    bool replaysPassed = checkReplays(nullptr);
+    replaysPassed = checkReplays(&camera) && replaysPassed;
+
+    // Every update is as long as an off-screen batch's, so the particles
+    // cross the whole box several times in one
+    b2World world(b2Vec2(0.0f, -10.0f));
+    b2BodyDef boxDef;
+    b2Body* boxBody = world.CreateBody(&boxDef);
+    const float half = COLLISION_BOX_SIZE * 0.5f;
+    b2Vec2 corners[4] = { b2Vec2(-half, -half), b2Vec2(half, -half), b2Vec2(half, half), b2Vec2(-half, half) };
+    b2ChainShape boxShape;
+    boxShape.CreateLoop(corners, 4);
+    boxBody->CreateFixture(&boxShape, 0.0f);
+    Bengine::ParticleCollisionGrid grid;
+    double bakeMs = timeBest(1, [&]() {
+        grid.bake(&world, COLLISION_CELL_SIZE);
+    });
+
+    const int numCollisionParticles = std::max(numParticles / 10, 1);
+    Bengine::ParticleBatch2D collisionBatch;
+    collisionBatch.init(numCollisionParticles, DECAY_RATE, texture);
+    collisionBatch.setModules(Bengine::makeParticleModules(Bengine::GravityModule(GRAVITY),
+                                                           Bengine::CollisionModule(&grid, 0.8f, 0.0f)));
+    Bengine::ParticleEmitter2D collisionEmitter;
+    collisionEmitter.init(&collisionBatch);
+    collisionEmitter.setSeed(1);
+    collisionEmitter.setCircle(half * 0.5f);
+    collisionEmitter.setSpeed(100.0f, 1000.0f);
+    collisionEmitter.burst(numCollisionParticles);
+    const float collisionDeltaTime = DELTA_TIME * (float)Bengine::ParticleEngine2D::OFFSCREEN_UPDATE_INTERVAL;
+    double collisionMs = timeBest(1, [&]() {
+        for (int i = 0; i < COLLISION_UPDATES; i++) {
+            collisionBatch.update(collisionDeltaTime);
+        }
+    });
+    const Bengine::ParticlePool2D& collisionPool = collisionBatch.getParticles();
+    size_t numEscaped = 0;
+    for (size_t i = 0; i < collisionPool.getNumAlive(); i++) {
+        if (std::fabs(collisionPool.x[i]) > half || std::fabs(collisionPool.y[i]) > half) {
+            numEscaped++;
+        }
+    }
+    std::printf("collision: %d x %d grid baked in %.3f ms, %d updates of %.2f s of %zu particles %.3f ms, %zu escaped\n",
+                grid.getWidth(), grid.getHeight(), bakeMs, COLLISION_UPDATES, collisionDeltaTime,
+                collisionPool.getNumAlive(), collisionMs, numEscaped);
+
+    return replaysPassed && numEscaped == 0 ? 0 : 1;
+}
@@ -0,0 +1,397 @@
+// Renders sprites through a SpriteBatch in a headless window and reports the
+// wall time of each stage: draw submission, sorting, vertex build, buffer
+// upload, renderBatch and waiting for the GPU, plus the GL state changes per
+// frame that GLStateCache issued and elided.
+// Results go to stdout as CSV (default) or JSON, one row per run, so they can
+// be collected across commits.
+//
+// Usage: sprite_bench [options]
+//   --sprites N        sprites per frame (default 10000)
+//   --textures N       distinct textures (default 16)
+//   --rotated F        fraction of rotated sprites, 0 to 1 (default 0.5)
+//   --sort MODE        none, texture, front or back (default texture)
+//   --frames N         measured frames (default 100)
+//   --warmup N         frames run before measuring (default 10)
+//   --packed           use VertexFormat::PACKED
+//   --multidraw        use glMultiDrawArraysIndirect if the driver has it
+//   --cull             begin() with the view rect, 10% of sprites are off screen
+//   --depth-buffer     order sprites with SpriteBatch::setDepthBuffer, the sort
+//                      type is then ignored
+//   --translucent F    fraction of sprites drawn with half alpha (default 0)
+//   --json             print JSON instead of CSV
+//   --no-header        leave out the CSV header
+//   --out FILE         append the results to FILE instead of stdout. The CSV
+//                      header is only written when FILE is empty.
+//
+// Must be run from the repository root, for the shaders. Runs without a display
+// with SDL_VIDEODRIVER=offscreen, and without a GPU with LIBGL_ALWAYS_SOFTWARE=1.
+
+#include <Bengine/Bengine.h>
+#include <Bengine/FrameUniforms.h>
+#include <Bengine/GLSLProgram.h>
+#include <Bengine/GLStateCache.h>
+#include <Bengine/SpriteBatch.h>
+#include <Bengine/Window.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+    struct Options {
+        int numSprites = 10000;
+        int numTextures = 16;
+        float rotatedFraction = 0.5f;
+        std::string sortName = "texture";
+        int numFrames = 100;
+        int numWarmupFrames = 10;
+        bool packed = false;
+        bool multiDraw = false;
+        bool cull = false;
+        bool depthBuffer = false;
+        float translucentFraction = 0.0f;
+        bool json = false;
+        bool header = true;
+        std::string outPath;
+    };
+
+    struct Sprite {
+        glm::vec4 destRect;
+        GLuint texture;
+        float depth;
+        float angle;
+        bool rotated;
+        GLubyte alpha;
+    };
+
+    // The stages of one frame, in milliseconds
+    struct FrameTimings {
+        double draw;
+        double sort;
+        double vertexBuild;
+        double upload;
+        double render;
+        double gpu;
+        double total;
+    };
+
+    const int SCREEN_WIDTH = 1280;
+    const int SCREEN_HEIGHT = 720;
+
+    void printUsage() {
+        std::printf("Usage: sprite_bench [--sprites N] [--textures N] [--rotated F] [--sort none|texture|front|back]\n"
+                    "                    [--frames N] [--warmup N] [--packed] [--multidraw] [--cull] [--depth-buffer]\n"
+                    "                    [--translucent F] [--json] [--no-header] [--out FILE]\n");
+    }
+
+    bool parseOptions(int argc, char** argv, Options& rvOptions) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--sprites" && hasValue) {
+                rvOptions.numSprites = std::atoi(argv[++i]);
+            } else if (arg == "--textures" && hasValue) {
+                rvOptions.numTextures = std::max(1, std::atoi(argv[++i]));
+            } else if (arg == "--rotated" && hasValue) {
+                rvOptions.rotatedFraction = (float)std::atof(argv[++i]);
+            } else if (arg == "--sort" && hasValue) {
+                rvOptions.sortName = argv[++i];
+            } else if (arg == "--frames" && hasValue) {
+                rvOptions.numFrames = std::max(1, std::atoi(argv[++i]));
+            } else if (arg == "--warmup" && hasValue) {
+                rvOptions.numWarmupFrames = std::atoi(argv[++i]);
+            } else if (arg == "--packed") {
+                rvOptions.packed = true;
+            } else if (arg == "--multidraw") {
+                rvOptions.multiDraw = true;
+            } else if (arg == "--cull") {
+                rvOptions.cull = true;
+            } else if (arg == "--depth-buffer") {
+                rvOptions.depthBuffer = true;
+            } else if (arg == "--translucent" && hasValue) {
+                rvOptions.translucentFraction = (float)std::atof(argv[++i]);
+            } else if (arg == "--json") {
+                rvOptions.json = true;
+            } else if (arg == "--no-header") {
+                rvOptions.header = false;
+            } else if (arg == "--out" && hasValue) {
+                rvOptions.outPath = argv[++i];
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool parseSortType(const std::string& name, Bengine::GlyphSortType& rvSortType) {
+        if (name == "none") rvSortType = Bengine::GlyphSortType::NONE;
+        else if (name == "texture") rvSortType = Bengine::GlyphSortType::TEXTURE;
+        else if (name == "front") rvSortType = Bengine::GlyphSortType::FRONT_TO_BACK;
+        else if (name == "back") rvSortType = Bengine::GlyphSortType::BACK_TO_FRONT;
+        else return false;
+        return true;
+    }
+
+    // A small texture of a single color, so no image files are needed
+    GLuint createTexture(std::mt19937& randomEngine) {
+        std::vector<GLubyte> pixels(16 * 16 * 4);
+        GLubyte r = (GLubyte)randomEngine(), g = (GLubyte)randomEngine(), b = (GLubyte)randomEngine();
+        for (size_t i = 0; i < pixels.size(); i += 4) {
+            pixels[i] = r;
+            pixels[i + 1] = g;
+            pixels[i + 2] = b;
+            pixels[i + 3] = 255;
+        }
+
+        GLuint id;
+        glGenTextures(1, &id);
+        Bengine::GLStateCache::bindTexture(GL_TEXTURE_2D, id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 16, 16, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        Bengine::GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
+        return id;
+    }
+
+    double millisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // The mean of every measured frame, and the fastest frame
+    struct Summary {
+        FrameTimings mean = {};
+        FrameTimings best = {};
+    };
+
+    Summary summarize(const std::vector<FrameTimings>& frames) {
+        Summary summary;
+        summary.best = frames[0];
+        for (auto& f : frames) {
+            summary.mean.draw += f.draw;
+            summary.mean.sort += f.sort;
+            summary.mean.vertexBuild += f.vertexBuild;
+            summary.mean.upload += f.upload;
+            summary.mean.render += f.render;
+            summary.mean.gpu += f.gpu;
+            summary.mean.total += f.total;
+            if (f.total < summary.best.total) summary.best = f;
+        }
+        double n = (double)frames.size();
+        summary.mean.draw /= n;
+        summary.mean.sort /= n;
+        summary.mean.vertexBuild /= n;
+        summary.mean.upload /= n;
+        summary.mean.render /= n;
+        summary.mean.gpu /= n;
+        summary.mean.total /= n;
+        return summary;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    Bengine::GlyphSortType sortType;
+    if (!parseOptions(argc, argv, options) || !parseSortType(options.sortName, sortType)) {
+        printUsage();
+        return 1;
+    }
+
+    // Packed positions are only read by packedShading, so it can't be combined
+    // with the multi draw shaders
+    if (options.packed && options.multiDraw) {
+        std::fprintf(stderr, "--packed and --multidraw can't be used together\n");
+        return 1;
+    }
+    // Only depthShading reads the depth attribute
+    if (options.depthBuffer && (options.packed || options.multiDraw)) {
+        std::fprintf(stderr, "--depth-buffer can't be used with --packed or --multidraw\n");
+        return 1;
+    }
+
+    Bengine::init();
+    Bengine::Window window;
+    window.create("sprite_bench", SCREEN_WIDTH, SCREEN_HEIGHT, Bengine::HEADLESS);
+
+    Bengine::GLSLProgram program;
+    if (options.multiDraw && Bengine::SpriteBatch::isMultiDrawIndirectSupported()) {
+        program.compileShaders("Shaders/multiDrawShading.vert", "Shaders/multiDrawShading.frag");
+    } else if (options.depthBuffer) {
+        program.compileShaders("Shaders/depthShading.vert", "Shaders/depthShading.frag");
+    } else if (options.packed) {
+        program.compileShaders("Shaders/packedShading.vert", "Shaders/colorShading.frag");
+    } else {
+        program.compileShaders("Shaders/colorShading.vert", "Shaders/colorShading.frag");
+    }
+    program.addAttribute("vertexPosition");
+    program.addAttribute("vertexColor");
+    program.addAttribute("vertexUV");
+    program.linkShaders();
+
+    Bengine::SpriteBatch spriteBatch;
+    spriteBatch.init();
+    spriteBatch.setProfiling(true);
+    if (options.packed) {
+        spriteBatch.setVertexFormat(Bengine::VertexFormat::PACKED);
+    }
+    bool multiDraw = options.multiDraw && spriteBatch.setMultiDrawIndirect(true);
+    if (options.depthBuffer) {
+        spriteBatch.setDepthBuffer(true, 0.0f, 100.0f);
+    }
+
+    std::mt19937 randomEngine(1234);
+    std::vector<GLuint> textures(options.numTextures);
+    for (auto& texture : textures) {
+        texture = createTexture(randomEngine);
+    }
+
+    // With culling, a tenth of the sprites start off screen
+    float offscreenFraction = options.cull ? 0.1f : 0.0f;
+    std::uniform_real_distribution<float> unitDist(0.0f, 1.0f);
+    std::uniform_real_distribution<float> sizeDist(8.0f, 48.0f);
+    std::vector<Sprite> sprites(options.numSprites);
+    for (auto& sprite : sprites) {
+        float x = unitDist(randomEngine) * SCREEN_WIDTH;
+        float y = unitDist(randomEngine) * SCREEN_HEIGHT;
+        if (unitDist(randomEngine) < offscreenFraction) {
+            x += SCREEN_WIDTH * 2.0f;
+        }
+        float size = sizeDist(randomEngine);
+        sprite.destRect = glm::vec4(x, y, size, size);
+        sprite.texture = textures[randomEngine() % textures.size()];
+        sprite.depth = unitDist(randomEngine) * 100.0f;
+        sprite.angle = unitDist(randomEngine) * 6.2831853f;
+        sprite.rotated = unitDist(randomEngine) < options.rotatedFraction;
+        sprite.alpha = (unitDist(randomEngine) < options.translucentFraction) ? 128 : 255;
+    }
+
+    program.use();
+    Bengine::FrameUniforms frameUniforms;
+    frameUniforms.init();
+    glm::mat4 projection = glm::ortho(0.0f, (float)SCREEN_WIDTH, 0.0f, (float)SCREEN_HEIGHT);
+    frameUniforms.update(projection, glm::vec4(0.0f, 0.0f, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT), 0.0f);
+    if (!multiDraw) {
+        glUniform1i(program.getUniformLocation("mySampler"), 0);
+    }
+
+    const glm::vec4 uvRect(0.0f, 0.0f, 1.0f, 1.0f);
+    const glm::vec4 viewRect(0.0f, 0.0f, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT);
+
+    std::vector<FrameTimings> frames;
+    frames.reserve(options.numFrames);
+    size_t warmupAllocations = 0;
+    for (int frame = 0; frame < options.numWarmupFrames + options.numFrames; frame++) {
+        FrameTimings timings;
+        if (frame == options.numWarmupFrames) {
+            warmupAllocations = spriteBatch.getNumAllocations();
+            Bengine::GLStateCache::resetCounters();
+        }
+        auto frameStart = std::chrono::high_resolution_clock::now();
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        auto drawStart = std::chrono::high_resolution_clock::now();
+        if (options.cull) {
+            spriteBatch.begin(viewRect, sortType);
+        } else {
+            spriteBatch.begin(sortType);
+        }
+        for (auto& sprite : sprites) {
+            Bengine::ColorRGBA8 color(255, 255, 255, sprite.alpha);
+            if (sprite.rotated) {
+                spriteBatch.draw(sprite.destRect, uvRect, sprite.texture, sprite.depth, color, sprite.angle);
+            } else {
+                spriteBatch.draw(sprite.destRect, uvRect, sprite.texture, sprite.depth, color);
+            }
+        }
+        timings.draw = millisecondsSince(drawStart);
+
+        spriteBatch.end();
+        spriteBatch.renderBatch();
+
+        // Wait for the GPU, so its time isn't hidden in the next frame
+        auto gpuStart = std::chrono::high_resolution_clock::now();
+        glFinish();
+        timings.gpu = millisecondsSince(gpuStart);
+
+        window.swapBuffer();
+        timings.total = millisecondsSince(frameStart);
+
+        const Bengine::SpriteBatchTimings& stages = spriteBatch.getTimings();
+        timings.sort = stages.sort;
+        timings.vertexBuild = stages.vertexBuild;
+        timings.upload = stages.upload;
+        timings.render = stages.render;
+
+        if (frame >= options.numWarmupFrames) {
+            frames.push_back(timings);
+        }
+    }
+
+    Summary summary = summarize(frames);
+    const FrameTimings& m = summary.mean;
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    // Should be 0, SpriteBatch reuses its storage once warmed up
+    size_t steadyAllocations = spriteBatch.getNumAllocations() - warmupAllocations;
+    double stateIssued = (double)Bengine::GLStateCache::getNumIssued() / options.numFrames;
+    double stateElided = (double)Bengine::GLStateCache::getNumElided() / options.numFrames;
+
+    FILE* out = stdout;
+    if (!options.outPath.empty()) {
+        out = std::fopen(options.outPath.c_str(), "a");
+        if (out == nullptr) {
+            std::fprintf(stderr, "Could not open %s\n", options.outPath.c_str());
+            return 1;
+        }
+        // Only a new file needs the header
+        std::fseek(out, 0, SEEK_END);
+        if (std::ftell(out) > 0) {
+            options.header = false;
+        }
+    }
+
+    if (options.json) {
+        std::fprintf(out, "{\"sprites\": %d, \"textures\": %d, \"rotated\": %g, \"sort\": \"%s\", \"frames\": %d, "
+                          "\"packed\": %s, \"multidraw\": %s, \"cull\": %s, \"depthBuffer\": %s, \"translucent\": %g, "
+                          "\"renderer\": \"%s\", "
+                          "\"drawCalls\": %zu, \"uploadedBytes\": %zu, \"culled\": %zu, "
+                          "\"drawMs\": %.4f, \"sortMs\": %.4f, \"vertexBuildMs\": %.4f, \"uploadMs\": %.4f, "
+                          "\"renderMs\": %.4f, \"gpuMs\": %.4f, \"frameMs\": %.4f, \"bestFrameMs\": %.4f, "
+                          "\"steadyAllocations\": %zu, \"stateIssued\": %.1f, \"stateElided\": %.1f}\n",
+                          options.numSprites, options.numTextures, options.rotatedFraction, options.sortName.c_str(),
+                          options.numFrames, options.packed ? "true" : "false", multiDraw ? "true" : "false",
+                          options.cull ? "true" : "false", options.depthBuffer ? "true" : "false",
+                          options.translucentFraction, renderer, spriteBatch.getNumDrawCalls(),
+                          spriteBatch.getNumUploadedBytes(), spriteBatch.getNumCulledGlyphs(),
+                          m.draw, m.sort, m.vertexBuild, m.upload, m.render, m.gpu, m.total, summary.best.total,
+                          steadyAllocations, stateIssued, stateElided);
+    } else {
+        if (options.header) {
+            std::fprintf(out, "sprites,textures,rotated,sort,frames,packed,multidraw,cull,depthBuffer,translucent,renderer,drawCalls,uploadedBytes,culled,"
+                              "drawMs,sortMs,vertexBuildMs,uploadMs,renderMs,gpuMs,frameMs,bestFrameMs,steadyAllocations,stateIssued,stateElided\n");
+        }
+        std::fprintf(out, "%d,%d,%g,%s,%d,%d,%d,%d,%d,%g,\"%s\",%zu,%zu,%zu,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%zu,%.1f,%.1f\n",
+                          options.numSprites, options.numTextures, options.rotatedFraction, options.sortName.c_str(),
+                          options.numFrames, options.packed ? 1 : 0, multiDraw ? 1 : 0, options.cull ? 1 : 0,
+                          options.depthBuffer ? 1 : 0, options.translucentFraction, renderer,
+                          spriteBatch.getNumDrawCalls(), spriteBatch.getNumUploadedBytes(), spriteBatch.getNumCulledGlyphs(),
+                          m.draw, m.sort, m.vertexBuild, m.upload, m.render, m.gpu, m.total, summary.best.total,
+                          steadyAllocations, stateIssued, stateElided);
+    }
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    spriteBatch.dispose();
+    frameUniforms.dispose();
+    program.dispose();
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Compares the STANDARD and PACKED SpriteBatch vertex formats: bytes uploaded
+// per frame, the CPU cost of packing, and the precision the packing loses.
+// Only the CPU side is measured, so no window or GL context is needed.
+//
+// Usage: vertex_bench [numSprites] [numRuns]
+
+#include <Bengine/GlyphKernels.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+
+    // Runs body numRuns times and returns the fastest run in milliseconds
+    double timeBest(int numRuns, const std::function<void()>& body) {
+        double best = 1e30;
+        for (int i = 0; i < numRuns; i++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            body();
+            auto end = std::chrono::high_resolution_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            if (ms < best) best = ms;
+        }
+        return best;
+    }
+
+    float halfToFloat(GLushort half) {
+        int exponent = (half >> 10) & 0x1f;
+        int mantissa = half & 0x3ff;
+        float value;
+        if (exponent == 0) {
+            value = std::ldexp((float)mantissa, -24);
+        } else {
+            value = std::ldexp((float)(mantissa | 0x400), exponent - 25);
+        }
+        return (half & 0x8000) ? -value : value;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    int numSprites = (argc > 1) ? std::atoi(argv[1]) : 100000;
+    int numRuns = (argc > 2) ? std::atoi(argv[2]) : 20;
+    const int numVertices = numSprites * 6;
+
+    // A 1920x1080 view far from the world origin, like a culled batch would be
+    const glm::vec2 viewCenter(25000.0f, -12000.0f);
+    std::mt19937 randomEngine(1234);
+    std::uniform_real_distribution<float> xDist(viewCenter.x - 960.0f, viewCenter.x + 960.0f);
+    std::uniform_real_distribution<float> yDist(viewCenter.y - 540.0f, viewCenter.y + 540.0f);
+    std::uniform_real_distribution<float> uvDist(0.0f, 1.0f);
+
+    std::vector<Bengine::Vertex> vertices(numVertices);
+    for (auto& v : vertices) {
+        v.setPosition(xDist(randomEngine), yDist(randomEngine));
+        v.setColor(255, 255, 255, 255);
+        v.setUV(uvDist(randomEngine), uvDist(randomEngine));
+    }
+
+    std::vector<Bengine::Vertex> uploadCopy(numVertices);
+    std::vector<Bengine::PackedVertex> packed(numVertices);
+
+    // A memcpy stands in for what the driver does with the upload
+    double standardMs = timeBest(numRuns, [&]() {
+        std::memcpy(uploadCopy.data(), vertices.data(), numVertices * sizeof(Bengine::Vertex));
+    });
+    double packMs = timeBest(numRuns, [&]() {
+        Bengine::packVertices(vertices.data(), numVertices, viewCenter, packed.data());
+    });
+    std::vector<Bengine::PackedVertex> packedCopy(numVertices);
+    double packedCopyMs = timeBest(numRuns, [&]() {
+        std::memcpy(packedCopy.data(), packed.data(), numVertices * sizeof(Bengine::PackedVertex));
+    });
+
+    float maxPositionError = 0.0f;
+    float maxUVError = 0.0f;
+    for (int i = 0; i < numVertices; i++) {
+        const Bengine::Vertex& v = vertices[i];
+        const Bengine::PackedVertex& p = packed[i];
+        float x = viewCenter.x + halfToFloat(p.position[0]);
+        float y = viewCenter.y + halfToFloat(p.position[1]);
+        maxPositionError = std::fmax(maxPositionError, std::fmax(std::fabs(x - v.position.x), std::fabs(y - v.position.y)));
+        float u = p.uv[0] / 65535.0f;
+        float uv = p.uv[1] / 65535.0f;
+        maxUVError = std::fmax(maxUVError, std::fmax(std::fabs(u - v.uv.u), std::fabs(uv - v.uv.v)));
+    }
+
+    size_t standardBytes = numVertices * sizeof(Bengine::Vertex);
+    size_t packedBytes = numVertices * sizeof(Bengine::PackedVertex);
+
+    std::printf("%d sprites (%d vertices), best of %d runs\n", numSprites, numVertices, numRuns);
+    std::printf("%-10s %4d bytes/vertex %10.2f KiB/frame %8.3f ms copy\n", "STANDARD",
+                (int)sizeof(Bengine::Vertex), standardBytes / 1024.0, standardMs);
+    std::printf("%-10s %4d bytes/vertex %10.2f KiB/frame %8.3f ms copy %8.3f ms pack (%.2f ns/vertex)\n", "PACKED",
+                (int)sizeof(Bengine::PackedVertex), packedBytes / 1024.0, packedCopyMs, packMs,
+                packMs * 1e6 / numVertices);
+    std::printf("upload saved: %.1f%%\n", 100.0 * (1.0 - (double)packedBytes / standardBytes));
+    std::printf("max position error: %g units, max UV error: %g\n", maxPositionError, maxUVError);
+
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include "AnimatedSpriteBatch.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Bengine {
+
+AnimatedSpriteBatch::AnimatedSpriteBatch() : _vbo(0), _vao(0), _slots(1)
+{
+}
+
+AnimatedSpriteBatch::~AnimatedSpriteBatch()
+{
+}
+
+void AnimatedSpriteBatch::init() {
+    // Generate the VAO if it isn't already generated
+    if (_vao == 0) {
+        glGenVertexArrays(1, &_vao);
+    }
+    GLStateCache::bindVertexArray(_vao);
+
+    // Generate the VBO if it isn't already generated
+    if (_vbo == 0) {
+        glGenBuffers(1, &_vbo);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+
+    // Every attribute is per instance, the shader makes the corners from gl_VertexID
+    for (GLuint i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+    setInstanceAttributes(0);
+
+    GLStateCache::bindVertexArray(0);
+}
+
+void AnimatedSpriteBatch::dispose() {
+    if (_vao != 0) {
+        GLStateCache::forgetVertexArray(_vao);
+        glDeleteVertexArrays(1, &_vao);
+        _vao = 0;
+    }
+    if (_vbo != 0) {
+        glDeleteBuffers(1, &_vbo);
+        _vbo = 0;
+    }
+}
+
+void AnimatedSpriteBatch::begin() {
+    _sprites.clear();
+    _textures.clear();
+    _batches.clear();
+    _slots.clear();
+}
+
+int AnimatedSpriteBatch::draw(const glm::vec4& destRect, const TileSheet& sheet, int startFrame, int numFrames, float fps,
+                              float startTime, const ColorRGBA8& color, float angle /* 0.0f */) {
+    _sprites.push_back(makeSprite(destRect, sheet, startFrame, numFrames, fps, startTime, color, angle));
+    _textures.push_back(sheet.texture.id);
+    return (int)_sprites.size() - 1;
+}
+
+void AnimatedSpriteBatch::end() {
+    rebuild();
+}
+
+void AnimatedSpriteBatch::update(int slot, const glm::vec4& destRect, const TileSheet& sheet, int startFrame, int numFrames,
+                                 float fps, float startTime, const ColorRGBA8& color, float angle /* 0.0f */) {
+    setSprite(slot, makeSprite(destRect, sheet, startFrame, numFrames, fps, startTime, color, angle), sheet.texture.id);
+}
+
+void AnimatedSpriteBatch::update(int slot, const glm::vec4& destRect, float angle /* 0.0f */) {
+    assert(slot >= 0 && slot < getNumSprites());
+    AnimatedSprite sprite = _sprites[slot];
+    sprite.destRect = destRect;
+    sprite.angle = angle;
+    setSprite(slot, sprite, _textures[slot]);
+}
+
+void AnimatedSpriteBatch::renderBatch() {
+    if (_slots.needsRebuild()) {
+        rebuild();
+    } else if (_slots.hasDirtyRanges()) {
+        _slots.uploadDirtyRanges(_vbo, _instances.data(), sizeof(AnimatedSprite));
+    }
+
+    GLStateCache::bindVertexArray(_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+
+    for (size_t i = 0; i < _batches.size(); i++) {
+        GLStateCache::bindTexture(GL_TEXTURE_2D, _batches[i].texture);
+
+        setInstanceAttributes(_batches[i].firstInstance);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, _batches[i].numInstances);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void AnimatedSpriteBatch::rebuild() {
+    _batches.clear();
+
+    const std::vector<int>& order = _slots.sortSlots(_sprites.size(), [this](int slot) {
+        return _textures[slot];
+    });
+
+    _instances.resize(_sprites.size());
+
+    for (size_t i = 0; i < order.size(); i++) {
+        GLuint texture = _textures[order[i]];
+
+        // Check if this sprite can be part of the current batch
+        if (i == 0 || texture != _textures[order[i - 1]]) {
+            _batches.push_back({ (GLuint)i, 1, texture });
+        } else {
+            _batches.back().numInstances++;
+        }
+
+        _instances[i] = _sprites[order[i]];
+    }
+
+    // The data rarely changes, so let the driver keep it in video memory
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+    glBufferData(GL_ARRAY_BUFFER, _instances.size() * sizeof(AnimatedSprite), _instances.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void AnimatedSpriteBatch::setSprite(int slot, const AnimatedSprite& sprite, GLuint texture) {
+    assert(slot >= 0 && slot < getNumSprites());
+    // Only sprites end() placed in the buffer can be updated
+    assert(_slots.getNumSlots() == _sprites.size());
+
+    // A new texture moves the slot to another InstanceBatch
+    if (texture != _textures[slot]) {
+        _slots.markNeedsRebuild();
+    }
+    _sprites[slot] = sprite;
+    _textures[slot] = texture;
+
+    if (!_slots.needsRebuild()) {
+        _instances[_slots.getOffset(slot)] = sprite;
+        _slots.markDirty(slot);
+    }
+}
+
+void AnimatedSpriteBatch::setInstanceAttributes(GLuint firstInstance) {
+    const GLsizei stride = sizeof(AnimatedSprite);
+    const size_t base = firstInstance * sizeof(AnimatedSprite);
+
+    //This is the destination rect attribute pointer
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(AnimatedSprite, destRect)));
+    //This is the color attribute pointer
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(base + offsetof(AnimatedSprite, color)));
+    //This is the angle, start time and fps attribute pointer
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(AnimatedSprite, angle)));
+    //This is the sheet dims, start frame and frame count attribute pointer
+    glVertexAttribIPointer(3, 4, GL_UNSIGNED_SHORT, stride, (void*)(base + offsetof(AnimatedSprite, sheetDims)));
+}
+
+AnimatedSprite AnimatedSpriteBatch::makeSprite(const glm::vec4& destRect, const TileSheet& sheet, int startFrame, int numFrames,
+                                               float fps, float startTime, const ColorRGBA8& color, float angle) {
+    AnimatedSprite sprite;
+    sprite.destRect = destRect;
+    sprite.color = color;
+    sprite.angle = angle;
+    sprite.startTime = startTime;
+    sprite.fps = fps;
+    sprite.sheetDims[0] = (GLushort)sheet.dims.x;
+    sprite.sheetDims[1] = (GLushort)sheet.dims.y;
+    sprite.startFrame = (GLushort)startFrame;
+    // The shader loops with a modulo, which can't be by zero
+    sprite.numFrames = (GLushort)std::max(numFrames, 1);
+    return sprite;
+}
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "SlotBuffer.h"
+#include "TileSheet.h"
+#include "Vertex.h"
+
+namespace Bengine {
+
+// An animated sprite as it is stored in the instance buffer
+struct AnimatedSprite {
+    glm::vec4 destRect;
+    ColorRGBA8 color;
+    GLfloat angle;
+    GLfloat startTime; ///< When the animation is on startFrame, in the units of the FrameUniforms time
+    GLfloat fps;
+    GLushort sheetDims[2]; ///< Tiles across and down the sheet
+    GLushort startFrame;
+    GLushort numFrames;
+};
+
+// A batch of sprites that play looping TileSheet animations. Each sprite is an
+// instance, and the animatedShading vertex shader builds its quad and picks the
+// current tile from the time of the FrameUniforms, so nothing is computed or uploaded per
+// frame unless a sprite changes. Like StaticSpriteBatch, sprites are changed
+// through the slot draw() returned and only the dirty ranges are uploaded.
+// Needs the animatedShading vertex shader, which works with colorShading.frag.
+class AnimatedSpriteBatch
+{
+public:
+    AnimatedSpriteBatch();
+    ~AnimatedSpriteBatch();
+
+    // Generates our VAO and VBO
+    void init();
+    void dispose();
+
+    // Begins building the batch. This removes all sprites, so the slots
+    // draw() returned before are no longer valid.
+    void begin();
+
+    // Adds a sprite that shows numFrames tiles of sheet in index order, starting
+    // at startFrame at startTime and looping at fps. Returns the slot used to
+    // update it later.
+    int draw(const glm::vec4& destRect, const TileSheet& sheet, int startFrame, int numFrames, float fps,
+             float startTime, const ColorRGBA8& color, float angle = 0.0f);
+
+    // Sorts the sprites by texture and uploads all of them
+    void end();
+
+    // Replaces the sprite in slot, which must come from draw() since the last
+    // begin(), after end(). Changing the sheet's texture is allowed, but means
+    // the whole batch is sorted and uploaded again on the next renderBatch().
+    void update(int slot, const glm::vec4& destRect, const TileSheet& sheet, int startFrame, int numFrames, float fps,
+                float startTime, const ColorRGBA8& color, float angle = 0.0f);
+    // Moves the sprite in slot, keeping its animation
+    void update(int slot, const glm::vec4& destRect, float angle = 0.0f);
+
+    // Uploads the dirty ranges and renders the batch at the time of the
+    // FrameUniforms, see FrameUniforms::update()
+    void renderBatch();
+
+    int getNumSprites() const { return (int)_sprites.size(); }
+
+private:
+    // The sprites of one texture, drawn with a single instanced call
+    struct InstanceBatch {
+        GLuint firstInstance;
+        GLuint numInstances;
+        GLuint texture;
+    };
+
+    // Sorts the sprites, builds the InstanceBatches and uploads every instance
+    void rebuild();
+
+    // Replaces a sprite and marks its instance dirty
+    void setSprite(int slot, const AnimatedSprite& sprite, GLuint texture);
+
+    // Points the instance attributes at firstInstance, since the draw calls
+    // can't offset instances without GL 4.2
+    void setInstanceAttributes(GLuint firstInstance);
+
+    static AnimatedSprite makeSprite(const glm::vec4& destRect, const TileSheet& sheet, int startFrame, int numFrames,
+                                     float fps, float startTime, const ColorRGBA8& color, float angle);
+
+    GLuint _vbo;
+    GLuint _vao;
+
+    SlotBuffer _slots; ///< Which instance each slot is, and which changed
+
+    std::vector<AnimatedSprite> _sprites; ///< Indexed by slot
+    std::vector<GLuint> _textures; ///< Of each slot
+    std::vector<AnimatedSprite> _instances; ///< Copy of the buffer, dirty ranges are uploaded from it
+    std::vector<InstanceBatch> _batches;
+};
+
+}
@@ -52,6 +52,13 @@ namespace Bengine {
         return screenCoords;
     }
 
+    // The bottom left corner and size of what the camera sees, in world units
+    glm::vec4 Camera2D::getViewRect() const {
+        glm::vec2 scaledScreenDimensions = glm::vec2(_screenWidth, _screenHeight) / (_scale);
+        glm::vec2 bottomLeft = _position - scaledScreenDimensions / 2.0f;
+        return glm::vec4(bottomLeft, scaledScreenDimensions);
+    }
+
     // Simple AABB test to see if a box is in the camera view
     bool Camera2D::isBoxInView(const glm::vec2& position, const glm::vec2& dimensions) {
 
@@ -21,6 +21,9 @@ namespace Bengine {
 
         bool isBoxInView(const glm::vec2& position, const glm::vec2& dimensions);
 
+        //the world space rectangle the camera sees, as (x, y, width, height)
+        glm::vec4 getViewRect() const;
+
         void offsetPosition(const glm::vec2& offset) { _position += offset; _needsMatrixUpdate = true; }
         void offsetScale(float offset) { _scale += offset; if (_scale < 0.001f) _scale = 0.001f; _needsMatrixUpdate = true; }
 
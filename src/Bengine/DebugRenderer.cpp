@@ -1,9 +1,10 @@
 #include "DebugRenderer.h"
+#include "GLStateCache.h"
 
 const float PI = 3.14159265359f;
 
 namespace {
-    const char* VERT_SRC = R"(#version 130
+    const char* VERT_SRC = R"(#version 400
 //The vertex shader operates on each vertex
 
 //input data from the VBO. Each vertex is 2 floats
@@ -13,11 +14,16 @@ in vec4 vertexColor;
 out vec2 fragmentPosition;
 out vec4 fragmentColor;
 
-uniform mat4 P;
+//Per frame data from FrameUniforms, shared by every program
+layout(std140) uniform FrameUniforms {
+    mat4 viewProjection;
+    vec4 viewport; //x, y, width and height in pixels
+    float time;
+} frame;
 
 void main() {
     //Set the x,y position on the screen
-    gl_Position.xy = (P * vec4(vertexPosition, 0.0, 1.0)).xy;
+    gl_Position.xy = (frame.viewProjection * vec4(vertexPosition, 0.0, 1.0)).xy;
     //the z position is zero since we are in 2D
     gl_Position.z = 0.0;
     
@@ -29,7 +35,7 @@ void main() {
     fragmentColor = vertexColor;
 })";
 
-    const char* FRAG_SRC = R"(#version 130
+    const char* FRAG_SRC = R"(#version 400
 //The fragment shader operates on each pixel in a given polygon
 
 in vec2 fragmentPosition;
@@ -66,7 +72,7 @@ void Bengine::DebugRenderer::init() {
     glGenBuffers(1, &m_vbo);
     glGenBuffers(1, &m_ibo);
 
-    glBindVertexArray(m_vao);
+    GLStateCache::bindVertexArray(m_vao);
     glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
 
@@ -75,7 +81,7 @@ void Bengine::DebugRenderer::init() {
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DebugVertex), (void*)offsetof(DebugVertex, color));
 
-    glBindVertexArray(0);
+    GLStateCache::bindVertexArray(0);
 }
 
 void Bengine::DebugRenderer::end() {
@@ -86,12 +92,12 @@ void Bengine::DebugRenderer::end() {
     glBufferSubData(GL_ARRAY_BUFFER, 0, m_verts.size() * sizeof(DebugVertex), m_verts.data());
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+    // The index buffer binding belongs to the bound VAO, so use ours
+    GLStateCache::bindVertexArray(m_vao);
     // Orphan the buffer
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
     // Upload the data
     glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, m_indices.size() * sizeof(GLuint), m_indices.data());
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
     m_numElements = m_indices.size();
     m_indices.clear();
@@ -180,22 +186,32 @@ void Bengine::DebugRenderer::drawCircle(const glm::vec2& center, const ColorRGBA
     m_indices.push_back(start);
 }
 
-void Bengine::DebugRenderer::render(const glm::mat4& projectionMatrix, float lineWidth) {
-    m_program.use();
+void Bengine::DebugRenderer::drawLines(const DebugRenderer& other) {
+    GLuint first = (GLuint)m_verts.size();
+    m_verts.insert(m_verts.end(), other.m_verts.begin(), other.m_verts.end());
+    for (GLuint index : other.m_indices) {
+        m_indices.push_back(first + index);
+    }
+}
 
-    GLint pUniform = m_program.getUniformLocation("P");
-    glUniformMatrix4fv(pUniform, 1, GL_FALSE, &projectionMatrix[0][0]);
+void Bengine::DebugRenderer::clear() {
+    m_indices.clear();
+    m_verts.clear();
+}
+
+void Bengine::DebugRenderer::render(float lineWidth) {
+    m_program.use();
 
     glLineWidth(lineWidth);
-    glBindVertexArray(m_vao);
+    GLStateCache::bindVertexArray(m_vao);
     glDrawElements(GL_LINES, m_numElements, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
 
     m_program.unuse();
 }
 
 void Bengine::DebugRenderer::dispose() {
     if (m_vao) {
+        GLStateCache::forgetVertexArray(m_vao);
         glDeleteVertexArrays(1, &m_vao);
     }
     if (m_vbo) {
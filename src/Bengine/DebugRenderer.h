@@ -16,7 +16,13 @@ namespace Bengine {
         void drawLine(const glm::vec2& a, const glm::vec2& b, const ColorRGBA8& color);
         void drawBox(const glm::vec4& destRect, const ColorRGBA8& color, float angle);
         void drawCircle(const glm::vec2& center, const ColorRGBA8& color, float radius);
-        void render(const glm::mat4& projectionMatrix, float lineWidth);
+        // Adds everything drawn into other since its last end(). other doesn't
+        // need init(), so it can be filled on another thread and handed over.
+        void drawLines(const DebugRenderer& other);
+        // Drops everything drawn since the last end() without uploading it
+        void clear();
+        // Draws with the view projection of the FrameUniforms
+        void render(float lineWidth);
         void dispose();
 
         struct DebugVertex {
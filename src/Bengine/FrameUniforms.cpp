@@ -0,0 +1,60 @@
+#include "FrameUniforms.h"
+
+namespace Bengine {
+
+    const GLuint FrameUniforms::BINDING;
+    const char* const FrameUniforms::BLOCK_NAME = "FrameUniforms";
+
+    // mat4 + vec4 + float, padded to 16 bytes
+    static_assert(sizeof(FrameUniformData) == 96, "FrameUniformData must match the std140 layout of the block");
+
+    FrameUniforms::FrameUniforms() : m_data() {
+        // Empty
+    }
+
+    FrameUniforms::~FrameUniforms() {
+        dispose();
+    }
+
+    void FrameUniforms::init() {
+        if (m_ubo == 0) {
+            glGenBuffers(1, &m_ubo);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniformData), &m_data, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        bind();
+    }
+
+    void FrameUniforms::dispose() {
+        if (m_ubo != 0) {
+            glDeleteBuffers(1, &m_ubo);
+            m_ubo = 0;
+        }
+    }
+
+    void FrameUniforms::update(const glm::mat4& viewProjection, const glm::vec4& viewport, float time) {
+        FrameUniformData data;
+        data.viewProjection = viewProjection;
+        data.viewport = viewport;
+        data.time = time;
+        data.padding[0] = data.padding[1] = data.padding[2] = 0.0f;
+        update(data);
+    }
+
+    void FrameUniforms::update(const FrameUniformData& data) {
+        m_data = data;
+
+        // Orphan the buffer, so the driver doesn't wait for last frame's draws
+        glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniformData), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniformData), &m_data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void FrameUniforms::bind() {
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, m_ubo);
+    }
+
+}
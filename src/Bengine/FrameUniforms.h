@@ -0,0 +1,46 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace Bengine {
+
+    // The FrameUniforms block of the shaders, laid out by std140 rules
+    struct FrameUniformData {
+        glm::mat4 viewProjection;
+        glm::vec4 viewport; ///< x, y, width and height in pixels
+        GLfloat time; ///< Seconds, or whatever unit the game drives effects with
+        GLfloat padding[3]; ///< std140 rounds the block up to a multiple of 16 bytes
+    };
+
+    // A uniform buffer with the data every Bengine shader reads once per frame.
+    // It stays bound to BINDING, and GLSLProgram::linkShaders() points the
+    // FrameUniforms block of every program there, so one update() per frame
+    // reaches all programs and passes without any glUniform calls.
+    class FrameUniforms {
+    public:
+        // The uniform buffer binding point of the FrameUniforms block
+        static const GLuint BINDING = 0;
+        static const char* const BLOCK_NAME;
+
+        FrameUniforms();
+        ~FrameUniforms();
+
+        // Creates the buffer and binds it to BINDING
+        void init();
+        void dispose();
+
+        void update(const glm::mat4& viewProjection, const glm::vec4& viewport, float time);
+        void update(const FrameUniformData& data);
+
+        // Binds the buffer to BINDING again, in case something else took it
+        void bind();
+
+        const FrameUniformData& getData() const { return m_data; }
+
+    private:
+        FrameUniformData m_data;
+        GLuint m_ubo = 0;
+    };
+
+}
@@ -1,5 +1,7 @@
 #include "GLSLProgram.h"
 #include "BengineErrors.h"
+#include "FrameUniforms.h"
+#include "GLStateCache.h"
 #include "IOManager.h"
 
 #include <vector>
@@ -8,6 +10,8 @@
 
 namespace Bengine {
 
+    const GLSLProgram* GLSLProgram::_current = nullptr;
+
     //The : _numAttributes(0) ect. is an initialization list. It is a better way to initialize variables, since it avoids an extra copy. 
     GLSLProgram::GLSLProgram() : _numAttributes(0), _programID(0), _vertexShaderID(0), _fragmentShaderID(0)
     {
@@ -90,6 +94,14 @@ namespace Bengine {
         glDetachShader(_programID, _fragmentShaderID);
         glDeleteShader(_vertexShaderID);
         glDeleteShader(_fragmentShaderID);
+
+        //Programs that read the per frame data get it from the shared buffer
+        GLuint frameBlock = glGetUniformBlockIndex(_programID, FrameUniforms::BLOCK_NAME);
+        if (frameBlock != GL_INVALID_INDEX) {
+            glUniformBlockBinding(_programID, frameBlock, FrameUniforms::BINDING);
+        }
+
+        cacheUniformLocations();
     }
 
     //Adds an attribute to our shader. SHould be called between compiling and linking.
@@ -97,33 +109,93 @@ namespace Bengine {
         glBindAttribLocation(_programID, _numAttributes++, attributeName.c_str());
     }
 
+    void GLSLProgram::setTransformFeedbackVaryings(const char* const* varyings, GLsizei count) {
+        glTransformFeedbackVaryings(_programID, count, varyings, GL_INTERLEAVED_ATTRIBS);
+    }
+
     GLint GLSLProgram::getUniformLocation(const std::string& uniformName) {
-        GLint location = glGetUniformLocation(_programID, uniformName.c_str());
-        if (location == GL_INVALID_INDEX) {
+        GLint location = getUniformLocation(hashUniformName(uniformName.c_str()));
+        if (location == -1) {
             fatalError("Uniform " + uniformName + " not found in shader!");
         }
         return location;
     }
 
-    //enable the shader, and all its attributes
-    void GLSLProgram::use() {
-        glUseProgram(_programID);
-        //enable all the attributes we added with addAttribute
-        for (int i = 0; i < _numAttributes; i++) {
-            glEnableVertexAttribArray(i);
+    GLint GLSLProgram::getUniformLocation(GLuint nameHash) const {
+        //Programs have few uniforms, so a linear search beats anything fancier
+        for (const UniformEntry& entry : _uniforms) {
+            if (entry.nameHash == nameHash) {
+                return entry.location;
+            }
         }
+        return -1;
+    }
+
+    //enable the shader
+    void GLSLProgram::use() {
+        GLStateCache::useProgram(_programID);
+        _current = this;
     }
 
-    //disable the shader
+    //The program stays bound until another one is used, so using the same
+    //program again next frame costs nothing. Vertex attributes are enabled by
+    //the VAOs of the batches, not here.
     void GLSLProgram::unuse() {
-        glUseProgram(0);
-        for (int i = 0; i < _numAttributes; i++) {
-            glDisableVertexAttribArray(i);
+        _current = nullptr;
+    }
+
+    const GLSLProgram* GLSLProgram::getCurrent() {
+        if (_current && GLStateCache::getProgram() == _current->_programID) {
+            return _current;
         }
+        return nullptr;
     }
 
     void GLSLProgram::dispose() {
-        if (_programID) glDeleteProgram(_programID);
+        if (_current == this) _current = nullptr;
+        if (_programID) {
+            GLStateCache::forgetProgram(_programID);
+            glDeleteProgram(_programID);
+        }
+        _uniforms.clear();
+    }
+
+    void GLSLProgram::cacheUniformLocations() {
+        _uniforms.clear();
+
+        GLint numUniforms = 0;
+        glGetProgramiv(_programID, GL_ACTIVE_UNIFORMS, &numUniforms);
+        GLint maxLength = 0;
+        glGetProgramiv(_programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        std::vector<char> name(maxLength + 1);
+        for (GLint i = 0; i < numUniforms; i++) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(_programID, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+
+            //Uniforms in blocks have no location
+            GLint location = glGetUniformLocation(_programID, &name[0]);
+            if (location == -1) continue;
+
+            _uniforms.push_back({ hashUniformName(&name[0]), location });
+
+            //Arrays are reported as name[0], but are looked up by name too
+            if (length > 3 && std::string(&name[length - 3]) == "[0]") {
+                name[length - 3] = '\0';
+                _uniforms.push_back({ hashUniformName(&name[0]), location });
+            }
+        }
+
+        //Two names with the same hash would make one of them unreachable
+        for (size_t i = 0; i < _uniforms.size(); i++) {
+            for (size_t j = i + 1; j < _uniforms.size(); j++) {
+                if (_uniforms[i].nameHash == _uniforms[j].nameHash && _uniforms[i].location != _uniforms[j].location) {
+                    fatalError("Two uniforms of a shader have the same name hash!");
+                }
+            }
+        }
     }
 
     //Compiles a single shader file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <GL/glew.h>
 
 namespace Bengine {
@@ -21,16 +22,46 @@ namespace Bengine {
 
         void addAttribute(const std::string& attributeName);
 
+        // Captures the vertex shader outputs named in varyings, interleaved in
+        // that order, during transform feedback. Call between compiling and
+        // linking, like addAttribute.
+        void setTransformFeedbackVaryings(const char* const* varyings, GLsizei count);
+
         GLint getUniformLocation(const std::string& uniformName);
+        // Looks up a uniform by the hashUniformName() of its name. Returns -1 if
+        // the program doesn't have it, like glGetUniformLocation.
+        GLint getUniformLocation(GLuint nameHash) const;
+
+        // FNV-1a hash of a uniform name. It is constexpr, so hashes of literals
+        // can be computed at compile time, e.g. in a constexpr variable.
+        static constexpr GLuint hashUniformName(const char* name, GLuint hash = 2166136261u) {
+            return *name ? hashUniformName(name + 1, (hash ^ (GLubyte)*name) * 16777619u) : hash;
+        }
 
         void use();
         void unuse();
 
         void dispose();
+
+        GLuint getID() const { return _programID; }
+
+        // The program whose use() was called last, if it is still in use
+        static const GLSLProgram* getCurrent();
     private:
 
         int _numAttributes;
 
+        void cacheUniformLocations();
+
+        // The active uniforms, looked up once after linking
+        struct UniformEntry {
+            GLuint nameHash;
+            GLint location;
+        };
+        std::vector<UniformEntry> _uniforms;
+
+        static const GLSLProgram* _current;
+
         void compileShader(const char* source, const std::string& name, GLuint id);
 
         GLuint _programID;
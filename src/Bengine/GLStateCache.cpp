@@ -0,0 +1,130 @@
+#include "GLStateCache.h"
+
+namespace Bengine {
+
+    const GLuint GLStateCache::MAX_TEXTURE_UNITS;
+    const GLuint GLStateCache::UNKNOWN;
+
+    // Nothing is known until it has been set once
+    GLuint GLStateCache::_program = GLStateCache::UNKNOWN;
+    GLuint GLStateCache::_vao = GLStateCache::UNKNOWN;
+    GLuint GLStateCache::_activeUnit = GLStateCache::UNKNOWN;
+    GLuint GLStateCache::_textures[GLStateCache::MAX_TEXTURE_UNITS];
+    GLuint GLStateCache::_arrayTextures[GLStateCache::MAX_TEXTURE_UNITS];
+    GLuint GLStateCache::_blendEnabled = GLStateCache::UNKNOWN;
+    GLuint GLStateCache::_blendSrc = GLStateCache::UNKNOWN;
+    GLuint GLStateCache::_blendDst = GLStateCache::UNKNOWN;
+
+    unsigned int GLStateCache::_numIssued = 0;
+    unsigned int GLStateCache::_numElided = 0;
+
+    // The texture arrays start out zeroed, which would look like unit bindings
+    // of 0, so they are marked unknown before main() too
+    static const bool texturesInvalidated = (GLStateCache::invalidate(), true);
+
+    void GLStateCache::useProgram(GLuint program) {
+        if (changes(_program, program)) {
+            glUseProgram(program);
+        }
+    }
+
+    void GLStateCache::bindVertexArray(GLuint vao) {
+        if (changes(_vao, vao)) {
+            glBindVertexArray(vao);
+        }
+    }
+
+    void GLStateCache::bindTexture(GLenum target, GLuint texture, GLuint unit /* 0 */) {
+        GLuint* cached = nullptr;
+        if (unit < MAX_TEXTURE_UNITS) {
+            if (target == GL_TEXTURE_2D) {
+                cached = &_textures[unit];
+            } else if (target == GL_TEXTURE_2D_ARRAY) {
+                cached = &_arrayTextures[unit];
+            }
+        }
+
+        if (cached == nullptr) {
+            activeTexture(unit);
+            glBindTexture(target, texture);
+            _numIssued++;
+        } else if (changes(*cached, texture)) {
+            activeTexture(unit);
+            glBindTexture(target, texture);
+        }
+    }
+
+    void GLStateCache::setBlendEnabled(bool enabled) {
+        if (changes(_blendEnabled, enabled ? GL_TRUE : GL_FALSE)) {
+            if (enabled) {
+                glEnable(GL_BLEND);
+            } else {
+                glDisable(GL_BLEND);
+            }
+        }
+    }
+
+    void GLStateCache::setBlendFunc(GLenum srcFactor, GLenum dstFactor) {
+        if (_blendSrc == srcFactor && _blendDst == dstFactor) {
+            _numElided++;
+            return;
+        }
+        _blendSrc = srcFactor;
+        _blendDst = dstFactor;
+        glBlendFunc(srcFactor, dstFactor);
+        _numIssued++;
+    }
+
+    void GLStateCache::invalidate() {
+        _program = UNKNOWN;
+        _vao = UNKNOWN;
+        _activeUnit = UNKNOWN;
+        for (GLuint i = 0; i < MAX_TEXTURE_UNITS; i++) {
+            _textures[i] = UNKNOWN;
+            _arrayTextures[i] = UNKNOWN;
+        }
+        _blendEnabled = UNKNOWN;
+        _blendSrc = UNKNOWN;
+        _blendDst = UNKNOWN;
+    }
+
+    void GLStateCache::forgetProgram(GLuint program) {
+        if (_program == program) _program = UNKNOWN;
+    }
+
+    void GLStateCache::forgetVertexArray(GLuint vao) {
+        if (_vao == vao) _vao = UNKNOWN;
+    }
+
+    void GLStateCache::forgetTexture(GLuint texture) {
+        for (GLuint i = 0; i < MAX_TEXTURE_UNITS; i++) {
+            if (_textures[i] == texture) _textures[i] = UNKNOWN;
+            if (_arrayTextures[i] == texture) _arrayTextures[i] = UNKNOWN;
+        }
+    }
+
+    void GLStateCache::resetCounters() {
+        _numIssued = 0;
+        _numElided = 0;
+    }
+
+    bool GLStateCache::changes(GLuint& cached, GLuint value) {
+        if (cached == value) {
+            _numElided++;
+            return false;
+        }
+        cached = value;
+        _numIssued++;
+        return true;
+    }
+
+    void GLStateCache::activeTexture(GLuint unit) {
+        // Only needed on the way to a bind, so skipping it isn't counted as elided
+        if (_activeUnit != unit) {
+            _activeUnit = unit;
+            glActiveTexture(GL_TEXTURE0 + unit);
+            _numIssued++;
+        }
+    }
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <GL/glew.h>
+
+namespace Bengine {
+
+    // Remembers the program, VAO, texture and blend state it set last and skips
+    // calls that would set the same state again. Only works if all of that state
+    // goes through here, so call invalidate() after code that doesn't, like
+    // CEGUI. Must only be used on the thread that has the GL context.
+    class GLStateCache
+    {
+    public:
+        // Texture units whose bindings are tracked. Binds to higher units are
+        // always issued.
+        static const GLuint MAX_TEXTURE_UNITS = 16;
+
+        static void useProgram(GLuint program);
+        static void bindVertexArray(GLuint vao);
+        // Binds texture to target of unit, making unit the active texture unit.
+        // GL_TEXTURE_2D and GL_TEXTURE_2D_ARRAY are tracked, other targets are
+        // always issued.
+        static void bindTexture(GLenum target, GLuint texture, GLuint unit = 0);
+
+        static void setBlendEnabled(bool enabled);
+        static void setBlendFunc(GLenum srcFactor, GLenum dstFactor);
+
+        // Forgets all state, so the next call of each kind is issued
+        static void invalidate();
+
+        // Call these when deleting objects, since GL unbinds them and their
+        // names get reused
+        static void forgetProgram(GLuint program);
+        static void forgetVertexArray(GLuint vao);
+        static void forgetTexture(GLuint texture);
+
+        // The program set last, or 0 when that isn't known
+        static GLuint getProgram() { return _program == UNKNOWN ? 0 : _program; }
+
+        // Calls issued to GL and calls skipped since the last resetCounters()
+        static unsigned int getNumIssued() { return _numIssued; }
+        static unsigned int getNumElided() { return _numElided; }
+        static void resetCounters();
+
+    private:
+        static const GLuint UNKNOWN = 0xffffffff;
+
+        // Returns true and counts the call as issued when cached differs from
+        // value, and stores value
+        static bool changes(GLuint& cached, GLuint value);
+
+        static void activeTexture(GLuint unit);
+
+        static GLuint _program;
+        static GLuint _vao;
+        static GLuint _activeUnit;
+        static GLuint _textures[MAX_TEXTURE_UNITS]; ///< GL_TEXTURE_2D of each unit
+        static GLuint _arrayTextures[MAX_TEXTURE_UNITS]; ///< GL_TEXTURE_2D_ARRAY of each unit
+        static GLuint _blendEnabled;
+        static GLuint _blendSrc;
+        static GLuint _blendDst;
+
+        static unsigned int _numIssued;
+        static unsigned int _numElided;
+    };
+
+}
@@ -0,0 +1,649 @@
+#include "GPUParticleBatch2D.h"
+#include "GLStateCache.h"
+#include "ParticleEmitter2D.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace {
+    const char* UPDATE_VERT_SRC = R"(#version 330
+//Advances one particle per vertex. The outputs are captured by transform
+//feedback into the other state buffer.
+
+in vec4 positionVelocity;
+in vec2 lifeWidth;
+in uint color;
+
+out vec4 outPositionVelocity;
+out vec2 outLifeWidth;
+flat out uint outColor;
+
+uniform vec2 velocityChange; //gravity times the frame time
+uniform float dragScale;
+uniform vec4 turbulence; //strength times the frame time, frequency, x phase and y phase
+uniform float deltaTime;
+uniform float lifeDecay;
+
+//The sine of the CPU kernels, good to about 0.001, so both batches swirl alike
+vec2 fastSin(vec2 radians) {
+    vec2 t = radians * 0.159154943;
+    t -= trunc(t + sign(t) * 0.5);
+    vec2 y = 8.0 * t - 16.0 * t * abs(t);
+    return 0.225 * (y * abs(y) - y) + y;
+}
+
+void main() {
+    vec2 position = positionVelocity.xy;
+    vec2 velocity = (positionVelocity.zw + velocityChange) * dragScale;
+    velocity += turbulence.x * fastSin(position.yx * turbulence.y + turbulence.zw);
+
+    outPositionVelocity = vec4(position + velocity * deltaTime, velocity);
+    outLifeWidth = vec2(lifeWidth.x - lifeDecay, lifeWidth.y);
+    outColor = color;
+})";
+
+    const char* SPAWN_VERT_SRC = R"(#version 330
+//Makes one new particle per vertex from the settings of an emitter, with the
+//random numbers and approximations ParticleEmitter2D uses on the CPU. The
+//outputs are captured by transform feedback into the free slots.
+
+out vec4 outPositionVelocity;
+out vec2 outLifeWidth;
+flat out uint outColor;
+
+uniform uvec2 randomStream; //seed and the position of the first value of the spawn
+uniform uint spawnCount; //the length of each run of random values
+uniform int shape; //EmitterShape
+uniform vec2 emitterPosition;
+uniform float radius;
+uniform vec4 boxRange; //smallest x and y, and the ranges of both
+uniform vec2 angleRange; //smallest angle and the range
+uniform vec2 speedRange;
+uniform vec2 widthRange;
+uniform vec4 colorB; //0 to 255
+uniform vec4 colorRange; //colorA minus colorB
+
+const float HALF_PI = 1.57079633;
+const float TWO_PI = 6.28318531;
+const int CIRCLE = 1;
+const int BOX = 2;
+const int CONE = 3;
+
+//Squirrel3, the hash of the CPU kernels
+uint squirrelNoise(uint position, uint seed) {
+    uint bits = position * 0xb5297a4du;
+    bits += seed;
+    bits ^= bits >> 8;
+    bits += 0x68e31da4u;
+    bits ^= bits << 8;
+    bits *= 0x1b56c4e9u;
+    bits ^= bits >> 8;
+    return bits;
+}
+
+//Value gl_VertexID of the given run of spawnCount values, in [0, 1)
+float randomValue(uint run) {
+    uint bits = squirrelNoise(randomStream.y + run * spawnCount + uint(gl_VertexID), randomStream.x);
+    return uintBitsToFloat((bits >> 9) | 0x3f800000u) - 1.0;
+}
+
+//The sine of the CPU kernels, good to about 0.001
+vec2 fastSin(vec2 radians) {
+    vec2 t = radians * 0.159154943;
+    t -= trunc(t + sign(t) * 0.5);
+    vec2 y = 8.0 * t - 16.0 * t * abs(t);
+    return 0.225 * (y * abs(y) - y) + y;
+}
+
+void main() {
+    float angle = angleRange.x + angleRange.y * randomValue(0u);
+    float speed = speedRange.x + speedRange.y * randomValue(1u);
+    vec2 velocity = speed * fastSin(vec2(angle + HALF_PI, angle));
+
+    vec2 position = emitterPosition;
+    uint run = 2u;
+    if (shape == CIRCLE) {
+        float positionAngle = TWO_PI * randomValue(2u);
+        float distance = radius * max(randomValue(3u), randomValue(4u));
+        position += distance * fastSin(vec2(positionAngle + HALF_PI, positionAngle));
+        run = 5u;
+    } else if (shape == BOX) {
+        position = boxRange.xy + boxRange.zw * vec2(randomValue(2u), randomValue(3u));
+        run = 4u;
+    } else if (shape == CONE) {
+        float distance = radius * max(randomValue(2u), randomValue(3u));
+        position += distance * fastSin(vec2(angle + HALF_PI, angle));
+        run = 4u;
+    }
+
+    float width = widthRange.x + widthRange.y * randomValue(run);
+    uvec4 color = uvec4(colorB + colorRange * randomValue(run + 1u) + 0.5);
+
+    outPositionVelocity = vec4(position, velocity);
+    outLifeWidth = vec2(1.0, width);
+    outColor = color.r | (color.g << 8) | (color.b << 16) | (color.a << 24);
+})";
+
+    //Nothing is rasterized during the update, but a program needs one
+    const char* UPDATE_FRAG_SRC = R"(#version 330
+
+out vec4 color;
+
+void main() {
+    color = vec4(0.0);
+})";
+
+    const char* RENDER_VERT_SRC = R"(#version 330
+//Draws one quad per particle instance, straight from the state buffer
+
+in vec4 positionVelocity;
+in vec2 lifeWidth;
+in vec4 particleColor;
+
+out vec2 fragmentUV;
+out vec4 fragmentColor;
+
+//Per frame data from FrameUniforms, shared by every program
+layout(std140) uniform FrameUniforms {
+    mat4 viewProjection;
+    vec4 viewport; //x, y, width and height in pixels
+    float time;
+} frame;
+
+uniform vec4 startColor;
+uniform vec4 endColor;
+uniform vec2 widthOverLife; //width at full life and at death
+uniform vec2 overLife; //1 where color and size over life are on, else 0
+
+void main() {
+    //The corners of the triangle strip are (0, 0), (1, 0), (0, 1) and (1, 1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    float t = clamp(lifeWidth.x, 0.0, 1.0);
+    float width = mix(lifeWidth.y, mix(widthOverLife.y, widthOverLife.x, t), overLife.y);
+    vec2 position = positionVelocity.xy + corner * width;
+
+    gl_Position = vec4((frame.viewProjection * vec4(position, 0.0, 1.0)).xy, 0.0, 1.0);
+    fragmentUV = corner;
+    fragmentColor = mix(particleColor, mix(endColor, startColor, t), overLife.x);
+})";
+
+    const char* RENDER_FRAG_SRC = R"(#version 330
+
+in vec2 fragmentUV;
+in vec4 fragmentColor;
+
+out vec4 color;
+
+uniform sampler2D mySampler;
+
+void main() {
+    color = texture(mySampler, fragmentUV) * fragmentColor;
+})";
+
+    const char* const UPDATE_VARYINGS[] = { "outPositionVelocity", "outLifeWidth", "outColor" };
+
+    glm::vec4 toVec4(const Bengine::ColorRGBA8& color) {
+        return glm::vec4(color.r, color.g, color.b, color.a) / 255.0f;
+    }
+
+    glm::vec4 toBytes(const Bengine::ColorRGBA8& color) {
+        return glm::vec4(color.r, color.g, color.b, color.a);
+    }
+}
+
+namespace Bengine {
+
+    GPUParticleBatch2D::GPUParticleBatch2D() :
+        m_gravity(glm::vec2(0.0f)),
+        m_drag(0.0f),
+        m_turbulence(0.0f, 0.0f),
+        m_colorOverLife(ColorRGBA8(), ColorRGBA8()),
+        m_sizeOverLife(0.0f, 0.0f) {
+        // Empty
+    }
+
+    GPUParticleBatch2D::~GPUParticleBatch2D() {
+        dispose();
+    }
+
+    void GPUParticleBatch2D::init(int maxParticles, float decayRate, GLTexture texture) {
+        static_assert(sizeof(GPUParticle) == 28, "The buffers are read as 7 tightly packed values per particle");
+
+        m_decayRate = decayRate;
+        m_texture = texture;
+
+        m_updateProgram.compileShadersFromSource(UPDATE_VERT_SRC, UPDATE_FRAG_SRC);
+        m_updateProgram.addAttribute("positionVelocity");
+        m_updateProgram.addAttribute("lifeWidth");
+        m_updateProgram.addAttribute("color");
+        m_updateProgram.setTransformFeedbackVaryings(UPDATE_VARYINGS, 3);
+        m_updateProgram.linkShaders();
+        m_velocityChangeLocation = m_updateProgram.getUniformLocation("velocityChange");
+        m_dragScaleLocation = m_updateProgram.getUniformLocation("dragScale");
+        m_turbulenceLocation = m_updateProgram.getUniformLocation("turbulence");
+        m_deltaTimeLocation = m_updateProgram.getUniformLocation("deltaTime");
+        m_lifeDecayLocation = m_updateProgram.getUniformLocation("lifeDecay");
+
+        m_spawnProgram.compileShadersFromSource(SPAWN_VERT_SRC, UPDATE_FRAG_SRC);
+        m_spawnProgram.setTransformFeedbackVaryings(UPDATE_VARYINGS, 3);
+        m_spawnProgram.linkShaders();
+        m_randomStreamLocation = m_spawnProgram.getUniformLocation("randomStream");
+        m_spawnCountLocation = m_spawnProgram.getUniformLocation("spawnCount");
+        m_shapeLocation = m_spawnProgram.getUniformLocation("shape");
+        m_emitterPositionLocation = m_spawnProgram.getUniformLocation("emitterPosition");
+        m_radiusLocation = m_spawnProgram.getUniformLocation("radius");
+        m_boxRangeLocation = m_spawnProgram.getUniformLocation("boxRange");
+        m_angleRangeLocation = m_spawnProgram.getUniformLocation("angleRange");
+        m_speedRangeLocation = m_spawnProgram.getUniformLocation("speedRange");
+        m_widthRangeLocation = m_spawnProgram.getUniformLocation("widthRange");
+        m_colorBLocation = m_spawnProgram.getUniformLocation("colorB");
+        m_colorRangeLocation = m_spawnProgram.getUniformLocation("colorRange");
+
+        m_renderProgram.compileShadersFromSource(RENDER_VERT_SRC, RENDER_FRAG_SRC);
+        m_renderProgram.addAttribute("positionVelocity");
+        m_renderProgram.addAttribute("lifeWidth");
+        m_renderProgram.addAttribute("particleColor");
+        m_renderProgram.linkShaders();
+        m_startColorLocation = m_renderProgram.getUniformLocation("startColor");
+        m_endColorLocation = m_renderProgram.getUniformLocation("endColor");
+        m_widthOverLifeLocation = m_renderProgram.getUniformLocation("widthOverLife");
+        m_overLifeLocation = m_renderProgram.getUniformLocation("overLife");
+
+        glGenVertexArrays(2, m_updateVaos);
+        glGenVertexArrays(1, &m_renderVao);
+        // The spawn reads no attributes, but a vertex array has to be bound
+        glGenVertexArrays(1, &m_spawnVao);
+
+        // One set of attributes per quad. draw() points them at the live particles.
+        GLStateCache::bindVertexArray(m_renderVao);
+        for (GLuint i = 0; i < 3; i++) {
+            glEnableVertexAttribArray(i);
+            glVertexAttribDivisor(i, 1);
+        }
+        GLStateCache::bindVertexArray(0);
+
+        createBuffers(maxParticles);
+    }
+
+    void GPUParticleBatch2D::dispose() {
+        if (m_renderVao == 0) return;
+
+        deleteBuffers();
+        for (GLuint vao : m_updateVaos) {
+            GLStateCache::forgetVertexArray(vao);
+        }
+        GLStateCache::forgetVertexArray(m_renderVao);
+        GLStateCache::forgetVertexArray(m_spawnVao);
+        glDeleteVertexArrays(2, m_updateVaos);
+        glDeleteVertexArrays(1, &m_renderVao);
+        glDeleteVertexArrays(1, &m_spawnVao);
+        m_updateVaos[0] = m_updateVaos[1] = 0;
+        m_renderVao = 0;
+        m_spawnVao = 0;
+
+        m_updateProgram.dispose();
+        m_spawnProgram.dispose();
+        m_renderProgram.dispose();
+
+        m_capacity = 0;
+        m_next = 0;
+        m_numAlive = 0;
+        m_groups.clear();
+        m_newParticles.clear();
+    }
+
+    void GPUParticleBatch2D::update(float deltaTime) {
+        uploadNewParticles();
+        m_turbulence.advance(deltaTime);
+
+        // The shader takes the same lifeDecay off every particle, so a group
+        // runs out of life exactly when its particles do
+        const float lifeDecay = m_decayRate * deltaTime;
+        for (auto& group : m_groups) {
+            group.life -= lifeDecay;
+        }
+        while (!m_groups.empty() && m_groups.front().life <= 0.0f) {
+            m_numAlive -= m_groups.front().count;
+            m_groups.pop_front();
+        }
+        if (m_numAlive == 0) return;
+
+        m_updateProgram.use();
+        glm::vec2 velocityChange = m_gravity.acceleration * deltaTime;
+        glUniform2f(m_velocityChangeLocation, velocityChange.x, velocityChange.y);
+        // Never turns particles around, however long the frame
+        glUniform1f(m_dragScaleLocation, std::max(1.0f - m_drag.drag * deltaTime, 0.0f));
+        glUniform4f(m_turbulenceLocation, m_turbulence.strength * deltaTime, m_turbulence.frequency,
+                    m_turbulence.getPhaseX(), m_turbulence.getPhaseY());
+        glUniform1f(m_deltaTimeLocation, deltaTime);
+        glUniform1f(m_lifeDecayLocation, lifeDecay);
+
+        // Each live particle is written to the same slot of the other buffer
+        glEnable(GL_RASTERIZER_DISCARD);
+        GLStateCache::bindVertexArray(m_updateVaos[m_current]);
+        GLuint target = m_buffers[1 - m_current];
+        forLiveRanges([target](size_t first, size_t count) {
+            glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, target,
+                              first * sizeof(GPUParticle), count * sizeof(GPUParticle));
+            glBeginTransformFeedback(GL_POINTS);
+            glDrawArrays(GL_POINTS, (GLint)first, (GLsizei)count);
+            glEndTransformFeedback();
+        });
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glDisable(GL_RASTERIZER_DISCARD);
+        m_updateProgram.unuse();
+
+        m_current = 1 - m_current;
+    }
+
+    void GPUParticleBatch2D::skipAhead(size_t numSteps, float stepTime) {
+        // The slots stay where they are, so only the bookkeeping is dropped
+        m_numAlive = 0;
+        m_groups.clear();
+        m_newParticles.clear();
+        for (size_t step = 0; step < numSteps; step++) {
+            m_turbulence.advance(stepTime);
+        }
+    }
+
+    void GPUParticleBatch2D::draw(SpriteBatch*) {
+        uploadNewParticles();
+        if (m_numAlive == 0) return;
+
+        m_renderProgram.use();
+        glm::vec4 startColor = toVec4(m_colorOverLife.startColor);
+        glm::vec4 endColor = toVec4(m_colorOverLife.endColor);
+        glUniform4fv(m_startColorLocation, 1, &startColor[0]);
+        glUniform4fv(m_endColorLocation, 1, &endColor[0]);
+        glUniform2f(m_widthOverLifeLocation, m_sizeOverLife.startWidth, m_sizeOverLife.endWidth);
+        glUniform2f(m_overLifeLocation, m_useColorOverLife ? 1.0f : 0.0f, m_useSizeOverLife ? 1.0f : 0.0f);
+
+        setParticleBlendFunc(m_blendMode);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, m_texture.id, 0);
+        GLStateCache::bindVertexArray(m_renderVao);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffers[m_current]);
+        forLiveRanges([](size_t first, size_t count) {
+            // Instances always start at the front of the attributes, so they
+            // are pointed at the range instead
+            const char* base = (const char*)(first * sizeof(GPUParticle));
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GPUParticle), base + offsetof(GPUParticle, positionVelocity));
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GPUParticle), base + offsetof(GPUParticle, lifeWidth));
+            glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GPUParticle), base + offsetof(GPUParticle, color));
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)count);
+        });
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        setParticleBlendFunc(ParticleBlendMode::ALPHA);
+        m_renderProgram.unuse();
+    }
+
+    void GPUParticleBatch2D::addParticle(const glm::vec2& position,
+                                         const glm::vec2& velocity,
+                                         const ColorRGBA8& color,
+                                         float width) {
+        size_t skipped;
+        if (makeRoom(1, skipped) == 0) return;
+
+        GPUParticle particle;
+        particle.positionVelocity = glm::vec4(position, velocity);
+        particle.lifeWidth = glm::vec2(1.0f, width);
+        particle.color = color;
+        m_newParticles.push_back(particle);
+    }
+
+    void GPUParticleBatch2D::addParticles(const float* x, const float* y, const float* vx, const float* vy,
+                                          const ColorRGBA8* color, const float* width, size_t count) {
+        size_t skipped;
+        count = makeRoom(count, skipped);
+
+        const size_t first = m_newParticles.size();
+        m_newParticles.resize(first + count);
+        for (size_t k = 0; k < count; k++) {
+            const size_t i = skipped + k;
+            GPUParticle& particle = m_newParticles[first + k];
+            particle.positionVelocity = glm::vec4(x[i], y[i], vx[i], vy[i]);
+            particle.lifeWidth = glm::vec2(1.0f, width[i]);
+            particle.color = color[i];
+        }
+    }
+
+    bool GPUParticleBatch2D::spawnParticles(const ParticleSpawn& spawn, size_t count) {
+        // Particles spawned before init() are dropped, like added ones
+        if (m_renderVao == 0) return true;
+
+        // Particles added before the spawn take the slots before it
+        uploadNewParticles();
+        const size_t spawnCount = count;
+        size_t skipped;
+        count = makeRoom(count, skipped);
+        if (count == 0) return true;
+
+        m_spawnProgram.use();
+        glUniform2ui(m_randomStreamLocation, spawn.random.seed, spawn.random.position);
+        glUniform1ui(m_spawnCountLocation, (GLuint)spawnCount);
+        glUniform1i(m_shapeLocation, (GLint)spawn.shape);
+        glUniform2f(m_emitterPositionLocation, spawn.position.x, spawn.position.y);
+        glUniform1f(m_radiusLocation, spawn.radius);
+        // The same bounds and ranges the emitter's kernels work out
+        const float minAngle = spawn.direction - spawn.spread * 0.5f;
+        const float maxAngle = spawn.direction + spawn.spread * 0.5f;
+        glUniform2f(m_angleRangeLocation, minAngle, maxAngle - minAngle);
+        glUniform2f(m_speedRangeLocation, spawn.minSpeed, spawn.maxSpeed - spawn.minSpeed);
+        const glm::vec2 halfDims = spawn.dimensions * 0.5f;
+        const glm::vec2 minBox = spawn.position - halfDims;
+        const glm::vec2 maxBox = spawn.position + halfDims;
+        glUniform4f(m_boxRangeLocation, minBox.x, minBox.y, maxBox.x - minBox.x, maxBox.y - minBox.y);
+        glUniform2f(m_widthRangeLocation, spawn.minWidth, spawn.maxWidth - spawn.minWidth);
+        const glm::vec4 colorB = toBytes(spawn.colorB);
+        const glm::vec4 colorRange = toBytes(spawn.colorA) - colorB;
+        glUniform4fv(m_colorBLocation, 1, &colorB[0]);
+        glUniform4fv(m_colorRangeLocation, 1, &colorRange[0]);
+
+        glEnable(GL_RASTERIZER_DISCARD);
+        GLStateCache::bindVertexArray(m_spawnVao);
+        GLuint target = m_buffers[m_current];
+        auto spawnRange = [target](size_t firstSlot, size_t firstParticle, size_t numParticles) {
+            glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, target,
+                              firstSlot * sizeof(GPUParticle), numParticles * sizeof(GPUParticle));
+            glBeginTransformFeedback(GL_POINTS);
+            // gl_VertexID counts from the first vertex, so it is the index in the spawn
+            glDrawArrays(GL_POINTS, (GLint)firstParticle, (GLsizei)numParticles);
+            glEndTransformFeedback();
+        };
+        // The new slots wrap around to the front at the end of the buffer
+        const size_t beforeEnd = std::min(count, m_capacity - m_next);
+        spawnRange(m_next, skipped, beforeEnd);
+        if (count > beforeEnd) {
+            spawnRange(0, skipped + beforeEnd, count - beforeEnd);
+        }
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glDisable(GL_RASTERIZER_DISCARD);
+        m_spawnProgram.unuse();
+
+        addNewSlots(count);
+        return true;
+    }
+
+    void GPUParticleBatch2D::setModule(const ColorOverLifeModule& module) {
+        m_colorOverLife = module;
+        m_useColorOverLife = true;
+    }
+
+    void GPUParticleBatch2D::setModule(const SizeOverLifeModule& module) {
+        m_sizeOverLife = module;
+        m_useSizeOverLife = true;
+    }
+
+    void GPUParticleBatch2D::clearModules() {
+        m_gravity = GravityModule(glm::vec2(0.0f));
+        m_drag = DragModule(0.0f);
+        m_turbulence = TurbulenceModule(0.0f, 0.0f);
+        m_useColorOverLife = false;
+        m_useSizeOverLife = false;
+    }
+
+    void GPUParticleBatch2D::readParticles(std::vector<Particle2D>& particles) {
+        uploadNewParticles();
+
+        std::vector<GPUParticle> state(m_numAlive);
+        size_t numRead = 0;
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffers[m_current]);
+        forLiveRanges([&state, &numRead](size_t first, size_t count) {
+            glGetBufferSubData(GL_ARRAY_BUFFER, first * sizeof(GPUParticle), count * sizeof(GPUParticle), &state[numRead]);
+            numRead += count;
+        });
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        particles.resize(m_numAlive);
+        for (size_t i = 0; i < m_numAlive; i++) {
+            particles[i].position = glm::vec2(state[i].positionVelocity.x, state[i].positionVelocity.y);
+            particles[i].velocity = glm::vec2(state[i].positionVelocity.z, state[i].positionVelocity.w);
+            particles[i].life = state[i].lifeWidth.x;
+            particles[i].width = state[i].lifeWidth.y;
+            particles[i].color = state[i].color;
+        }
+    }
+
+    void GPUParticleBatch2D::createBuffers(size_t capacity) {
+        m_capacity = capacity;
+        glGenBuffers(2, m_buffers);
+        for (int i = 0; i < 2; i++) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffers[i]);
+            glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GPUParticle), nullptr, GL_DYNAMIC_COPY);
+
+            GLStateCache::bindVertexArray(m_updateVaos[i]);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GPUParticle), (void*)offsetof(GPUParticle, positionVelocity));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GPUParticle), (void*)offsetof(GPUParticle, lifeWidth));
+            // Passed through as an integer, so no color is changed by the round trip
+            glEnableVertexAttribArray(2);
+            glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(GPUParticle), (void*)offsetof(GPUParticle, color));
+        }
+        GLStateCache::bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void GPUParticleBatch2D::deleteBuffers() {
+        glDeleteBuffers(2, m_buffers);
+        m_buffers[0] = m_buffers[1] = 0;
+    }
+
+    void GPUParticleBatch2D::grow(size_t minCapacity) {
+        GLuint oldBuffer = m_buffers[m_current];
+        GLuint otherBuffer = m_buffers[1 - m_current];
+        size_t numAlive = m_numAlive;
+
+        // Collect the ranges while the old capacity still describes them
+        size_t ranges[2][2];
+        size_t numRanges = 0;
+        forLiveRanges([&ranges, &numRanges](size_t first, size_t count) {
+            ranges[numRanges][0] = first;
+            ranges[numRanges][1] = count;
+            numRanges++;
+        });
+
+        createBuffers(std::max(m_capacity * 2, minCapacity));
+
+        // The live particles go to the front of the new buffer, oldest first
+        glBindBuffer(GL_COPY_READ_BUFFER, oldBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffers[0]);
+        size_t written = 0;
+        for (size_t i = 0; i < numRanges; i++) {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, ranges[i][0] * sizeof(GPUParticle),
+                                written * sizeof(GPUParticle), ranges[i][1] * sizeof(GPUParticle));
+            written += ranges[i][1];
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glDeleteBuffers(1, &oldBuffer);
+        glDeleteBuffers(1, &otherBuffer);
+        m_current = 0;
+        m_next = numAlive;
+    }
+
+    void GPUParticleBatch2D::removeOldest(size_t count) {
+        m_numAlive -= count;
+        while (count > 0) {
+            ParticleGroup& oldest = m_groups.front();
+            const size_t numRemoved = std::min(count, oldest.count);
+            oldest.count -= numRemoved;
+            count -= numRemoved;
+            if (oldest.count == 0) {
+                m_groups.pop_front();
+            }
+        }
+    }
+
+    size_t GPUParticleBatch2D::makeRoom(size_t count, size_t& skipped) {
+        skipped = 0;
+        const size_t numFree = m_capacity - getNumAlive();
+        if (count <= numFree) return count;
+
+        switch (m_poolFullPolicy) {
+            case ParticlePoolFullPolicy::DROP_NEW:
+                return numFree;
+            case ParticlePoolFullPolicy::REPLACE_OLDEST:
+                // Only the last m_capacity of them would survive
+                if (count > m_capacity) {
+                    skipped = count - m_capacity;
+                    count = m_capacity;
+                }
+                // The oldest particles have to be on the GPU to be replaced.
+                // Their slots are the ones the new particles go to.
+                uploadNewParticles();
+                removeOldest(count - (m_capacity - m_numAlive));
+                return count;
+            case ParticlePoolFullPolicy::GROW:
+                if (m_renderVao == 0) return 0;
+                uploadNewParticles();
+                grow(m_numAlive + count);
+                return count;
+        }
+        return count;
+    }
+
+    void GPUParticleBatch2D::uploadNewParticles() {
+        const size_t count = m_newParticles.size();
+        // Nothing fits before init(), or in a batch inited with no room
+        if (count == 0 || m_capacity == 0) return;
+
+        // The new slots wrap around to the front at the end of the buffer
+        const size_t beforeEnd = std::min(count, m_capacity - m_next);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffers[m_current]);
+        glBufferSubData(GL_ARRAY_BUFFER, m_next * sizeof(GPUParticle), beforeEnd * sizeof(GPUParticle), m_newParticles.data());
+        if (count > beforeEnd) {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, (count - beforeEnd) * sizeof(GPUParticle), m_newParticles.data() + beforeEnd);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        m_newParticles.clear();
+        addNewSlots(count);
+    }
+
+    void GPUParticleBatch2D::addNewSlots(size_t count) {
+        m_next = (m_next + count) % m_capacity;
+        m_numAlive += count;
+        // Particles added before the same update die together
+        if (!m_groups.empty() && m_groups.back().life == 1.0f) {
+            m_groups.back().count += count;
+        } else {
+            m_groups.push_back({ count, 1.0f });
+        }
+    }
+
+    template<typename RangeFunc>
+    void GPUParticleBatch2D::forLiveRanges(RangeFunc rangeFunc) {
+        if (m_numAlive == 0 || m_capacity == 0) return;
+
+        // The live particles are the m_numAlive slots before m_next
+        const size_t first = (m_next + m_capacity - m_numAlive) % m_capacity;
+        const size_t count = std::min(m_numAlive, m_capacity - first);
+        rangeFunc(first, count);
+        if (m_numAlive > count) {
+            rangeFunc(0, m_numAlive - count);
+        }
+    }
+
+}
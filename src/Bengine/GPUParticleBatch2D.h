@@ -0,0 +1,188 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <deque>
+#include <vector>
+
+#include "GLSLProgram.h"
+#include "GLTexture.h"
+#include "IParticleBatch2D.h"
+#include "ParticleModules.h"
+#include "ParticlePool2D.h"
+#include "Vertex.h"
+
+namespace Bengine {
+
+    // A particle batch whose particles live in GPU buffers. update() moves
+    // them with a vertex shader whose outputs are captured by transform
+    // feedback into a second buffer, and draw() renders the quads straight
+    // from that buffer, so the particles never cross the bus again after
+    // being added. Needs GL 3.3 for instancing.
+    //
+    // Emitters don't send particles either. A ParticleEmitter2D hands its
+    // settings and the position of its random stream to spawnParticles(), and
+    // a spawn shader makes the particles in their slots with the same random
+    // numbers and sine approximation as the CPU would, to float rounding, so
+    // a spawn only costs a few uniforms whatever its count. Only addParticle()
+    // and addParticles() upload the 28 bytes of each particle.
+    //
+    // The particles take the slots of a ring buffer in the order they are
+    // added. Since they all lose life at the same rate, the live ones are
+    // always the newest slots, and the CPU knows which those are without
+    // reading anything back.
+    class GPUParticleBatch2D : public IParticleBatch2D {
+    public:
+        GPUParticleBatch2D();
+        ~GPUParticleBatch2D();
+
+        void init(int maxParticles, float decayRate, GLTexture texture);
+        void dispose();
+
+        void update(float deltaTime) override;
+
+        // Renders right away with the view projection of the FrameUniforms, so
+        // the particles go on top of whatever was rendered before. Blends with
+        // the batch's blend mode and sets the ALPHA function back afterwards.
+        // The program is unused afterwards, like the other renderers do.
+        void draw(SpriteBatch* spriteBatch) override;
+
+        // Only the new particles are uploaded, at the next update() or draw().
+        // Particles added before init(), or to a batch of no capacity that
+        // can't grow, are dropped.
+        void addParticle(const glm::vec2& position,
+                         const glm::vec2& velocity,
+                         const ColorRGBA8& color,
+                         float width) override;
+        void addParticles(const float* x, const float* y, const float* vx, const float* vy,
+                          const ColorRGBA8* color, const float* width, size_t count) override;
+        // Writes the particles into their slots on the GPU right away, after
+        // uploading the ones added before. Follows the pool full policy like
+        // addParticles(). Always returns true.
+        bool spawnParticles(const ParticleSpawn& spawn, size_t count) override;
+
+        // REPLACE_OLDEST by default
+        void setPoolFullPolicy(ParticlePoolFullPolicy policy) override { m_poolFullPolicy = policy; }
+
+        // The particles are never sorted, whatever the mode
+        void setBlendMode(ParticleBlendMode blendMode) override { m_blendMode = blendMode; }
+        ParticleBlendMode getBlendMode() const override { return m_blendMode; }
+
+        void setSpawnScale(float spawnScale) override { m_spawnScale = spawnScale; }
+        float getSpawnScale() const override { return m_spawnScale; }
+
+        size_t getNumAlive() const override { return m_numAlive + m_newParticles.size(); }
+        size_t getLifetimeSteps(float stepTime) const override { return countParticleLifetimeSteps(m_decayRate, stepTime); }
+        void skipAhead(size_t numSteps, float stepTime) override;
+        size_t getCapacity() const { return m_capacity; }
+
+        // The modules the GPU runs, with the same settings as on the CPU. The
+        // shader applies gravity, drag and turbulence in that order, and then
+        // moves the particles, with the same sine approximation as the CPU
+        // kernels, so only float rounding can tell the two apart, e.g. where
+        // the shader compiler fuses multiplies and adds.
+        // bench/gpu_particle_bench.cpp allows 1e-3 of the values for that.
+        // GLSL's own sin would be off by several percent after 100 updates.
+        // Color and size over life are worked out when drawing.
+        // Setting a module again replaces it.
+        void setModule(const GravityModule& module) { m_gravity = module; }
+        void setModule(const DragModule& module) { m_drag = module; }
+        void setModule(const TurbulenceModule& module) { m_turbulence = module; }
+        void setModule(const ColorOverLifeModule& module);
+        void setModule(const SizeOverLifeModule& module);
+        void clearModules();
+
+        // Reads the live particles back from the GPU, oldest first. Stalls
+        // until the GPU is done, so it is only meant for tests and tools.
+        void readParticles(std::vector<Particle2D>& particles);
+
+    private:
+        // One particle as the buffers store it
+        struct GPUParticle {
+            glm::vec4 positionVelocity;
+            glm::vec2 lifeWidth;
+            ColorRGBA8 color;
+        };
+
+        // Particles added between the same two updates, which all have the
+        // same life left
+        struct ParticleGroup {
+            size_t count;
+            float life;
+        };
+
+        // Creates both buffers with room for capacity particles and points the
+        // vertex arrays at them
+        void createBuffers(size_t capacity);
+        void deleteBuffers();
+        // Doubles the capacity, or more to reach minCapacity, moving the live
+        // particles to the front
+        void grow(size_t minCapacity);
+        // Kills the count particles with the least life. They must be on the GPU.
+        void removeOldest(size_t count);
+        // Frees slots for count new particles as the pool full policy says.
+        // Returns how many of them get one, and sets skipped to how many at
+        // the front of them don't.
+        size_t makeRoom(size_t count, size_t& skipped);
+        // Uploads the particles added since the last call into their slots
+        void uploadNewParticles();
+        // Counts the count slots from m_next on, just written, as new particles
+        void addNewSlots(size_t count);
+        // Calls rangeFunc(first, count) for the one or two runs of slots the
+        // live particles take
+        template<typename RangeFunc>
+        void forLiveRanges(RangeFunc rangeFunc);
+
+        GLSLProgram m_updateProgram;
+        GLSLProgram m_spawnProgram;
+        GLSLProgram m_renderProgram;
+        GLuint m_buffers[2] = { 0, 0 }; ///< The state read by the next update and the one it writes
+        GLuint m_updateVaos[2] = { 0, 0 }; ///< Reads m_buffers[i] for the update
+        GLuint m_renderVao = 0;
+        GLuint m_spawnVao = 0; ///< Has no attributes, the spawn only uses gl_VertexID
+        int m_current = 0; ///< The buffer with the latest state
+
+        // Uniform locations of the programs
+        GLint m_velocityChangeLocation = -1;
+        GLint m_dragScaleLocation = -1;
+        GLint m_turbulenceLocation = -1;
+        GLint m_deltaTimeLocation = -1;
+        GLint m_lifeDecayLocation = -1;
+        GLint m_randomStreamLocation = -1;
+        GLint m_spawnCountLocation = -1;
+        GLint m_shapeLocation = -1;
+        GLint m_emitterPositionLocation = -1;
+        GLint m_radiusLocation = -1;
+        GLint m_boxRangeLocation = -1;
+        GLint m_angleRangeLocation = -1;
+        GLint m_speedRangeLocation = -1;
+        GLint m_widthRangeLocation = -1;
+        GLint m_colorBLocation = -1;
+        GLint m_colorRangeLocation = -1;
+        GLint m_startColorLocation = -1;
+        GLint m_endColorLocation = -1;
+        GLint m_widthOverLifeLocation = -1;
+        GLint m_overLifeLocation = -1;
+
+        size_t m_capacity = 0;
+        size_t m_next = 0; ///< The slot the next new particle goes to
+        size_t m_numAlive = 0; ///< Live particles on the GPU, the ones before m_next
+        std::deque<ParticleGroup> m_groups; ///< The live particles, oldest first
+        std::vector<GPUParticle> m_newParticles; ///< Added, but not uploaded yet
+
+        float m_decayRate = 0.1f;
+        GLTexture m_texture;
+        ParticlePoolFullPolicy m_poolFullPolicy = ParticlePoolFullPolicy::REPLACE_OLDEST;
+        ParticleBlendMode m_blendMode = ParticleBlendMode::ALPHA;
+        float m_spawnScale = 1.0f;
+
+        GravityModule m_gravity;
+        DragModule m_drag;
+        TurbulenceModule m_turbulence;
+        ColorOverLifeModule m_colorOverLife;
+        SizeOverLifeModule m_sizeOverLife;
+        bool m_useColorOverLife = false;
+        bool m_useSizeOverLife = false;
+    };
+
+}
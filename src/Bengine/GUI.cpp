@@ -2,6 +2,7 @@
 #include <GL/glew.h> // Include BEFORE GUI.h
 
 #include "GUI.h"
+#include "GLStateCache.h"
 
 #include <iostream>
 
@@ -44,15 +45,18 @@ void Bengine::GUI::destroy() {
 
 void Bengine::GUI::draw() {
     glDisable(GL_DEPTH_TEST);
+    // Our batches leave their VAOs bound, keep CEGUI from changing them
+    Bengine::GLStateCache::bindVertexArray(0);
     m_renderer->beginRendering();
     m_context->draw();
     m_renderer->endRendering();
-    // Clean up after CEGUI
-    glBindVertexArray(0);
+    // Clean up after CEGUI. It changed state behind the cache's back.
+    Bengine::GLStateCache::invalidate();
+    Bengine::GLStateCache::bindVertexArray(0);
     glDisable(GL_SCISSOR_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    Bengine::GLStateCache::setBlendEnabled(true);
+    Bengine::GLStateCache::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    Bengine::GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
     glDisableClientState(GL_VERTEX_ARRAY);
     glDisableClientState(GL_COLOR_ARRAY);
     glDisableClientState(GL_TEXTURE_COORD_ARRAY);
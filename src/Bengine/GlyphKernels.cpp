@@ -0,0 +1,477 @@
+#include "GlyphKernels.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define BENGINE_GLYPH_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BENGINE_GLYPH_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BENGINE_GLYPH_NEON
+#endif
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#define BENGINE_GLYPH_F16C
+#endif
+
+namespace Bengine {
+
+namespace {
+
+    // Scalar corners for quads [begin, end). stride is the total quad count,
+    // which separates the four corner arrays.
+    void computeCornersRange(const glm::vec4* destRects, const float* cosines, const float* sines,
+                             size_t begin, size_t end, size_t stride, Position* corners) {
+        Position* tl = corners;
+        Position* bl = corners + stride;
+        Position* br = corners + stride * 2;
+        Position* tr = corners + stride * 3;
+
+        for (size_t i = begin; i < end; i++) {
+            const glm::vec4& r = destRects[i];
+            float halfW = r.z * 0.5f;
+            float halfH = r.w * 0.5f;
+            float cx = r.x + halfW;
+            float cy = r.y + halfH;
+
+            // Rotating (+-halfW, +-halfH) only needs these four products
+            float a = halfW * cosines[i];
+            float b = halfH * sines[i];
+            float c = halfW * sines[i];
+            float d = halfH * cosines[i];
+
+            tl[i].x = cx - a - b; tl[i].y = cy - c + d;
+            bl[i].x = cx - a + b; bl[i].y = cy - c - d;
+            br[i].x = cx + a + b; br[i].y = cy + c - d;
+            tr[i].x = cx + a - b; tr[i].y = cy + c + d;
+        }
+    }
+
+    // Scalar visibility test for rects [begin, end), appends to visibleIndices
+    size_t findVisibleRange(const glm::vec4* destRects, size_t begin, size_t end, const glm::vec4& viewRect,
+                            bool rotated, unsigned int* visibleIndices) {
+        size_t numVisible = 0;
+        for (size_t i = begin; i < end; i++) {
+            const glm::vec4& r = destRects[i];
+            float minX = r.x, minY = r.y, maxX = r.x + r.z, maxY = r.y + r.w;
+            if (rotated) {
+                float radius = 0.5f * sqrt(r.z * r.z + r.w * r.w);
+                float cx = r.x + r.z * 0.5f;
+                float cy = r.y + r.w * 0.5f;
+                minX = cx - radius; maxX = cx + radius;
+                minY = cy - radius; maxY = cy + radius;
+            }
+            if (minX < viewRect.x + viewRect.z && maxX > viewRect.x &&
+                minY < viewRect.y + viewRect.w && maxY > viewRect.y) {
+                visibleIndices[numVisible++] = (unsigned int)i;
+            }
+        }
+        return numVisible;
+    }
+
+    inline GLushort uvToUnorm16(float uv) {
+        uv = (uv < 0.0f) ? 0.0f : ((uv > 1.0f) ? 1.0f : uv);
+        return (GLushort)(uv * 65535.0f + 0.5f);
+    }
+
+#if defined(BENGINE_GLYPH_SSE) || defined(BENGINE_GLYPH_AVX)
+    // Loads 4 destRects and transposes them into x, y, width and height lanes
+    inline void loadRects4(const glm::vec4* destRects, __m128& x, __m128& y, __m128& w, __m128& h) {
+        x = _mm_loadu_ps(&destRects[0].x);
+        y = _mm_loadu_ps(&destRects[1].x);
+        w = _mm_loadu_ps(&destRects[2].x);
+        h = _mm_loadu_ps(&destRects[3].x);
+        _MM_TRANSPOSE4_PS(x, y, w, h);
+    }
+#endif
+
+#if defined(BENGINE_GLYPH_SSE) || defined(BENGINE_GLYPH_AVX)
+    // Converts 4 floats to half floats in the low 16 bits of each lane, rounding
+    // like floatToHalf
+    inline __m128i floatToHalf4(__m128 value) {
+#if defined(BENGINE_GLYPH_F16C)
+        return _mm_cvtepu16_epi32(_mm_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+#else
+        const __m128i F16_MAX = _mm_set1_epi32((127 + 16) << 23);
+        const __m128i MIN_NORMAL = _mm_set1_epi32(113 << 23);
+        const __m128i DENORM_MAGIC = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+        const __m128i NORMAL_BIAS = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+
+        __m128 sign = _mm_and_ps(value, _mm_set1_ps(-0.0f));
+        __m128 absValue = _mm_xor_ps(value, sign);
+        __m128i bits = _mm_castps_si128(absValue);
+
+        // Infinity for values too large, NaN keeps a mantissa bit
+        __m128i nanBit = _mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(absValue, absValue)), _mm_set1_epi32(0x200));
+        __m128i special = _mm_or_si128(nanBit, _mm_set1_epi32(0x7c00));
+        __m128i isRegular = _mm_cmpgt_epi32(F16_MAX, bits);
+
+        // Denormals, rounded by the float adder
+        __m128i isDenormal = _mm_cmpgt_epi32(MIN_NORMAL, bits);
+        __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absValue, _mm_castsi128_ps(DENORM_MAGIC))), DENORM_MAGIC);
+
+        // Normals, rounded to nearest even
+        __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(bits, 31 - 13), 31);
+        __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(bits, NORMAL_BIAS), mantissaOdd), 13);
+
+        __m128i finite = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+        __m128i half = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+        return _mm_or_si128(half, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+#endif
+    }
+
+    // Packs 4 vertices at a time, returns how many were packed
+    size_t packVerticesSIMD(const Vertex* vertices, size_t count, const glm::vec2& origin, PackedVertex* packed) {
+        const __m128 originXY = _mm_setr_ps(origin.x, origin.y, origin.x, origin.y);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 unormScale = _mm_set1_ps(65535.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const Vertex* v = vertices + i;
+            __m128 p01 = _mm_setr_ps(v[0].position.x, v[0].position.y, v[1].position.x, v[1].position.y);
+            __m128 p23 = _mm_setr_ps(v[2].position.x, v[2].position.y, v[3].position.x, v[3].position.y);
+            __m128 uv01 = _mm_setr_ps(v[0].uv.u, v[0].uv.v, v[1].uv.u, v[1].uv.v);
+            __m128 uv23 = _mm_setr_ps(v[2].uv.u, v[2].uv.v, v[3].uv.u, v[3].uv.v);
+
+            alignas(16) int positions[8];
+            _mm_store_si128((__m128i*)positions, floatToHalf4(_mm_sub_ps(p01, originXY)));
+            _mm_store_si128((__m128i*)(positions + 4), floatToHalf4(_mm_sub_ps(p23, originXY)));
+
+            alignas(16) int uvs[8];
+            uv01 = _mm_min_ps(_mm_max_ps(uv01, zero), one);
+            uv23 = _mm_min_ps(_mm_max_ps(uv23, zero), one);
+            _mm_store_si128((__m128i*)uvs, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(uv01, unormScale), half)));
+            _mm_store_si128((__m128i*)(uvs + 4), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(uv23, unormScale), half)));
+
+            for (size_t k = 0; k < 4; k++) {
+                PackedVertex& out = packed[i + k];
+                out.position[0] = (GLushort)positions[k * 2];
+                out.position[1] = (GLushort)positions[k * 2 + 1];
+                out.color = v[k].color;
+                out.uv[0] = (GLushort)uvs[k * 2];
+                out.uv[1] = (GLushort)uvs[k * 2 + 1];
+            }
+        }
+        return i;
+    }
+#else
+    size_t packVerticesSIMD(const Vertex*, size_t, const glm::vec2&, PackedVertex*) {
+        return 0;
+    }
+#endif
+
+#if defined(BENGINE_GLYPH_SSE)
+    // Interleaves 4 x and 4 y values into 4 Positions
+    inline void storePositions4(Position* out, __m128 x, __m128 y) {
+        _mm_storeu_ps(&out[0].x, _mm_unpacklo_ps(x, y));
+        _mm_storeu_ps(&out[2].x, _mm_unpackhi_ps(x, y));
+    }
+
+    size_t computeCornersSIMD(const glm::vec4* destRects, const float* cosines, const float* sines,
+                              size_t count, Position* corners) {
+        const __m128 half = _mm_set1_ps(0.5f);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 x, y, w, h;
+            loadRects4(destRects + i, x, y, w, h);
+            __m128 cosA = _mm_loadu_ps(cosines + i);
+            __m128 sinA = _mm_loadu_ps(sines + i);
+
+            __m128 halfW = _mm_mul_ps(w, half);
+            __m128 halfH = _mm_mul_ps(h, half);
+            __m128 cx = _mm_add_ps(x, halfW);
+            __m128 cy = _mm_add_ps(y, halfH);
+
+            __m128 a = _mm_mul_ps(halfW, cosA);
+            __m128 b = _mm_mul_ps(halfH, sinA);
+            __m128 c = _mm_mul_ps(halfW, sinA);
+            __m128 d = _mm_mul_ps(halfH, cosA);
+
+            __m128 aPlusB = _mm_add_ps(a, b);
+            __m128 aMinusB = _mm_sub_ps(a, b);
+            __m128 cPlusD = _mm_add_ps(c, d);
+            __m128 cMinusD = _mm_sub_ps(c, d);
+
+            storePositions4(corners + i, _mm_sub_ps(cx, aPlusB), _mm_sub_ps(cy, cMinusD));
+            storePositions4(corners + count + i, _mm_sub_ps(cx, aMinusB), _mm_sub_ps(cy, cPlusD));
+            storePositions4(corners + count * 2 + i, _mm_add_ps(cx, aPlusB), _mm_add_ps(cy, cMinusD));
+            storePositions4(corners + count * 3 + i, _mm_add_ps(cx, aMinusB), _mm_add_ps(cy, cPlusD));
+        }
+        return i;
+    }
+
+    // Returns how many rects were tested, the rest is left to the scalar loop
+    size_t findVisibleSIMD(const glm::vec4* destRects, size_t count, const glm::vec4& viewRect,
+                           bool rotated, unsigned int* visibleIndices, size_t& numVisible) {
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 viewMinX = _mm_set1_ps(viewRect.x);
+        const __m128 viewMinY = _mm_set1_ps(viewRect.y);
+        const __m128 viewMaxX = _mm_set1_ps(viewRect.x + viewRect.z);
+        const __m128 viewMaxY = _mm_set1_ps(viewRect.y + viewRect.w);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 minX, minY, w, h;
+            loadRects4(destRects + i, minX, minY, w, h);
+            __m128 maxX = _mm_add_ps(minX, w);
+            __m128 maxY = _mm_add_ps(minY, h);
+            if (rotated) {
+                __m128 radius = _mm_mul_ps(half, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(w, w), _mm_mul_ps(h, h))));
+                __m128 cx = _mm_add_ps(minX, _mm_mul_ps(w, half));
+                __m128 cy = _mm_add_ps(minY, _mm_mul_ps(h, half));
+                minX = _mm_sub_ps(cx, radius); maxX = _mm_add_ps(cx, radius);
+                minY = _mm_sub_ps(cy, radius); maxY = _mm_add_ps(cy, radius);
+            }
+            __m128 inX = _mm_and_ps(_mm_cmplt_ps(minX, viewMaxX), _mm_cmpgt_ps(maxX, viewMinX));
+            __m128 inY = _mm_and_ps(_mm_cmplt_ps(minY, viewMaxY), _mm_cmpgt_ps(maxY, viewMinY));
+            int mask = _mm_movemask_ps(_mm_and_ps(inX, inY));
+            for (int k = 0; k < 4; k++) {
+                if (mask & (1 << k)) visibleIndices[numVisible++] = (unsigned int)(i + k);
+            }
+        }
+        return i;
+    }
+#elif defined(BENGINE_GLYPH_AVX)
+    // Interleaves 8 x and 8 y values into 8 Positions
+    inline void storePositions8(Position* out, __m256 x, __m256 y) {
+        // unpack works per 128 bit lane, so put the lanes back in order afterwards
+        __m256 lo = _mm256_unpacklo_ps(x, y);
+        __m256 hi = _mm256_unpackhi_ps(x, y);
+        _mm256_storeu_ps(&out[0].x, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(&out[4].x, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+
+    size_t computeCornersSIMD(const glm::vec4* destRects, const float* cosines, const float* sines,
+                              size_t count, Position* corners) {
+        const __m256 half = _mm256_set1_ps(0.5f);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128 x0, y0, w0, h0, x1, y1, w1, h1;
+            loadRects4(destRects + i, x0, y0, w0, h0);
+            loadRects4(destRects + i + 4, x1, y1, w1, h1);
+            __m256 x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+            __m256 y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+            __m256 w = _mm256_insertf128_ps(_mm256_castps128_ps256(w0), w1, 1);
+            __m256 h = _mm256_insertf128_ps(_mm256_castps128_ps256(h0), h1, 1);
+            __m256 cosA = _mm256_loadu_ps(cosines + i);
+            __m256 sinA = _mm256_loadu_ps(sines + i);
+
+            __m256 halfW = _mm256_mul_ps(w, half);
+            __m256 halfH = _mm256_mul_ps(h, half);
+            __m256 cx = _mm256_add_ps(x, halfW);
+            __m256 cy = _mm256_add_ps(y, halfH);
+
+            __m256 a = _mm256_mul_ps(halfW, cosA);
+            __m256 b = _mm256_mul_ps(halfH, sinA);
+            __m256 c = _mm256_mul_ps(halfW, sinA);
+            __m256 d = _mm256_mul_ps(halfH, cosA);
+
+            __m256 aPlusB = _mm256_add_ps(a, b);
+            __m256 aMinusB = _mm256_sub_ps(a, b);
+            __m256 cPlusD = _mm256_add_ps(c, d);
+            __m256 cMinusD = _mm256_sub_ps(c, d);
+
+            storePositions8(corners + i, _mm256_sub_ps(cx, aPlusB), _mm256_sub_ps(cy, cMinusD));
+            storePositions8(corners + count + i, _mm256_sub_ps(cx, aMinusB), _mm256_sub_ps(cy, cPlusD));
+            storePositions8(corners + count * 2 + i, _mm256_add_ps(cx, aPlusB), _mm256_add_ps(cy, cMinusD));
+            storePositions8(corners + count * 3 + i, _mm256_add_ps(cx, aMinusB), _mm256_add_ps(cy, cPlusD));
+        }
+        return i;
+    }
+
+    // Returns how many rects were tested, the rest is left to the scalar loop
+    size_t findVisibleSIMD(const glm::vec4* destRects, size_t count, const glm::vec4& viewRect,
+                           bool rotated, unsigned int* visibleIndices, size_t& numVisible) {
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 viewMinX = _mm256_set1_ps(viewRect.x);
+        const __m256 viewMinY = _mm256_set1_ps(viewRect.y);
+        const __m256 viewMaxX = _mm256_set1_ps(viewRect.x + viewRect.z);
+        const __m256 viewMaxY = _mm256_set1_ps(viewRect.y + viewRect.w);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128 x0, y0, w0, h0, x1, y1, w1, h1;
+            loadRects4(destRects + i, x0, y0, w0, h0);
+            loadRects4(destRects + i + 4, x1, y1, w1, h1);
+            __m256 minX = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+            __m256 minY = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+            __m256 w = _mm256_insertf128_ps(_mm256_castps128_ps256(w0), w1, 1);
+            __m256 h = _mm256_insertf128_ps(_mm256_castps128_ps256(h0), h1, 1);
+            __m256 maxX = _mm256_add_ps(minX, w);
+            __m256 maxY = _mm256_add_ps(minY, h);
+            if (rotated) {
+                __m256 radius = _mm256_mul_ps(half, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(w, w), _mm256_mul_ps(h, h))));
+                __m256 cx = _mm256_add_ps(minX, _mm256_mul_ps(w, half));
+                __m256 cy = _mm256_add_ps(minY, _mm256_mul_ps(h, half));
+                minX = _mm256_sub_ps(cx, radius); maxX = _mm256_add_ps(cx, radius);
+                minY = _mm256_sub_ps(cy, radius); maxY = _mm256_add_ps(cy, radius);
+            }
+            __m256 inX = _mm256_and_ps(_mm256_cmp_ps(minX, viewMaxX, _CMP_LT_OQ), _mm256_cmp_ps(maxX, viewMinX, _CMP_GT_OQ));
+            __m256 inY = _mm256_and_ps(_mm256_cmp_ps(minY, viewMaxY, _CMP_LT_OQ), _mm256_cmp_ps(maxY, viewMinY, _CMP_GT_OQ));
+            int mask = _mm256_movemask_ps(_mm256_and_ps(inX, inY));
+            for (int k = 0; k < 8; k++) {
+                if (mask & (1 << k)) visibleIndices[numVisible++] = (unsigned int)(i + k);
+            }
+        }
+        return i;
+    }
+#elif defined(BENGINE_GLYPH_NEON)
+    size_t computeCornersSIMD(const glm::vec4* destRects, const float* cosines, const float* sines,
+                              size_t count, Position* corners) {
+        const float32x4_t half = vdupq_n_f32(0.5f);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            // vld4 splits the x, y, width, height of 4 destRects into lanes
+            float32x4x4_t r = vld4q_f32(&destRects[i].x);
+            float32x4_t cosA = vld1q_f32(cosines + i);
+            float32x4_t sinA = vld1q_f32(sines + i);
+
+            float32x4_t halfW = vmulq_f32(r.val[2], half);
+            float32x4_t halfH = vmulq_f32(r.val[3], half);
+            float32x4_t cx = vaddq_f32(r.val[0], halfW);
+            float32x4_t cy = vaddq_f32(r.val[1], halfH);
+
+            float32x4_t a = vmulq_f32(halfW, cosA);
+            float32x4_t b = vmulq_f32(halfH, sinA);
+            float32x4_t c = vmulq_f32(halfW, sinA);
+            float32x4_t d = vmulq_f32(halfH, cosA);
+
+            float32x4_t aPlusB = vaddq_f32(a, b);
+            float32x4_t aMinusB = vsubq_f32(a, b);
+            float32x4_t cPlusD = vaddq_f32(c, d);
+            float32x4_t cMinusD = vsubq_f32(c, d);
+
+            // vst2 interleaves x and y into Positions
+            float32x4x2_t tl = { { vsubq_f32(cx, aPlusB), vsubq_f32(cy, cMinusD) } };
+            float32x4x2_t bl = { { vsubq_f32(cx, aMinusB), vsubq_f32(cy, cPlusD) } };
+            float32x4x2_t br = { { vaddq_f32(cx, aPlusB), vaddq_f32(cy, cMinusD) } };
+            float32x4x2_t tr = { { vaddq_f32(cx, aMinusB), vaddq_f32(cy, cPlusD) } };
+            vst2q_f32(&corners[i].x, tl);
+            vst2q_f32(&corners[count + i].x, bl);
+            vst2q_f32(&corners[count * 2 + i].x, br);
+            vst2q_f32(&corners[count * 3 + i].x, tr);
+        }
+        return i;
+    }
+
+    // Returns how many rects were tested, the rest is left to the scalar loop
+    size_t findVisibleSIMD(const glm::vec4* destRects, size_t count, const glm::vec4& viewRect,
+                           bool rotated, unsigned int* visibleIndices, size_t& numVisible) {
+        const float32x4_t half = vdupq_n_f32(0.5f);
+        const float32x4_t viewMinX = vdupq_n_f32(viewRect.x);
+        const float32x4_t viewMinY = vdupq_n_f32(viewRect.y);
+        const float32x4_t viewMaxX = vdupq_n_f32(viewRect.x + viewRect.z);
+        const float32x4_t viewMaxY = vdupq_n_f32(viewRect.y + viewRect.w);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            float32x4x4_t r = vld4q_f32(&destRects[i].x);
+            float32x4_t minX = r.val[0];
+            float32x4_t minY = r.val[1];
+            float32x4_t maxX = vaddq_f32(minX, r.val[2]);
+            float32x4_t maxY = vaddq_f32(minY, r.val[3]);
+            if (rotated) {
+                float32x4_t lengthSq = vaddq_f32(vmulq_f32(r.val[2], r.val[2]), vmulq_f32(r.val[3], r.val[3]));
+                // sqrt(x) = x * rsqrt(x), with one Newton step for precision. Zero
+                // sized rects give NaN here and are culled, which is fine.
+                float32x4_t rsqrt = vrsqrteq_f32(lengthSq);
+                rsqrt = vmulq_f32(rsqrt, vrsqrtsq_f32(vmulq_f32(lengthSq, rsqrt), rsqrt));
+                float32x4_t radius = vmulq_f32(half, vmulq_f32(lengthSq, rsqrt));
+                float32x4_t cx = vaddq_f32(minX, vmulq_f32(r.val[2], half));
+                float32x4_t cy = vaddq_f32(minY, vmulq_f32(r.val[3], half));
+                minX = vsubq_f32(cx, radius); maxX = vaddq_f32(cx, radius);
+                minY = vsubq_f32(cy, radius); maxY = vaddq_f32(cy, radius);
+            }
+            uint32x4_t inX = vandq_u32(vcltq_f32(minX, viewMaxX), vcgtq_f32(maxX, viewMinX));
+            uint32x4_t inY = vandq_u32(vcltq_f32(minY, viewMaxY), vcgtq_f32(maxY, viewMinY));
+            uint32x4_t in = vandq_u32(inX, inY);
+            if (vgetq_lane_u32(in, 0)) visibleIndices[numVisible++] = (unsigned int)i;
+            if (vgetq_lane_u32(in, 1)) visibleIndices[numVisible++] = (unsigned int)(i + 1);
+            if (vgetq_lane_u32(in, 2)) visibleIndices[numVisible++] = (unsigned int)(i + 2);
+            if (vgetq_lane_u32(in, 3)) visibleIndices[numVisible++] = (unsigned int)(i + 3);
+        }
+        return i;
+    }
+#else
+    size_t computeCornersSIMD(const glm::vec4*, const float*, const float*, size_t, Position*) {
+        // No SIMD, the scalar loop does everything
+        return 0;
+    }
+
+    size_t findVisibleSIMD(const glm::vec4*, size_t, const glm::vec4&, bool, unsigned int*, size_t&) {
+        return 0;
+    }
+#endif
+
+}
+
+    void computeRotatedCorners(const glm::vec4* destRects, const float* cosines, const float* sines,
+                               size_t count, Position* corners) {
+        size_t done = computeCornersSIMD(destRects, cosines, sines, count, corners);
+        computeCornersRange(destRects, cosines, sines, done, count, count, corners);
+    }
+
+    void computeRotatedCornersScalar(const glm::vec4* destRects, const float* cosines, const float* sines,
+                                     size_t count, Position* corners) {
+        computeCornersRange(destRects, cosines, sines, 0, count, count, corners);
+    }
+
+    GLushort floatToHalf(float value) {
+        // Rounds to nearest even and keeps denormals, infinity and NaN
+        const unsigned int F32_INFINITY = 255u << 23;
+        const unsigned int F16_MAX = (127u + 16u) << 23;
+        const unsigned int DENORM_MAGIC_BITS = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+        unsigned int bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        unsigned int sign = bits & 0x80000000u;
+        bits ^= sign;
+
+        unsigned int half;
+        if (bits >= F16_MAX) {
+            // Too large becomes infinity, NaN stays NaN
+            half = (bits > F32_INFINITY) ? 0x7e00 : 0x7c00;
+        } else if (bits < (113u << 23)) {
+            // Denormal, let the float adder do the rounding
+            float denormMagic, f;
+            std::memcpy(&denormMagic, &DENORM_MAGIC_BITS, sizeof(denormMagic));
+            std::memcpy(&f, &bits, sizeof(f));
+            f += denormMagic;
+            std::memcpy(&bits, &f, sizeof(bits));
+            half = bits - DENORM_MAGIC_BITS;
+        } else {
+            unsigned int mantissaOdd = (bits >> 13) & 1;
+            bits += ((15u - 127u) << 23) + 0xfff;
+            bits += mantissaOdd;
+            half = bits >> 13;
+        }
+        return (GLushort)(half | (sign >> 16));
+    }
+
+    void packVertices(const Vertex* vertices, size_t count, const glm::vec2& origin, PackedVertex* packed) {
+        size_t i = packVerticesSIMD(vertices, count, origin, packed);
+        for (; i < count; i++) {
+            const Vertex& v = vertices[i];
+            PackedVertex& out = packed[i];
+            out.position[0] = floatToHalf(v.position.x - origin.x);
+            out.position[1] = floatToHalf(v.position.y - origin.y);
+            out.color = v.color;
+            out.uv[0] = uvToUnorm16(v.uv.u);
+            out.uv[1] = uvToUnorm16(v.uv.v);
+        }
+    }
+
+    size_t findVisibleRects(const glm::vec4* destRects, size_t count, const glm::vec4& viewRect,
+                            bool rotated, unsigned int* visibleIndices) {
+        size_t numVisible = 0;
+        size_t done = findVisibleSIMD(destRects, count, viewRect, rotated, visibleIndices, numVisible);
+        numVisible += findVisibleRange(destRects, done, count, viewRect, rotated, visibleIndices + numVisible);
+        return numVisible;
+    }
+
+}
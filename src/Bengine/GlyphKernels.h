@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+
+#include "Vertex.h"
+
+namespace Bengine {
+
+    // Computes the corners of count rotated quads, rotating each one about its
+    // center by the angle whose cosine and sine are given.
+    // destRects holds x, y, width, height like SpriteBatch::draw. The corners are
+    // written one kind at a time: count top lefts, then count bottom lefts, then
+    // count bottom rights and finally count top rights.
+    // Uses AVX, SSE2 or NEON when the compiler targets them.
+    void computeRotatedCorners(const glm::vec4* destRects, const float* cosines, const float* sines,
+                               size_t count, Position* corners);
+
+    // Plain C++ version of computeRotatedCorners, used for the leftover quads
+    // and on targets without SIMD
+    void computeRotatedCornersScalar(const glm::vec4* destRects, const float* cosines, const float* sines,
+                                     size_t count, Position* corners);
+
+    // Writes the indices of the destRects that overlap viewRect (x, y, width,
+    // height) to visibleIndices and returns how many there are. With rotated set
+    // a rect may be spun about its center, so its half diagonal is used as bounds.
+    // Uses AVX, SSE2 or NEON when the compiler targets them.
+    size_t findVisibleRects(const glm::vec4* destRects, size_t count, const glm::vec4& viewRect,
+                            bool rotated, unsigned int* visibleIndices);
+
+    // Converts count vertices to PackedVertex, storing positions relative to
+    // origin. UVs outside [0, 1] are clamped.
+    // Uses SSE2 on x86, and F16C for the half floats when the compiler targets it.
+    void packVertices(const Vertex* vertices, size_t count, const glm::vec2& origin, PackedVertex* packed);
+
+    // Converts a float to the bits of the nearest half float
+    GLushort floatToHalf(float value);
+
+}
@@ -18,6 +18,10 @@ namespace Bengine {
 
         if (!init()) return;
 
+        if (m_threadedRendering) {
+            m_renderQueue.init(&m_window);
+        }
+
         FpsLimiter limiter;
         limiter.setMaxFPS(60.0f);
 
@@ -33,13 +37,21 @@ namespace Bengine {
                 draw();
 
                 m_fps = limiter.end();
-                m_window.swapBuffer();
+                if (m_renderQueue.isRunning()) {
+                    // The render thread swaps once it has drawn the frame
+                    m_renderQueue.submitFrame();
+                } else {
+                    m_window.swapBuffer();
+                }
             }
         }
 
     }
 
     void IMainGame::exitGame() {
+        // Screens free their GL resources on this thread
+        m_renderQueue.dispose();
+
         m_currentScreen->onExit();
         if (m_screenList) {
             m_screenList->destroy();
@@ -96,6 +108,14 @@ namespace Bengine {
 
     void IMainGame::update() {
         if (m_currentScreen) {
+            // Entering and leaving screens loads and frees GL resources, so the
+            // context comes back to this thread while the screen changes
+            ScreenState state = m_currentScreen->getState();
+            bool changingScreen = (state == ScreenState::CHANGE_NEXT || state == ScreenState::CHANGE_PREVIOUS);
+            if (changingScreen) {
+                m_renderQueue.dispose();
+            }
+
             switch (m_currentScreen->getState()) {
                 case ScreenState::RUNNING:
                     m_currentScreen->update();
@@ -122,13 +142,21 @@ namespace Bengine {
                 default:
                     break;
             }
+
+            if (changingScreen && m_threadedRendering && m_isRunning) {
+                m_renderQueue.init(&m_window);
+            }
         } else {
             exitGame();
         }
     }
 
     void IMainGame::draw() {
-        glViewport(0, 0, m_window.getScreenWidth(), m_window.getScreenHeight());
+        if (m_renderQueue.isRunning()) {
+            m_renderQueue.getCommands().setViewport(0, 0, m_window.getScreenWidth(), m_window.getScreenHeight());
+        } else {
+            glViewport(0, 0, m_window.getScreenWidth(), m_window.getScreenHeight());
+        }
         if (m_currentScreen && m_currentScreen->getState() == ScreenState::RUNNING) {
             m_currentScreen->draw();
         }
@@ -3,6 +3,7 @@
 #include "Bengine.h"
 #include "Window.h"
 #include "InputManager.h"
+#include "RenderQueue.h"
 #include <memory>
 
 namespace Bengine {
@@ -33,6 +34,12 @@ namespace Bengine {
             return m_fps;
         }
 
+        // The queue screens record their draw calls into while threaded
+        // rendering is on, nullptr otherwise
+        RenderQueue* getRenderQueue() {
+            return m_renderQueue.isRunning() ? &m_renderQueue : nullptr;
+        }
+
         InputManager inputManager;
 
     protected:
@@ -49,5 +56,11 @@ namespace Bengine {
         bool m_isRunning = false;
         float m_fps = 0.0f;
         Window m_window;
+
+        // Set before run() returns from onInit() to draw on a render thread. The
+        // screens' draw() then records into getRenderQueue() instead of calling GL,
+        // and the simulation runs at most one frame ahead of the screen.
+        bool m_threadedRendering = false;
+        RenderQueue m_renderQueue;
     };
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "GLStateCache.h"
+#include "Vertex.h"
+
+namespace Bengine {
+
+    class SpriteBatch;
+    struct ParticleSpawn;
+
+    // What addParticle() does when all maxParticles particles are alive
+    enum class ParticlePoolFullPolicy {
+        DROP_NEW, ///< The new particle isn't added
+        REPLACE_OLDEST, ///< The new particle replaces the one with the least life left
+        GROW ///< The pool doubles its capacity
+    };
+
+    // How the particles of a batch are blended with what is behind them
+    enum class ParticleBlendMode {
+        ALPHA, ///< SRC_ALPHA, ONE_MINUS_SRC_ALPHA. The only mode where order shows.
+        ADDITIVE, ///< SRC_ALPHA, ONE. Order doesn't matter, so it is never sorted.
+        PREMULTIPLIED ///< ONE, ONE_MINUS_SRC_ALPHA, for colors already multiplied by alpha
+    };
+
+    // Sets the blend function of mode through the GLStateCache. ALPHA is the
+    // function Window::create sets, so drawing goes back to it afterwards.
+    inline void setParticleBlendFunc(ParticleBlendMode mode) {
+        switch (mode) {
+            case ParticleBlendMode::ALPHA:
+                GLStateCache::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                break;
+            case ParticleBlendMode::ADDITIVE:
+                GLStateCache::setBlendFunc(GL_SRC_ALPHA, GL_ONE);
+                break;
+            case ParticleBlendMode::PREMULTIPLIED:
+                GLStateCache::setBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+                break;
+        }
+    }
+
+    // Counts the steps until a life of 1 runs out when decayRate * stepTime is
+    // taken off per step, as the batches do it. Returns SIZE_MAX when the
+    // particles never die, because the decay is lost in rounding.
+    inline size_t countParticleLifetimeSteps(float decayRate, float stepTime) {
+        const float decay = decayRate * stepTime;
+        if (!(decay > 0.0f)) return SIZE_MAX;
+        float life = 1.0f;
+        size_t numSteps = 0;
+        while (true) {
+            // One step as the batches take it, which may cross into a lower power of two
+            const float next = life - decay;
+            if (next == life) return SIZE_MAX;
+            life = next;
+            numSteps++;
+            if (life <= 0.0f) return numSteps;
+
+            // Between low and 2 * low every float is a multiple of unit, so each
+            // step there takes the same number of units off and the steps that
+            // stay above low can be counted at once. One landing on low could
+            // have rounded to the finer floats below it, so it is taken normally.
+            int exponent;
+            std::frexp(life, &exponent);
+            const float low = std::ldexp(1.0f, exponent - 1);
+            const float unit = std::ldexp(1.0f, exponent - 24);
+            const float units = decay / unit;
+            float unitsPerStep = std::floor(units + 0.5f);
+            // Ties round to even, so life is an even number of units after the
+            // step above and each step takes the even one of the two counts
+            if (unitsPerStep - units == 0.5f && std::fmod(unitsPerStep, 2.0f) != 0.0f) unitsPerStep -= 1.0f;
+            if (unitsPerStep < 1.0f) continue;
+
+            const uint64_t unitsAboveLow = (uint64_t)((life - low) / unit);
+            if (unitsAboveLow == 0) continue;
+            const uint64_t numFastSteps = (unitsAboveLow - 1) / (uint64_t)unitsPerStep;
+            life -= (float)(numFastSteps * (uint64_t)unitsPerStep) * unit;
+            numSteps += (size_t)numFastSteps;
+        }
+    }
+
+    // What gameplay code needs of a particle batch, so it can switch between
+    // the CPU ParticleBatch2D and the GPUParticleBatch2D
+    class IParticleBatch2D {
+    public:
+        virtual ~IParticleBatch2D() {
+            // Empty
+        }
+
+        virtual void update(float deltaTime) = 0;
+
+        // ParticleBatch2D adds its particles to spriteBatch. GPUParticleBatch2D
+        // renders them right away and doesn't use spriteBatch.
+        virtual void draw(SpriteBatch* spriteBatch) = 0;
+
+        virtual void addParticle(const glm::vec2& position,
+                                 const glm::vec2& velocity,
+                                 const ColorRGBA8& color,
+                                 float width) = 0;
+
+        // Adds count particles at once, from one array per field, as if
+        // addParticle() was called for each in order
+        virtual void addParticles(const float* x, const float* y, const float* vx, const float* vy,
+                                  const ColorRGBA8* color, const float* width, size_t count) = 0;
+
+        // Makes count particles of an emitter's spawn itself, the same as the
+        // emitter would make them, and returns true. The default returns false,
+        // and the emitter makes the particles and calls addParticles().
+        virtual bool spawnParticles(const ParticleSpawn&, size_t) {
+            return false;
+        }
+
+        virtual void setPoolFullPolicy(ParticlePoolFullPolicy policy) = 0;
+
+        // ALPHA by default
+        virtual void setBlendMode(ParticleBlendMode blendMode) = 0;
+        virtual ParticleBlendMode getBlendMode() const = 0;
+
+        // Scales how many particles emitters add, 1 by default.
+        // ParticleEngine2D lowers it for batches it updates less often.
+        virtual void setSpawnScale(float spawnScale) = 0;
+        virtual float getSpawnScale() const = 0;
+
+        virtual size_t getNumAlive() const = 0;
+
+        // How many update(stepTime) calls a new particle lives through, with
+        // the same rounding as the updates. SIZE_MAX if particles don't decay.
+        virtual size_t getLifetimeSteps(float stepTime) const = 0;
+
+        // Kills every particle and moves the rest of the state, like the time
+        // of the turbulence, on as numSteps calls of update(stepTime) would.
+        // Only gives the same batch as those calls if numSteps is at least
+        // getLifetimeSteps(stepTime). See ParticleEngine2D::skipAhead().
+        virtual void skipAhead(size_t numSteps, float stepTime) = 0;
+    };
+
+}
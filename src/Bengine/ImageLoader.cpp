@@ -2,6 +2,7 @@
 #include "picoPNG.h"
 #include "IOManager.h"
 #include "BengineErrors.h"
+#include "GLStateCache.h"
 
 namespace Bengine {
 
@@ -31,7 +32,7 @@ namespace Bengine {
         glGenTextures(1, &(texture.id));
 
         //Bind the texture object
-        glBindTexture(GL_TEXTURE_2D, texture.id);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, texture.id);
         //Upload the pixels to the texture
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &(out[0]));
 
@@ -45,7 +46,7 @@ namespace Bengine {
         glGenerateMipmap(GL_TEXTURE_2D);
 
         //Unbind the texture
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
 
         texture.width = width;
         texture.height = height;
@@ -1,4 +1,8 @@
 #include "ParticleBatch2D.h"
+#include "ParticleKernels.h"
+
+#include <algorithm>
+#include <limits>
 
 namespace Bengine {
 
@@ -8,40 +12,181 @@ namespace Bengine {
 
 
     ParticleBatch2D::~ParticleBatch2D() {
-        delete[] m_particles;
+        // Empty
     }
 
     void ParticleBatch2D::init(int maxParticles,
                                float decayRate,
                                GLTexture texture,
                                std::function<void(Particle2D&, float)> updateFunc /* = defaultParticleUpdate */) {
-        m_maxParticles = maxParticles;
-        m_particles = new Particle2D[maxParticles];
+        m_particles.setCapacity(maxParticles);
         m_decayRate = decayRate;
         m_texture = texture;
         m_updateFunc = updateFunc;
+
+        // std::function can't be compared, but the function pointer it holds can
+        typedef void (*UpdateFuncPointer)(Particle2D&, float);
+        const UpdateFuncPointer* updateFuncPointer = m_updateFunc.target<UpdateFuncPointer>();
+        m_defaultUpdate = !m_updateFunc || (updateFuncPointer && *updateFuncPointer == defaultParticleUpdate);
     }
 
     void ParticleBatch2D::update(float deltaTime) {
-        for (int i = 0; i < m_maxParticles; i++) {
-            // Check if it is active
-            if (m_particles[i].life > 0.0f) {
-                // Update using function pointer
-                m_updateFunc(m_particles[i], deltaTime);
-                m_particles[i].life -= m_decayRate * deltaTime;
+        beginUpdate(deltaTime);
+        for (size_t range = 0; range < m_numUpdateRanges; range++) {
+            updateRange(range, deltaTime);
+        }
+        endUpdate();
+    }
+
+    void ParticleBatch2D::beginUpdate(float deltaTime) {
+        const size_t numAlive = m_particles.getNumAlive();
+        if (m_deadParticles.size() < m_particles.getCapacity()) {
+            m_deadParticles.resize(m_particles.getCapacity());
+        }
+
+        m_numUpdateRanges = 1;
+        if (m_defaultUpdate) {
+            m_numUpdateRanges = (numAlive + UPDATE_RANGE_SIZE - 1) / UPDATE_RANGE_SIZE;
+        }
+        m_numDeadInRange.assign(m_numUpdateRanges, 0);
+
+        if (m_modules) {
+            m_modules->advance(deltaTime);
+        }
+    }
+
+    void ParticleBatch2D::updateRange(size_t range, float deltaTime) {
+        const size_t numAlive = m_particles.getNumAlive();
+        const size_t first = m_defaultUpdate ? range * UPDATE_RANGE_SIZE : 0;
+        const size_t last = m_defaultUpdate ? std::min(first + UPDATE_RANGE_SIZE, numAlive) : numAlive;
+        unsigned int* deadParticles = m_deadParticles.data() + first;
+
+        // The modules and the integration both work on the same range, so it
+        // is still in cache for the later passes
+        if (m_modules) {
+            m_modules->update(m_particles, first, last, deltaTime);
+        }
+
+        size_t numDead = 0;
+        if (m_defaultUpdate) {
+            numDead = integrateParticles(m_particles.x.data() + first, m_particles.y.data() + first,
+                                         m_particles.vx.data() + first, m_particles.vy.data() + first,
+                                         m_particles.life.data() + first, last - first,
+                                         deltaTime, m_decayRate, deadParticles);
+            // The kernel counts from the start of the range
+            for (size_t k = 0; k < numDead; k++) {
+                deadParticles[k] += (unsigned int)first;
+            }
+        } else {
+            // The callbacks work on Particle2Ds, so the particles are copied out a
+            // chunk at a time. Building each one right before its call would stall
+            // on loading the fields that were just stored.
+            for (int chunkFirst = 0; chunkFirst < (int)numAlive; chunkFirst += CALLBACK_CHUNK_SIZE) {
+                int count = std::min(CALLBACK_CHUNK_SIZE, (int)numAlive - chunkFirst);
+                for (int k = 0; k < count; k++) {
+                    m_chunk[k] = m_particles.get(chunkFirst + k);
+                }
+                for (int k = 0; k < count; k++) {
+                    // Update using function pointer
+                    m_updateFunc(m_chunk[k], deltaTime);
+                    m_chunk[k].life -= m_decayRate * deltaTime;
+                }
+                for (int k = 0; k < count; k++) {
+                    m_particles.set(chunkFirst + k, m_chunk[k]);
+                    if (m_chunk[k].life <= 0.0f) {
+                        deadParticles[numDead++] = chunkFirst + k;
+                    }
+                }
+            }
+        }
+        m_numDeadInRange[range] = numDead;
+    }
+
+    void ParticleBatch2D::endUpdate() {
+        // Packs the dead indices of all ranges together, still in order
+        size_t numDead = 0;
+        for (size_t range = 0; range < m_numUpdateRanges; range++) {
+            const unsigned int* rangeDead = m_deadParticles.data() + range * UPDATE_RANGE_SIZE;
+            // Ranges before the first one with a gap are already in place
+            if (rangeDead != m_deadParticles.data() + numDead) {
+                std::copy(rangeDead, rangeDead + m_numDeadInRange[range], m_deadParticles.data() + numDead);
+            }
+            numDead += m_numDeadInRange[range];
+        }
+
+        m_particles.removeDead(m_deadParticles.data(), numDead);
+        // Removing moved particles around, so the oldest have to be found again
+        m_oldestParticles.clear();
+        m_numOldestUsed = 0;
+
+        resetBounds();
+        extendBounds(m_particles.x.data(), m_particles.y.data(), m_particles.width.data(), m_particles.getNumAlive());
+    }
+
+    void ParticleBatch2D::skipAhead(size_t numSteps, float stepTime) {
+        m_particles.clear();
+        m_oldestParticles.clear();
+        m_numOldestUsed = 0;
+        if (m_modules) {
+            for (size_t step = 0; step < numSteps; step++) {
+                m_modules->advance(stepTime);
             }
         }
     }
 
     void ParticleBatch2D::draw(SpriteBatch* spriteBatch) {
-        glm::vec4 uvRect(0.0f, 0.0f, 1.0f, 1.0f);
-        for (int i = 0; i < m_maxParticles; i++) {
-            // Check if it is active
-            auto& p = m_particles[i];
-            if (p.life > 0.0f) {
-                glm::vec4 destRect(p.position.x, p.position.y, p.width, p.width);
-                spriteBatch->draw(destRect, uvRect, m_texture.id, 0.0f, p.color);
+        const glm::vec4 uvRect(0.0f, 0.0f, 1.0f, 1.0f);
+        auto drawParticle = [&](size_t i) {
+            glm::vec4 destRect(m_particles.x[i] + m_particles.vx[i] * m_drawAhead,
+                               m_particles.y[i] + m_particles.vy[i] * m_drawAhead,
+                               m_particles.width[i], m_particles.width[i]);
+            spriteBatch->draw(destRect, uvRect, m_texture.id, 0.0f, m_particles.color[i]);
+        };
+
+        if (m_blendMode == ParticleBlendMode::ALPHA && m_numSortBuckets > 0) {
+            sortBackToFront();
+            for (unsigned int i : m_drawOrder) {
+                drawParticle(i);
             }
+            return;
+        }
+        for (size_t i = 0; i < m_particles.getNumAlive(); i++) {
+            drawParticle(i);
+        }
+    }
+
+    void ParticleBatch2D::sortBackToFront() {
+        const size_t numAlive = m_particles.getNumAlive();
+        m_drawOrder.resize(numAlive);
+        if (numAlive == 0) return;
+
+        const float* y = m_particles.y.data();
+        float minY = y[0];
+        float maxY = y[0];
+        for (size_t i = 1; i < numAlive; i++) {
+            minY = std::min(minY, y[i]);
+            maxY = std::max(maxY, y[i]);
+        }
+
+        // Band 0 is the top, and the bottom edge falls in the last band. The
+        // min only guards against rounding.
+        const size_t lastBucket = m_numSortBuckets - 1;
+        const float scale = maxY > minY ? (float)lastBucket / (maxY - minY) : 0.0f;
+        auto bucketOf = [&](size_t i) {
+            return std::min((size_t)((maxY - y[i]) * scale), lastBucket);
+        };
+        m_bucketStarts.assign(m_numSortBuckets, 0);
+        for (size_t i = 0; i < numAlive; i++) {
+            m_bucketStarts[bucketOf(i)]++;
+        }
+        unsigned int start = 0;
+        for (size_t b = 0; b < m_numSortBuckets; b++) {
+            unsigned int count = m_bucketStarts[b];
+            m_bucketStarts[b] = start;
+            start += count;
+        }
+        for (size_t i = 0; i < numAlive; i++) {
+            m_drawOrder[m_bucketStarts[bucketOf(i)]++] = (unsigned int)i;
         }
     }
 
@@ -50,34 +195,127 @@ namespace Bengine {
                                       const ColorRGBA8& color,
                                       float width) {
         int particleIndex = findFreeParticle();
+        if (particleIndex == -1) return;
 
-        auto& p = m_particles[particleIndex];
-
-        p.life = 1.0f;
-        p.position = position;
-        p.velocity = velocity;
-        p.color = color;
-        p.width = width;
+        m_particles.life[particleIndex] = 1.0f;
+        m_particles.x[particleIndex] = position.x;
+        m_particles.y[particleIndex] = position.y;
+        m_particles.vx[particleIndex] = velocity.x;
+        m_particles.vy[particleIndex] = velocity.y;
+        m_particles.color[particleIndex] = color;
+        m_particles.width[particleIndex] = width;
+        if (m_pendingTime > 0.0f) {
+            backDate(particleIndex);
+        }
+        // The first particle replaces whatever bounds there were
+        if (m_particles.getNumAlive() == 1) {
+            resetBounds();
+        }
+        extendBounds(&position.x, &position.y, &width, 1);
     }
 
-    int ParticleBatch2D::findFreeParticle() {
+    void ParticleBatch2D::addParticles(const float* x, const float* y, const float* vx, const float* vy,
+                                       const ColorRGBA8* color, const float* width, size_t count) {
+        // Dropped particles may grow the bounds too, which costs nothing but
+        // a little precision
+        if (m_particles.getNumAlive() == 0) {
+            resetBounds();
+        }
+        extendBounds(x, y, width, count);
 
-        for (int i = m_lastFreeParticle; i < m_maxParticles; i++) {
-            if (m_particles[i].life <= 0.0f) {
-                m_lastFreeParticle = i;
-                return i;
+        size_t numFree = m_particles.getCapacity() - m_particles.getNumAlive();
+        if (count > numFree && m_poolFullPolicy == ParticlePoolFullPolicy::GROW) {
+            m_particles.setCapacity(std::max(m_particles.getCapacity() * 2, m_particles.getNumAlive() + count));
+            numFree = m_particles.getCapacity() - m_particles.getNumAlive();
+        }
+
+        const size_t numAppended = std::min(count, numFree);
+        const size_t first = m_particles.add(numAppended);
+        std::copy(x, x + numAppended, m_particles.x.begin() + first);
+        std::copy(y, y + numAppended, m_particles.y.begin() + first);
+        std::copy(vx, vx + numAppended, m_particles.vx.begin() + first);
+        std::copy(vy, vy + numAppended, m_particles.vy.begin() + first);
+        std::copy(color, color + numAppended, m_particles.color.begin() + first);
+        std::copy(width, width + numAppended, m_particles.width.begin() + first);
+        std::fill(m_particles.life.begin() + first, m_particles.life.begin() + first + numAppended, 1.0f);
+        if (m_pendingTime > 0.0f) {
+            for (size_t i = first; i < first + numAppended; i++) {
+                backDate(i);
             }
         }
 
-        for (int i = 0; i < m_lastFreeParticle; i++) {
-            if (m_particles[i].life <= 0.0f) {
-                m_lastFreeParticle = i;
-                return i;
+        if (m_poolFullPolicy == ParticlePoolFullPolicy::REPLACE_OLDEST) {
+            for (size_t k = numAppended; k < count; k++) {
+                int particleIndex = findOldestParticle();
+                if (particleIndex == -1) return;
+
+                m_particles.life[particleIndex] = 1.0f;
+                m_particles.x[particleIndex] = x[k];
+                m_particles.y[particleIndex] = y[k];
+                m_particles.vx[particleIndex] = vx[k];
+                m_particles.vy[particleIndex] = vy[k];
+                m_particles.color[particleIndex] = color[k];
+                m_particles.width[particleIndex] = width[k];
+                if (m_pendingTime > 0.0f) {
+                    backDate(particleIndex);
+                }
             }
         }
+    }
+
+    void ParticleBatch2D::resetBounds() {
+        m_boundsMin = glm::vec2(std::numeric_limits<float>::max());
+        m_boundsMax = glm::vec2(-std::numeric_limits<float>::max());
+    }
+
+    void ParticleBatch2D::extendBounds(const float* x, const float* y, const float* width, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            m_boundsMin.x = std::min(m_boundsMin.x, x[i]);
+            m_boundsMin.y = std::min(m_boundsMin.y, y[i]);
+            m_boundsMax.x = std::max(m_boundsMax.x, x[i] + width[i]);
+            m_boundsMax.y = std::max(m_boundsMax.y, y[i] + width[i]);
+        }
+    }
 
-        // No particles are free, overwrite first particle
-        return 0;
+    int ParticleBatch2D::findFreeParticle() {
+        if (!m_particles.isFull()) {
+            return (int)m_particles.add();
+        }
+
+        switch (m_poolFullPolicy) {
+            case ParticlePoolFullPolicy::DROP_NEW:
+                return -1;
+            case ParticlePoolFullPolicy::REPLACE_OLDEST:
+                return findOldestParticle();
+            case ParticlePoolFullPolicy::GROW:
+                m_particles.setCapacity(std::max(m_particles.getCapacity() * 2, (size_t)1));
+                return (int)m_particles.add();
+        }
+        return -1;
+    }
+
+    int ParticleBatch2D::findOldestParticle() {
+        const int numAlive = (int)m_particles.getNumAlive();
+        if (numAlive == 0) return -1;
+
+        if (m_numOldestUsed == m_oldestParticles.size()) {
+            // Picking a sixteenth of the pool at a time keeps a full pool from
+            // being searched for every particle added to it. Replaced particles
+            // have full life, so they aren't picked again before the others.
+            const int numOldest = std::min(numAlive, std::max(numAlive / 16, 64));
+            m_oldestParticles.resize(numAlive);
+            for (int i = 0; i < numAlive; i++) {
+                m_oldestParticles[i] = i;
+            }
+            const float* life = m_particles.life.data();
+            auto byLife = [life](int a, int b) { return life[a] < life[b]; };
+            std::nth_element(m_oldestParticles.begin(), m_oldestParticles.begin() + (numOldest - 1),
+                             m_oldestParticles.end(), byLife);
+            m_oldestParticles.resize(numOldest);
+            std::sort(m_oldestParticles.begin(), m_oldestParticles.end(), byLife);
+            m_numOldestUsed = 0;
+        }
+        return m_oldestParticles[m_numOldestUsed++];
     }
 
-}
\ No newline at end of file
+}
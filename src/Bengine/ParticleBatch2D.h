@@ -1,55 +1,154 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <vector>
 #include <glm/glm.hpp>
 #include "Vertex.h"
 #include "SpriteBatch.h"
 #include "GLTexture.h"
+#include "IParticleBatch2D.h"
+#include "ParticlePool2D.h"
+#include "ParticleModules.h"
 
 namespace Bengine {
 
-    class Particle2D {
-    public:
-        glm::vec2 position = glm::vec2(0.0f);
-        glm::vec2 velocity = glm::vec2(0.0f);
-        ColorRGBA8 color;
-        float life = 0.0f;
-        float width = 0.0f;
-    };
-
     // Default function pointer
     inline void defaultParticleUpdate(Particle2D& particle, float deltaTime) {
         particle.position += particle.velocity * deltaTime;
     }
 
-    class ParticleBatch2D {
+    class ParticleBatch2D : public IParticleBatch2D {
     public:
         ParticleBatch2D();
         ~ParticleBatch2D();
 
+        // With defaultParticleUpdate, or no updateFunc at all, update() runs
+        // integrateParticles over the live particles. Any other updateFunc is called
+        // once per live particle, on a Particle2D copied out of the pool.
         void init(int maxParticles,
                   float decayRate,
                   GLTexture texture,
                   std::function<void(Particle2D&, float)> updateFunc = defaultParticleUpdate);
 
-        void update(float deltaTime);
+        void update(float deltaTime) override;
+
+        // update() in three steps, so the ranges of one batch and of different
+        // batches can be updated on different threads, as ParticleEngine2D
+        // does. beginUpdate() and endUpdate() run on one thread, and in between
+        // updateRange() runs once for every range in [0, getNumUpdateRanges()).
+        // Particles must not be added until endUpdate().
+        void beginUpdate(float deltaTime);
+        size_t getNumUpdateRanges() const { return m_numUpdateRanges; }
+        void updateRange(size_t range, float deltaTime);
+        void endUpdate();
 
-        void draw(SpriteBatch* spriteBatch);
+        // Adds the live particles to spriteBatch, in storage order unless
+        // bucket sorting is on. The blend function is left to the caller, see
+        // ParticleEngine2D::draw.
+        void draw(SpriteBatch* spriteBatch) override;
 
         void addParticle(const glm::vec2& position,
                          const glm::vec2& velocity,
                          const ColorRGBA8& color,
-                         float width);
+                         float width) override;
+
+        // Copies the particles that fit into the free slots in one go. Only
+        // REPLACE_OLDEST looks for a slot per particle, for the rest.
+        void addParticles(const float* x, const float* y, const float* vx, const float* vy,
+                          const ColorRGBA8* color, const float* width, size_t count) override;
+
+        // Runs the passes of modules over the live particles at the start of
+        // every update(), before they move, e.g.
+        //     setModules(makeParticleModules(GravityModule(glm::vec2(0.0f, -98.0f)), DragModule(0.5f)));
+        // Behaviour built from modules keeps the kernel path, unlike an updateFunc.
+        void setModules(std::unique_ptr<ParticleUpdater> modules) { m_modules = std::move(modules); }
+
+        // REPLACE_OLDEST by default
+        void setPoolFullPolicy(ParticlePoolFullPolicy policy) override { m_poolFullPolicy = policy; }
+
+        void setBlendMode(ParticleBlendMode blendMode) override { m_blendMode = blendMode; }
+        ParticleBlendMode getBlendMode() const override { return m_blendMode; }
+
+        // Makes draw() of an ALPHA batch add its particles roughly back to
+        // front, back being up (larger y) as in a top down view. They are
+        // spread over numBuckets bands of y by a counting sort, which costs
+        // two passes over the particles instead of a full sort, and keep
+        // their storage order within a band. 0 turns it off, which is the
+        // default. Other blend modes are never sorted.
+        void setSortBuckets(size_t numBuckets) { m_numSortBuckets = numBuckets; }
+        size_t getSortBuckets() const { return m_numSortBuckets; }
+
+        void setSpawnScale(float spawnScale) override { m_spawnScale = spawnScale; }
+        float getSpawnScale() const override { return m_spawnScale; }
+
+        // Makes draw() put every particle where its velocity takes it in
+        // drawAhead seconds, for batches updated less often than they are
+        // drawn. 0 by default.
+        void setDrawAhead(float drawAhead) { m_drawAhead = drawAhead; }
+
+        // The time the next update() will make up for, for batches whose
+        // updates are put off. New particles are moved back along their
+        // velocity and given more life by as much, so that update doesn't
+        // age them for time before they were added, and draw() shows them
+        // where they were added. 0 by default.
+        void setPendingTime(float pendingTime) { m_pendingTime = pendingTime; }
+
+        // The rect (x, y, width, height) that holds the quads of the live
+        // particles as of the last update, grown by the particles added
+        // since. Meaningless while no particle is alive.
+        glm::vec4 getBounds() const { return glm::vec4(m_boundsMin, m_boundsMax - m_boundsMin); }
+
+        const ParticlePool2D& getParticles() const { return m_particles; }
+        size_t getNumAlive() const override { return m_particles.getNumAlive(); }
+        size_t getLifetimeSteps(float stepTime) const override { return countParticleLifetimeSteps(m_decayRate, stepTime); }
+        void skipAhead(size_t numSteps, float stepTime) override;
 
     private:
+        // Particles the callback path copies out of the pool at once
+        static const int CALLBACK_CHUNK_SIZE = 256;
+        // Live particles per range of the kernel path. The callback path is
+        // always a single range, since it shares m_chunk.
+        static const size_t UPDATE_RANGE_SIZE = 16384;
+
+        // Returns the index to put a new particle at, or -1 to drop it
         int findFreeParticle();
+        int findOldestParticle();
+        // Fills m_drawOrder with the live particles from the top band of y down
+        void sortBackToFront();
+        // Moves particle i back by the pending time, see setPendingTime()
+        void backDate(size_t i) {
+            m_particles.x[i] -= m_particles.vx[i] * m_pendingTime;
+            m_particles.y[i] -= m_particles.vy[i] * m_pendingTime;
+            m_particles.life[i] += m_decayRate * m_pendingTime;
+        }
+        // Empties the bounds, so the next extendBounds() sets them
+        void resetBounds();
+        // Grows the bounds to hold count more particles
+        void extendBounds(const float* x, const float* y, const float* width, size_t count);
 
         std::function<void(Particle2D&, float)> m_updateFunc; ///< Function pointer for custom updates
+        bool m_defaultUpdate = true; ///< m_updateFunc is defaultParticleUpdate, so the kernel can do its work
+        std::unique_ptr<ParticleUpdater> m_modules;
         float m_decayRate = 0.1f;
-        Particle2D* m_particles = nullptr;
-        int m_maxParticles = 0;
-        int m_lastFreeParticle = 0;
+        ParticlePool2D m_particles;
+        std::vector<unsigned int> m_deadParticles; ///< Indices of the particles that died, each range's from its first particle on
+        std::vector<size_t> m_numDeadInRange;
+        size_t m_numUpdateRanges = 0;
+        Particle2D m_chunk[CALLBACK_CHUNK_SIZE]; ///< Live particles of the chunk the callbacks are run on
+        ParticlePoolFullPolicy m_poolFullPolicy = ParticlePoolFullPolicy::REPLACE_OLDEST;
+        std::vector<int> m_oldestParticles; ///< Live particles with the least life, for REPLACE_OLDEST
+        size_t m_numOldestUsed = 0; ///< The front of m_oldestParticles that was already replaced
         GLTexture m_texture;
+        ParticleBlendMode m_blendMode = ParticleBlendMode::ALPHA;
+        size_t m_numSortBuckets = 0;
+        std::vector<unsigned int> m_bucketStarts; ///< First index in m_drawOrder of each band, then its fill position
+        std::vector<unsigned int> m_drawOrder; ///< Indices of the live particles in the order draw() adds them
+        float m_spawnScale = 1.0f;
+        float m_drawAhead = 0.0f;
+        float m_pendingTime = 0.0f;
+        glm::vec2 m_boundsMin = glm::vec2(0.0f);
+        glm::vec2 m_boundsMax = glm::vec2(0.0f);
     };
 
-}
\ No newline at end of file
+}
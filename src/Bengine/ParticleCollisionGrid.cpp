@@ -0,0 +1,323 @@
+#include "ParticleCollisionGrid.h"
+#include "BengineErrors.h"
+
+#include <Box2D/Box2D.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+    // Sets dist to the chamfer distance in cells from every cell to the
+    // nearest cell whose solid flag is source, with one pass down the grid
+    // and one back up
+    void distanceTransform(const std::vector<uint8_t>& solid, uint8_t source, int width, int height,
+                           std::vector<float>& dist) {
+        const float DIAGONAL = 1.41421356f;
+        dist.resize(solid.size());
+        for (size_t i = 0; i < solid.size(); i++) {
+            dist[i] = solid[i] == source ? 0.0f : std::numeric_limits<float>::infinity();
+        }
+
+        auto relax = [&](int x, int y, int nx, int ny, float weight) {
+            if (nx < 0 || nx >= width || ny < 0 || ny >= height) return;
+            float& d = dist[y * width + x];
+            d = std::min(d, dist[ny * width + nx] + weight);
+        };
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                relax(x, y, x - 1, y, 1.0f);
+                relax(x, y, x - 1, y - 1, DIAGONAL);
+                relax(x, y, x, y - 1, 1.0f);
+                relax(x, y, x + 1, y - 1, DIAGONAL);
+            }
+        }
+        for (int y = height - 1; y >= 0; y--) {
+            for (int x = width - 1; x >= 0; x--) {
+                relax(x, y, x + 1, y, 1.0f);
+                relax(x, y, x + 1, y + 1, DIAGONAL);
+                relax(x, y, x, y + 1, 1.0f);
+                relax(x, y, x - 1, y + 1, DIAGONAL);
+            }
+        }
+    }
+
+}
+
+namespace Bengine {
+
+    const int ParticleCollisionGrid::MAX_BOUNCES;
+
+    ParticleCollisionGrid::ParticleCollisionGrid() {
+        // Empty
+    }
+
+    ParticleCollisionGrid::~ParticleCollisionGrid() {
+        // Empty
+    }
+
+    void ParticleCollisionGrid::bake(const b2World* world, float cellSize) {
+        // Written so NaN is rejected too
+        if (!(cellSize > 0.0f)) {
+            fatalError("ParticleCollisionGrid cell size must be positive!");
+        }
+        dispose();
+        m_cellSize = cellSize;
+        m_invCellSize = 1.0f / cellSize;
+
+        // Only virtual and inline parts of Box2D are used, so linking it
+        // is up to the game
+        glm::vec2 lower(std::numeric_limits<float>::max());
+        glm::vec2 upper(-std::numeric_limits<float>::max());
+        for (const b2Body* body = world->GetBodyList(); body; body = body->GetNext()) {
+            if (body->GetType() != b2_staticBody) continue;
+            for (const b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+                if (fixture->IsSensor()) continue;
+                const b2Shape* shape = fixture->GetShape();
+                for (int32 child = 0; child < shape->GetChildCount(); child++) {
+                    b2AABB aabb;
+                    shape->ComputeAABB(&aabb, body->GetTransform(), child);
+                    lower = glm::min(lower, glm::vec2(aabb.lowerBound.x, aabb.lowerBound.y));
+                    upper = glm::max(upper, glm::vec2(aabb.upperBound.x, aabb.upperBound.y));
+                }
+            }
+        }
+        if (lower.x > upper.x) return;
+
+        // A ring of empty cells around the geometry, so every solid cell has
+        // a way out
+        m_origin = lower - glm::vec2(cellSize);
+        m_width = (int)std::ceil((upper.x - lower.x) * m_invCellSize) + 2;
+        m_height = (int)std::ceil((upper.y - lower.y) * m_invCellSize) + 2;
+        m_solid.assign((size_t)m_width * m_height, 0);
+
+        for (const b2Body* body = world->GetBodyList(); body; body = body->GetNext()) {
+            if (body->GetType() != b2_staticBody) continue;
+            const b2Transform& transform = body->GetTransform();
+            for (const b2Fixture* fixture = body->GetFixtureList(); fixture; fixture = fixture->GetNext()) {
+                if (fixture->IsSensor()) continue;
+                const b2Shape* shape = fixture->GetShape();
+                switch (shape->GetType()) {
+                    case b2Shape::e_edge: {
+                        const b2EdgeShape* edge = static_cast<const b2EdgeShape*>(shape);
+                        b2Vec2 a = b2Mul(transform, edge->m_vertex1);
+                        b2Vec2 b = b2Mul(transform, edge->m_vertex2);
+                        fillSegment(glm::vec2(a.x, a.y), glm::vec2(b.x, b.y));
+                        break;
+                    }
+                    case b2Shape::e_chain: {
+                        const b2ChainShape* chain = static_cast<const b2ChainShape*>(shape);
+                        for (int32 i = 0; i < shape->GetChildCount(); i++) {
+                            b2Vec2 a = b2Mul(transform, chain->m_vertices[i]);
+                            b2Vec2 b = b2Mul(transform, chain->m_vertices[i + 1]);
+                            fillSegment(glm::vec2(a.x, a.y), glm::vec2(b.x, b.y));
+                        }
+                        break;
+                    }
+                    default: {
+                        // Only the cells under the fixture's box need testing
+                        b2AABB aabb;
+                        shape->ComputeAABB(&aabb, transform, 0);
+                        int x0 = std::max((int)((aabb.lowerBound.x - m_origin.x) * m_invCellSize), 0);
+                        int y0 = std::max((int)((aabb.lowerBound.y - m_origin.y) * m_invCellSize), 0);
+                        int x1 = std::min((int)((aabb.upperBound.x - m_origin.x) * m_invCellSize), m_width - 1);
+                        int y1 = std::min((int)((aabb.upperBound.y - m_origin.y) * m_invCellSize), m_height - 1);
+                        for (int y = y0; y <= y1; y++) {
+                            for (int x = x0; x <= x1; x++) {
+                                b2Vec2 center(m_origin.x + (x + 0.5f) * cellSize, m_origin.y + (y + 0.5f) * cellSize);
+                                if (fixture->TestPoint(center)) {
+                                    m_solid[y * m_width + x] = 1;
+                                }
+                            }
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+
+        computeNormals();
+    }
+
+    void ParticleCollisionGrid::dispose() {
+        m_width = 0;
+        m_height = 0;
+        m_solid.clear();
+        m_solid.shrink_to_fit();
+        m_normals.clear();
+        m_normals.shrink_to_fit();
+    }
+
+    bool ParticleCollisionGrid::isSolid(const glm::vec2& position) const {
+        int cell = getCell(position.x, position.y);
+        return cell >= 0 && m_solid[cell];
+    }
+
+    glm::vec2 ParticleCollisionGrid::getNormal(const glm::vec2& position) const {
+        int cell = getCell(position.x, position.y);
+        return cell >= 0 ? m_normals[cell] : glm::vec2(0.0f);
+    }
+
+    void ParticleCollisionGrid::collide(float* x, float* y, float* vx, float* vy, size_t count,
+                                        float deltaTime, float restitution, float friction) const {
+        if (m_solid.empty()) return;
+
+        for (size_t i = 0; i < count; i++) {
+            // Where the particle is and the time it has left to move
+            float px = x[i];
+            float py = y[i];
+            float timeLeft = deltaTime;
+            int numBounces = 0;
+            bool stopped = false;
+            for (; numBounces < MAX_BOUNCES; numBounces++) {
+                // Only the part of the way inside the grid can hit anything
+                float enterTime = 0.0f;
+                float exitTime = timeLeft;
+                if (!clipToGrid(px, py, vx[i], vy[i], enterTime, exitTime)) break;
+
+                // Looks every half cell along that part, so no wall is
+                // stepped over. It is never longer than the grid's diagonal,
+                // and the clamp keeps huge or NaN speeds in range too.
+                float length = std::sqrt(vx[i] * vx[i] + vy[i] * vy[i]) * (exitTime - enterTime);
+                float samples = std::ceil(length * m_invCellSize * 2.0f);
+                int maxSamples = (m_width + m_height) * 2 + 1;
+                int numSamples = samples < (float)maxSamples ? std::max((int)samples, 1) : maxSamples;
+                float sampleTime = (exitTime - enterTime) / (float)numSamples;
+                int hit = -1;
+                int sample = 1;
+                for (; sample <= numSamples; sample++) {
+                    float time = enterTime + sampleTime * sample;
+                    int cell = getCell(px + vx[i] * time, py + vy[i] * time);
+                    if (cell >= 0 && m_solid[cell]) {
+                        hit = cell;
+                        break;
+                    }
+                }
+                if (hit < 0) break;
+
+                // Up to the last free sample. Where the way enters the grid
+                // is free too, since the ring around the geometry is empty.
+                float freeTime = enterTime + sampleTime * (sample - 1);
+                px += vx[i] * freeTime;
+                py += vy[i] * freeTime;
+                timeLeft -= freeTime;
+
+                int current = getCell(px, py);
+                glm::vec2 normal;
+                if (current >= 0 && m_solid[current]) {
+                    // Already inside, so it is only pushed out, and moves
+                    // freely once it heads out
+                    normal = m_normals[current];
+                    if (vx[i] * normal.x + vy[i] * normal.y >= 0.0f) break;
+                } else {
+                    // The free cell still sees the surface it comes from,
+                    // even where a wall is one cell thin. Near corners that
+                    // can point along the way in, so then the side of the
+                    // cell the particle goes through is bounced off instead.
+                    normal = current >= 0 ? m_normals[current] : glm::vec2(0.0f);
+                    if (vx[i] * normal.x + vy[i] * normal.y >= 0.0f) {
+                        float hitX = px + vx[i] * sampleTime;
+                        float hitY = py + vy[i] * sampleTime;
+                        normal = glm::vec2(std::floor((px - m_origin.x) * m_invCellSize) - std::floor((hitX - m_origin.x) * m_invCellSize),
+                                           std::floor((py - m_origin.y) * m_invCellSize) - std::floor((hitY - m_origin.y) * m_invCellSize));
+                        float normalLength = glm::length(normal);
+                        if (normalLength > 0.0f) {
+                            normal /= normalLength;
+                        }
+                    }
+                    if (vx[i] * normal.x + vy[i] * normal.y >= 0.0f) {
+                        stopped = true;
+                        break;
+                    }
+                }
+
+                float normalSpeed = vx[i] * normal.x + vy[i] * normal.y;
+                float tangentX = vx[i] - normalSpeed * normal.x;
+                float tangentY = vy[i] - normalSpeed * normal.y;
+                vx[i] = tangentX * (1.0f - friction) - normalSpeed * restitution * normal.x;
+                vy[i] = tangentY * (1.0f - friction) - normalSpeed * restitution * normal.y;
+            }
+            if (numBounces == 0 && !stopped) continue;
+
+            // The batch moves the particle by its velocity for deltaTime
+            // next, so it is put where that ends at the end of the path. A
+            // particle out of bounces, or with no way to bounce, stays at
+            // its last free point.
+            float moveTime = (numBounces < MAX_BOUNCES && !stopped) ? timeLeft : 0.0f;
+            x[i] = px + vx[i] * (moveTime - deltaTime);
+            y[i] = py + vy[i] * (moveTime - deltaTime);
+        }
+    }
+
+    size_t ParticleCollisionGrid::getNumSolid() const {
+        return (size_t)std::count(m_solid.begin(), m_solid.end(), (uint8_t)1);
+    }
+
+    int ParticleCollisionGrid::getCell(float x, float y) const {
+        float cellX = (x - m_origin.x) * m_invCellSize;
+        float cellY = (y - m_origin.y) * m_invCellSize;
+        // Written so NaN lands outside too
+        if (!(cellX >= 0.0f && cellX < (float)m_width && cellY >= 0.0f && cellY < (float)m_height)) return -1;
+        return (int)cellY * m_width + (int)cellX;
+    }
+
+    bool ParticleCollisionGrid::clipToGrid(float px, float py, float vx, float vy,
+                                           float& enterTime, float& exitTime) const {
+        // Narrows the times to those between the two sides of one axis
+        auto clipAxis = [&](float p, float v, float lower, float upper) {
+            if (v == 0.0f) return p >= lower && p <= upper;
+            float t0 = (lower - p) / v;
+            float t1 = (upper - p) / v;
+            if (t0 > t1) std::swap(t0, t1);
+            enterTime = std::max(enterTime, t0);
+            exitTime = std::min(exitTime, t1);
+            return true;
+        };
+        if (!clipAxis(px, vx, m_origin.x, m_origin.x + m_width * m_cellSize)) return false;
+        if (!clipAxis(py, vy, m_origin.y, m_origin.y + m_height * m_cellSize)) return false;
+        return enterTime < exitTime;
+    }
+
+    void ParticleCollisionGrid::fillSegment(const glm::vec2& a, const glm::vec2& b) {
+        int numSteps = std::max((int)std::ceil(glm::length(b - a) * m_invCellSize * 2.0f), 1);
+        for (int step = 0; step <= numSteps; step++) {
+            glm::vec2 point = a + (b - a) * ((float)step / numSteps);
+            int cell = getCell(point.x, point.y);
+            if (cell >= 0) {
+                m_solid[cell] = 1;
+            }
+        }
+    }
+
+    void ParticleCollisionGrid::computeNormals() {
+        m_normals.assign(m_solid.size(), glm::vec2(0.0f));
+        if (getNumSolid() == 0) return;
+
+        // Negative inside the geometry and positive outside, so it grows
+        // away from the surface on both sides of it
+        std::vector<float> toSolid;
+        std::vector<float> toEmpty;
+        distanceTransform(m_solid, 1, m_width, m_height, toSolid);
+        distanceTransform(m_solid, 0, m_width, m_height, toEmpty);
+        std::vector<float> distance(m_solid.size());
+        for (size_t i = 0; i < m_solid.size(); i++) {
+            distance[i] = m_solid[i] ? -toEmpty[i] : toSolid[i];
+        }
+
+        auto at = [&](int x, int y) {
+            x = std::min(std::max(x, 0), m_width - 1);
+            y = std::min(std::max(y, 0), m_height - 1);
+            return distance[y * m_width + x];
+        };
+        for (int y = 0; y < m_height; y++) {
+            for (int x = 0; x < m_width; x++) {
+                glm::vec2 gradient(at(x + 1, y) - at(x - 1, y), at(x, y + 1) - at(x, y - 1));
+                float length = glm::length(gradient);
+                if (length > 1e-6f) {
+                    m_normals[y * m_width + x] = gradient / length;
+                }
+            }
+        }
+    }
+
+}
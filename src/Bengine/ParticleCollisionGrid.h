@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class b2World;
+
+namespace Bengine {
+
+    // The static geometry of a b2World baked into a uniform grid, for
+    // particles to bounce off. Every cell knows whether it is solid and the
+    // direction out of the geometry there, taken from a signed distance
+    // field of the cells, so a particle only needs a lookup or two per
+    // update instead of a b2World::RayCast. See CollisionModule.
+    class ParticleCollisionGrid {
+    public:
+        ParticleCollisionGrid();
+        ~ParticleCollisionGrid();
+
+        // Bakes the fixtures of the static bodies of world into cells of
+        // cellSize world units, which must be positive. Sensors are left
+        // out. Polygons and circles fill the cells whose centers they
+        // contain, and edges and chains the cells they cross. Bake again
+        // after the static bodies change.
+        void bake(const b2World* world, float cellSize);
+        void dispose();
+
+        // Cells outside the grid are empty
+        bool isSolid(const glm::vec2& position) const;
+        // The unit direction out of the geometry at position, zero where
+        // there is no way out or outside the grid
+        glm::vec2 getNormal(const glm::vec2& position) const;
+
+        // Bounces the particles in [0, count) that would move into a solid
+        // cell during deltaTime off its surface, up to MAX_BOUNCES times.
+        // The part of the way inside the grid is looked at every half cell,
+        // so however long deltaTime is, particles don't pass through walls,
+        // and particles whose way misses the grid cost no lookups. restitution
+        // scales the velocity along the normal and friction takes that part
+        // of the rest. The caller moves the particles by their velocity for
+        // deltaTime afterwards, so a bounced particle is put where that move
+        // ends up at the end of its bounced path.
+        void collide(float* x, float* y, float* vx, float* vy, size_t count,
+                     float deltaTime, float restitution, float friction) const;
+
+        const glm::vec2& getOrigin() const { return m_origin; }
+        float getCellSize() const { return m_cellSize; }
+        int getWidth() const { return m_width; }
+        int getHeight() const { return m_height; }
+        // Solid cells, for checking a bake
+        size_t getNumSolid() const;
+
+        // The most bounces collide() follows per particle in one call
+        static const int MAX_BOUNCES = 4;
+
+    private:
+        // The cell position lies in, or -1 outside the grid
+        int getCell(float x, float y) const;
+        // Narrows [enterTime, exitTime] to the times the way from (px, py)
+        // at (vx, vy) is inside the grid. False if it never is.
+        bool clipToGrid(float px, float py, float vx, float vy, float& enterTime, float& exitTime) const;
+        // Marks the cells a segment crosses, by stepping half a cell at a time
+        void fillSegment(const glm::vec2& a, const glm::vec2& b);
+        // Works out m_normals from a signed distance field of m_solid
+        void computeNormals();
+
+        glm::vec2 m_origin = glm::vec2(0.0f); ///< World position of the corner of cell 0
+        float m_cellSize = 1.0f;
+        float m_invCellSize = 1.0f;
+        int m_width = 0;
+        int m_height = 0;
+        std::vector<uint8_t> m_solid; ///< Row by row, bottom row first
+        std::vector<glm::vec2> m_normals;
+    };
+
+}
@@ -0,0 +1,131 @@
+#include "ParticleEmitter2D.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+    const float TWO_PI = 6.28318531f;
+}
+
+namespace Bengine {
+
+    ParticleEmitter2D::ParticleEmitter2D() {
+        // Emitters are numbered in the order they are created
+        static std::atomic<uint32_t> numEmitters(0);
+        seedParticleRandom(m_spawn.random, numEmitters++);
+    }
+
+    ParticleEmitter2D::~ParticleEmitter2D() {
+        // Empty
+    }
+
+    void ParticleEmitter2D::init(IParticleBatch2D* batch) {
+        m_batch = batch;
+        m_rateRemainder = 0.0f;
+    }
+
+    void ParticleEmitter2D::update(float deltaTime) {
+        if (!m_batch) return;
+        m_rateRemainder += m_rate * m_batch->getSpawnScale() * deltaTime;
+        size_t count = (size_t)m_rateRemainder;
+        m_rateRemainder -= (float)count;
+        spawn(count);
+    }
+
+    void ParticleEmitter2D::burst(size_t count) {
+        if (!m_batch) return;
+        float spawnScale = m_batch->getSpawnScale();
+        if (spawnScale != 1.0f) {
+            count = (size_t)((float)count * spawnScale + 0.5f);
+        }
+        spawn(count);
+    }
+
+    void ParticleEmitter2D::skipAhead(size_t numSteps, float stepTime) {
+        if (!m_batch) return;
+        const float rate = m_rate * m_batch->getSpawnScale();
+        size_t count = 0;
+        for (size_t step = 0; step < numSteps; step++) {
+            // The same sums as update(), so the remainder ends up the same
+            m_rateRemainder += rate * stepTime;
+            size_t stepCount = (size_t)m_rateRemainder;
+            m_rateRemainder -= (float)stepCount;
+            count += stepCount;
+        }
+        skipParticleRandom(m_spawn.random, (uint32_t)(count * getRandomValuesPerParticle()));
+    }
+
+    size_t ParticleEmitter2D::getRandomValuesPerParticle() const {
+        // The angle and speed of the velocity, the width and the color, and
+        // what the shape needs for the position
+        switch (m_spawn.shape) {
+            case EmitterShape::CIRCLE:
+                return 4 + 3;
+            case EmitterShape::BOX:
+            case EmitterShape::CONE:
+                return 4 + 2;
+            default:
+                return 4;
+        }
+    }
+
+    void ParticleEmitter2D::spawn(size_t count) {
+        if (count == 0) return;
+
+        // Batches that make the particles themselves only need the settings
+        if (m_batch->spawnParticles(m_spawn, count)) {
+            skipParticleRandom(m_spawn.random, (uint32_t)(count * getRandomValuesPerParticle()));
+            return;
+        }
+
+        m_x.resize(count);
+        m_y.resize(count);
+        m_vx.resize(count);
+        m_vy.resize(count);
+        m_width.resize(count);
+        m_color.resize(count);
+        m_angles.resize(count);
+        m_lengths.resize(count);
+
+        ParticleRandom& random = m_spawn.random;
+
+        // CONE needs the angles of the velocities for the positions too
+        const float minAngle = m_spawn.direction - m_spawn.spread * 0.5f;
+        const float maxAngle = m_spawn.direction + m_spawn.spread * 0.5f;
+        randomParticleFloats(random, m_angles.data(), count, minAngle, maxAngle);
+        randomParticleFloats(random, m_lengths.data(), count, m_spawn.minSpeed, m_spawn.maxSpeed);
+        polarToParticles(m_angles.data(), m_lengths.data(), m_vx.data(), m_vy.data(), count, 0.0f, 0.0f);
+
+        switch (m_spawn.shape) {
+            case EmitterShape::POINT:
+                std::fill(m_x.begin(), m_x.end(), m_spawn.position.x);
+                std::fill(m_y.begin(), m_y.end(), m_spawn.position.y);
+                break;
+            case EmitterShape::CIRCLE:
+                randomParticleFloats(random, m_angles.data(), count, 0.0f, TWO_PI);
+                randomParticleRadii(random, m_lengths.data(), count, m_spawn.radius);
+                polarToParticles(m_angles.data(), m_lengths.data(), m_x.data(), m_y.data(), count,
+                                 m_spawn.position.x, m_spawn.position.y);
+                break;
+            case EmitterShape::BOX: {
+                glm::vec2 halfDims = m_spawn.dimensions * 0.5f;
+                randomParticleFloats(random, m_x.data(), count, m_spawn.position.x - halfDims.x, m_spawn.position.x + halfDims.x);
+                randomParticleFloats(random, m_y.data(), count, m_spawn.position.y - halfDims.y, m_spawn.position.y + halfDims.y);
+                break;
+            }
+            case EmitterShape::CONE:
+                randomParticleRadii(random, m_lengths.data(), count, m_spawn.radius);
+                polarToParticles(m_angles.data(), m_lengths.data(), m_x.data(), m_y.data(), count,
+                                 m_spawn.position.x, m_spawn.position.y);
+                break;
+        }
+
+        randomParticleFloats(random, m_width.data(), count, m_spawn.minWidth, m_spawn.maxWidth);
+        // The blend goes from colorB at 0 to colorA at 1
+        randomParticleFloats(random, m_lengths.data(), count, 0.0f, 1.0f);
+        blendParticleColors(m_lengths.data(), m_color.data(), count, m_spawn.colorA, m_spawn.colorB);
+
+        m_batch->addParticles(m_x.data(), m_y.data(), m_vx.data(), m_vy.data(), m_color.data(), m_width.data(), count);
+    }
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "IParticleBatch2D.h"
+#include "ParticleKernels.h"
+#include "Vertex.h"
+
+namespace Bengine {
+
+    // Where an emitter puts new particles
+    enum class EmitterShape {
+        POINT, ///< All at the position
+        CIRCLE, ///< Anywhere in a disk of radius around the position
+        BOX, ///< Anywhere in a box of dimensions centered on the position
+        CONE ///< Anywhere in the slice of the disk the particles fly out of
+    };
+
+    // The settings and random stream an emitter makes its particles from,
+    // passed to IParticleBatch2D::spawnParticles() for batches that make them
+    // themselves. Of count particles, particle i takes value i of each run of
+    // count values in the stream, in this order: the angle and the speed of
+    // the velocity, what the shape needs for the position (the angle and two
+    // for the radius of CIRCLE, x and y of BOX, two for the radius of CONE),
+    // the width, and where the color is between colorB and colorA.
+    struct ParticleSpawn {
+        EmitterShape shape = EmitterShape::POINT;
+        glm::vec2 position = glm::vec2(0.0f);
+        float radius = 0.0f; ///< Of CIRCLE and CONE
+        glm::vec2 dimensions = glm::vec2(0.0f); ///< Of BOX
+        float direction = 0.0f;
+        float spread = 6.28318531f;
+        float minSpeed = 0.0f;
+        float maxSpeed = 0.0f;
+        float minWidth = 1.0f;
+        float maxWidth = 1.0f;
+        ColorRGBA8 colorA = ColorRGBA8(255, 255, 255, 255);
+        ColorRGBA8 colorB = ColorRGBA8(255, 255, 255, 255);
+        ParticleRandom random; ///< At the first value of the next spawn
+    };
+
+    // Adds particles to a batch, either steadily at a rate or in bursts. Each
+    // spawn makes all its particles in one pass per field with the kernels of
+    // ParticleKernels.h and hands them to the batch with addParticles(), so an
+    // explosion of 20000 particles is a single burst() call.
+    //
+    // Every emitter has a random stream of its own, so emitters on different
+    // threads never share state, and an emitter given the same seed, calls
+    // and batch spawn scale makes the same particles, e.g. for replays.
+    //
+    // Every particle flies at an angle in [direction - spread / 2, direction + spread / 2]
+    // with a speed in [minSpeed, maxSpeed], and gets a width in [minWidth, maxWidth]
+    // and a color between the two colors.
+    class ParticleEmitter2D {
+    public:
+        ParticleEmitter2D();
+        ~ParticleEmitter2D();
+
+        // batch isn't owned and has to outlive the emitter's use of it
+        void init(IParticleBatch2D* batch);
+
+        // Spawns rate particles per second, carrying fractions over to the
+        // next update. The rate is scaled by the spawn scale of the batch, see
+        // IParticleBatch2D::setSpawnScale().
+        void update(float deltaTime);
+
+        // Spawns count particles right away, scaled by the spawn scale of the
+        // batch and rounded
+        void burst(size_t count);
+
+        // Leaves the emitter as numSteps calls of update(stepTime) would,
+        // without making any particles. The random stream is only moved on,
+        // so this is quick for any number of steps. See
+        // ParticleEngine2D::skipAhead().
+        void skipAhead(size_t numSteps, float stepTime);
+
+        // Restarts the random stream from seed. Emitters are seeded with the
+        // order they were created in otherwise, counted over the whole
+        // program, so a replay only makes the same particles without a seed
+        // if every emitter is created in the same order as before. Set a seed
+        // for anything that has to replay.
+        void setSeed(uint32_t seed) { seedParticleRandom(m_spawn.random, seed); }
+
+        void setPosition(const glm::vec2& position) { m_spawn.position = position; }
+        // Angles are in radians. A spread of 2 pi sends particles everywhere.
+        void setDirection(float direction, float spread) { m_spawn.direction = direction; m_spawn.spread = spread; }
+        void setSpeed(float minSpeed, float maxSpeed) { m_spawn.minSpeed = minSpeed; m_spawn.maxSpeed = maxSpeed; }
+        void setWidth(float minWidth, float maxWidth) { m_spawn.minWidth = minWidth; m_spawn.maxWidth = maxWidth; }
+        void setColor(const ColorRGBA8& colorA, const ColorRGBA8& colorB) { m_spawn.colorA = colorA; m_spawn.colorB = colorB; }
+        // Particles per second for update()
+        void setRate(float rate) { m_rate = rate; }
+
+        void setPoint() { m_spawn.shape = EmitterShape::POINT; }
+        void setCircle(float radius) { m_spawn.shape = EmitterShape::CIRCLE; m_spawn.radius = radius; }
+        void setBox(const glm::vec2& dimensions) { m_spawn.shape = EmitterShape::BOX; m_spawn.dimensions = dimensions; }
+        void setCone(float radius) { m_spawn.shape = EmitterShape::CONE; m_spawn.radius = radius; }
+
+        const glm::vec2& getPosition() const { return m_spawn.position; }
+        EmitterShape getShape() const { return m_spawn.shape; }
+        float getRate() const { return m_rate; }
+
+    private:
+        // Makes count particles and adds them to the batch
+        void spawn(size_t count);
+        // How many values of the random stream spawn() takes per particle
+        size_t getRandomValuesPerParticle() const;
+
+        IParticleBatch2D* m_batch = nullptr;
+
+        ParticleSpawn m_spawn;
+        float m_rate = 0.0f;
+        float m_rateRemainder = 0.0f; ///< The part of a particle update() owes the next one
+
+        // The particles of the spawn being made, one array per field
+        std::vector<float> m_x;
+        std::vector<float> m_y;
+        std::vector<float> m_vx;
+        std::vector<float> m_vy;
+        std::vector<float> m_width;
+        std::vector<ColorRGBA8> m_color;
+        std::vector<float> m_angles;
+        std::vector<float> m_lengths;
+    };
+
+}
@@ -1,10 +1,19 @@
 #include "ParticleEngine2D.h"
 
+#include "Camera2D.h"
+#include "GPUParticleBatch2D.h"
 #include "ParticleBatch2D.h"
+#include "ParticleEmitter2D.h"
 #include "SpriteBatch.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
 
 namespace Bengine {
 
+    const int ParticleEngine2D::MAX_UPDATE_INTERVAL;
+    const int ParticleEngine2D::OFFSCREEN_UPDATE_INTERVAL;
 
     ParticleEngine2D::ParticleEngine2D() {
         // Empty
@@ -14,26 +23,254 @@ namespace Bengine {
         for (auto& b : m_batches) {
             delete b;
         }
+        for (auto& b : m_gpuBatches) {
+            delete b;
+        }
     }
 
     void ParticleEngine2D::addParticleBatch(ParticleBatch2D* particleBatch) {
         m_batches.push_back(particleBatch);
+        m_lods.emplace_back();
+    }
+
+    void ParticleEngine2D::addParticleBatch(GPUParticleBatch2D* particleBatch) {
+        m_gpuBatches.push_back(particleBatch);
+    }
+
+    void ParticleEngine2D::addEmitter(ParticleEmitter2D* emitter) {
+        m_emitters.push_back(emitter);
+    }
+
+    void ParticleEngine2D::removeEmitter(ParticleEmitter2D* emitter) {
+        m_emitters.erase(std::remove(m_emitters.begin(), m_emitters.end(), emitter), m_emitters.end());
     }
 
     void ParticleEngine2D::update(float deltaTime) {
+        m_stats = ParticleEngineStats();
+        if (m_fixedStep <= 0.0f) {
+            step(deltaTime, true);
+            setDrawAhead(0.0f);
+            return;
+        }
+
+        // Only whole steps are taken, so how the time is cut into frames
+        // doesn't change what happens. Within a thousandth of a step counts
+        // as a whole one, so rounding in the sums can't lose a step.
+        m_stepRemainder += deltaTime;
+        int numSteps = 0;
+        while (m_stepRemainder >= m_fixedStep * 0.999f) {
+            if (m_maxStepsPerUpdate > 0 && numSteps == m_maxStepsPerUpdate) {
+                // Taking every step of a long frame would make the next frame
+                // longer still, so the time that doesn't fit is dropped
+                m_stepRemainder = std::min(m_stepRemainder, m_fixedStep * 0.999f);
+                break;
+            }
+            m_stepRemainder -= m_fixedStep;
+            step(m_fixedStep, true);
+            numSteps++;
+        }
+        setDrawAhead(std::max(m_stepRemainder, 0.0f));
+    }
+
+    void ParticleEngine2D::skipAhead(size_t numSteps) {
+        if (m_fixedStep <= 0.0f) return;
+        m_stats = ParticleEngineStats();
+
+        // The batches the camera held back catch up first, so their modules
+        // don't lose that time, and everything spawns at the full rate from
+        // here on, as the steps below do
+        for (size_t i = 0; i < m_batches.size(); i++) {
+            if (m_lods[i].pendingTime > 0.0f) {
+                m_batches[i]->update(m_lods[i].pendingTime);
+            }
+            m_lods[i].pendingTime = 0.0f;
+            m_lods[i].framesWaited = 0;
+        }
+        setPendingTimes();
+        computeUpdateIntervals(false);
+
+        // Whatever lives at the start, or is spawned before the last
+        // lifetimeSteps steps, is dead by the end, so those steps only move
+        // the emitters and the modules on
+        size_t lifetimeSteps = 0;
         for (auto& b : m_batches) {
+            lifetimeSteps = std::max(lifetimeSteps, b->getLifetimeSteps(m_fixedStep));
+        }
+        for (auto& b : m_gpuBatches) {
+            lifetimeSteps = std::max(lifetimeSteps, b->getLifetimeSteps(m_fixedStep));
+        }
+        if (numSteps > lifetimeSteps) {
+            const size_t numSkipped = numSteps - lifetimeSteps;
+            for (auto& e : m_emitters) {
+                e->skipAhead(numSkipped, m_fixedStep);
+            }
+            for (auto& b : m_batches) {
+                b->skipAhead(numSkipped, m_fixedStep);
+            }
+            for (auto& b : m_gpuBatches) {
+                b->skipAhead(numSkipped, m_fixedStep);
+            }
+            numSteps = lifetimeSteps;
+        }
+
+        for (size_t i = 0; i < numSteps; i++) {
+            step(m_fixedStep, false);
+        }
+        setDrawAhead(std::max(m_stepRemainder, 0.0f));
+    }
+
+    void ParticleEngine2D::step(float deltaTime, bool useLod) {
+        // The emitters spawn at the spawn scales of this step
+        computeUpdateIntervals(useLod);
+        for (auto& e : m_emitters) {
+            e->update(deltaTime);
+        }
+
+        for (auto& b : m_gpuBatches) {
+            m_stats.numSimulated += b->getNumAlive();
+            m_stats.numBatchesUpdated++;
             b->update(deltaTime);
         }
+
+        m_dueBatches.clear();
+        for (size_t i = 0; i < m_batches.size(); i++) {
+            BatchLod& lod = m_lods[i];
+            lod.pendingTime += deltaTime;
+            lod.framesWaited++;
+            if (lod.framesWaited >= lod.interval) {
+                m_dueBatches.push_back(i);
+                m_stats.numSimulated += m_batches[i]->getNumAlive();
+                m_stats.numBatchesUpdated++;
+            } else {
+                m_stats.numSkipped += m_batches[i]->getNumAlive();
+                m_stats.numBatchesSkipped++;
+            }
+        }
+
+        if (!m_threadPool) {
+            for (size_t i : m_dueBatches) {
+                m_batches[i]->update(m_lods[i].pendingTime);
+            }
+        } else {
+            // Every range of every batch is a job of its own, so one big batch
+            // is spread over all threads too
+            m_updateJobs.clear();
+            for (size_t i : m_dueBatches) {
+                m_batches[i]->beginUpdate(m_lods[i].pendingTime);
+                for (size_t range = 0; range < m_batches[i]->getNumUpdateRanges(); range++) {
+                    m_updateJobs.emplace_back(i, range);
+                }
+            }
+
+            m_threadPool->parallelFor(m_updateJobs.size(), [this](size_t job) {
+                size_t i = m_updateJobs[job].first;
+                m_batches[i]->updateRange(m_updateJobs[job].second, m_lods[i].pendingTime);
+            });
+
+            m_threadPool->parallelFor(m_dueBatches.size(), [this](size_t due) {
+                m_batches[m_dueBatches[due]]->endUpdate();
+            });
+        }
+
+        for (size_t i : m_dueBatches) {
+            m_lods[i].pendingTime = 0.0f;
+            m_lods[i].framesWaited = 0;
+        }
+        setPendingTimes();
+    }
+
+    void ParticleEngine2D::setPendingTimes() {
+        for (size_t i = 0; i < m_batches.size(); i++) {
+            m_batches[i]->setPendingTime(m_lods[i].pendingTime);
+        }
+    }
+
+    void ParticleEngine2D::setDrawAhead(float drawAhead) {
+        for (size_t i = 0; i < m_batches.size(); i++) {
+            m_batches[i]->setDrawAhead(m_lods[i].pendingTime + drawAhead);
+        }
+    }
+
+    void ParticleEngine2D::computeUpdateIntervals(bool useLod) {
+        if (!m_camera || !useLod) {
+            for (size_t i = 0; i < m_batches.size(); i++) {
+                m_lods[i].interval = 1;
+                m_batches[i]->setSpawnScale(1.0f);
+            }
+            return;
+        }
+
+        const glm::vec4 viewRect = m_camera->getViewRect();
+        const glm::vec2& cameraPosition = m_camera->getPosition();
+        float load = 0.0f; ///< Particles updated per frame on average
+        for (size_t i = 0; i < m_batches.size(); i++) {
+            BatchLod& lod = m_lods[i];
+            const size_t numAlive = m_batches[i]->getNumAlive();
+            lod.interval = 1;
+            if (numAlive > 0) {
+                glm::vec4 bounds = m_batches[i]->getBounds();
+                bool onScreen = bounds.x < viewRect.x + viewRect.z && bounds.x + bounds.z > viewRect.x &&
+                                bounds.y < viewRect.y + viewRect.w && bounds.y + bounds.w > viewRect.y;
+                if (!onScreen) {
+                    lod.interval = OFFSCREEN_UPDATE_INTERVAL;
+                } else if (m_lodDistance > 0.0f) {
+                    // From the camera to the nearest point of the bounds
+                    glm::vec2 offset(std::max(std::max(bounds.x - cameraPosition.x, cameraPosition.x - bounds.x - bounds.z), 0.0f),
+                                     std::max(std::max(bounds.y - cameraPosition.y, cameraPosition.y - bounds.y - bounds.w), 0.0f));
+                    lod.interval = std::min(1 + (int)(glm::length(offset) / m_lodDistance), MAX_UPDATE_INTERVAL);
+                }
+            }
+            load += (float)numAlive / (float)lod.interval;
+        }
+
+        if (m_particleBudget > 0 && load > (float)m_particleBudget) {
+            const float pressure = load / (float)m_particleBudget;
+            for (size_t i = 0; i < m_batches.size(); i++) {
+                BatchLod& lod = m_lods[i];
+                if (lod.interval < OFFSCREEN_UPDATE_INTERVAL && m_batches[i]->getNumAlive() > 0) {
+                    lod.interval = std::min((int)std::ceil((float)lod.interval * pressure), MAX_UPDATE_INTERVAL);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < m_batches.size(); i++) {
+            m_batches[i]->setSpawnScale(1.0f / (float)m_lods[i].interval);
+        }
     }
 
     void ParticleEngine2D::draw(SpriteBatch* spriteBatch) {
-        for (auto& b : m_batches) {
-            spriteBatch->begin();
+        drawBlendMode(spriteBatch, ParticleBlendMode::ALPHA);
+        drawBlendMode(spriteBatch, ParticleBlendMode::PREMULTIPLIED);
+        drawBlendMode(spriteBatch, ParticleBlendMode::ADDITIVE);
+        setParticleBlendFunc(ParticleBlendMode::ALPHA);
+
+        for (auto& b : m_gpuBatches) {
             b->draw(spriteBatch);
-            spriteBatch->end();
-            spriteBatch->renderBatch();
         }
     }
 
+    void ParticleEngine2D::drawBlendMode(SpriteBatch* spriteBatch, ParticleBlendMode blendMode) {
+        bool any = false;
+        for (auto& b : m_batches) {
+            if (b->getBlendMode() == blendMode && b->getNumAlive() > 0) {
+                any = true;
+                break;
+            }
+        }
+        if (!any) return;
+
+        // Every batch is already one run of glyphs with the same texture, in
+        // the order the batch wants them
+        spriteBatch->begin(GlyphSortType::NONE);
+        for (auto& b : m_batches) {
+            if (b->getBlendMode() == blendMode) {
+                b->draw(spriteBatch);
+            }
+        }
+        spriteBatch->end();
+        setParticleBlendFunc(blendMode);
+        spriteBatch->renderBatch();
+    }
+
 
 }
\ No newline at end of file
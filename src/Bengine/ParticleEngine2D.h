@@ -1,11 +1,27 @@
 #pragma once
 
+#include <cstddef>
+#include <utility>
 #include <vector>
 
+#include "IParticleBatch2D.h"
+
 namespace Bengine {
 
+    class Camera2D;
+    class GPUParticleBatch2D;
     class ParticleBatch2D;
+    class ParticleEmitter2D;
     class SpriteBatch;
+    class ThreadPool;
+
+    // What the last ParticleEngine2D::update() or skipAhead() did
+    struct ParticleEngineStats {
+        size_t numSimulated = 0; ///< Live particles of the batches that were updated
+        size_t numSkipped = 0; ///< Live particles of the batches left for a later update
+        size_t numBatchesUpdated = 0;
+        size_t numBatchesSkipped = 0;
+    };
 
     class ParticleEngine2D {
     public:
@@ -15,13 +31,117 @@ namespace Bengine {
         // After adding a particle batch, the ParticleEngine2D becomes
         // responsible for deallocation.
         void addParticleBatch(ParticleBatch2D* particleBatch);
+        // GPU batches are updated before the CPU ones, so the GPU works on them
+        // meanwhile, and drawn after. Both happen on the thread calling
+        // update() and draw(), which needs the GL context.
+        void addParticleBatch(GPUParticleBatch2D* particleBatch);
+
+        // Updates the ranges of all batches on threadPool from now on, or on
+        // the calling thread again for nullptr. The pool isn't owned and has
+        // to outlive its use here. Batches with an updateFunc are updated on
+        // one thread each, but different batches can call theirs at once.
+        void setThreadPool(ThreadPool* threadPool) { m_threadPool = threadPool; }
+
+        // Updates the emitter at the start of every step, before the batches are.
+        // Emitters aren't owned, so remove them before deleting them.
+        void addEmitter(ParticleEmitter2D* emitter);
+        void removeEmitter(ParticleEmitter2D* emitter);
+
+        // Steps everything by exactly stepTime from now on. update() adds its
+        // deltaTime to what is left over and takes as many whole steps as fit,
+        // so the same seeds and the same total time give the same particles
+        // however the time was cut into frames, e.g. for replays. The CPU
+        // batches are drawn ahead by the time left over. The intervals of
+        // setCamera() are counted in steps then. 0, the default, takes one
+        // step of deltaTime per update().
+        void setFixedStep(float stepTime) { m_fixedStep = stepTime; m_stepRemainder = 0.0f; }
+        // Caps the fixed steps one update() takes, so a long frame can't make
+        // the next one longer still. The time past the cap is dropped, which
+        // replays only see if their frames hit it too. 8 by default, 0 for no cap.
+        void setMaxStepsPerUpdate(int maxSteps) { m_maxStepsPerUpdate = maxSteps; }
+
+        // Takes numSteps fixed steps right away, for all batches whether they
+        // are seen or not, e.g. to bring an effect up to date when it comes
+        // into view. Steps before the last lifetime of particles spawn
+        // nothing that survives, so they only move the emitters and batches
+        // on, see IParticleBatch2D::skipAhead(). That makes skipping any
+        // number of steps cost about as much as one lifetime of them, and
+        // gives the same particles as taking the steps one by one, though
+        // perhaps in another order, as long as no pool fills up. Needs a
+        // fixed step.
+        void skipAhead(size_t numSteps);
+
+        // Updates the CPU batches less often the less they are seen by camera,
+        // from now on. Off-screen batches are only updated every
+        // OFFSCREEN_UPDATE_INTERVAL frames. On-screen ones wait a frame more
+        // for every lodDistance world units between the camera position and
+        // their bounds, up to MAX_UPDATE_INTERVAL frames. A batch that waits
+        // is updated with all the time it missed at once, drawn extrapolated
+        // by it in between, and gets a spawn scale of one over its interval.
+        // Particles added while it waits are back-dated by the time it already
+        // missed, see ParticleBatch2D::setPendingTime().
+        // Empty batches are always updated, so their emitters keep spawning.
+        // The camera isn't owned and has to outlive its use here. nullptr,
+        // the default, updates every batch every frame.
+        void setCamera(const Camera2D* camera) { m_camera = camera; }
+        // 0, the default, keeps on-screen batches at the full rate
+        void setLodDistance(float lodDistance) { m_lodDistance = lodDistance; }
+        // With a camera, stretches the intervals of the on-screen batches when
+        // they would update more than particleBudget particles per frame on
+        // average. 0, the default, means no budget.
+        void setParticleBudget(size_t particleBudget) { m_particleBudget = particleBudget; }
 
         void update(float deltaTime);
 
+        const ParticleEngineStats& getStats() const { return m_stats; }
+
+        static const int MAX_UPDATE_INTERVAL = 8;
+        static const int OFFSCREEN_UPDATE_INTERVAL = 30;
+
+        // Draws the CPU batches in one begin() and end() of spriteBatch per
+        // blend mode, ALPHA first, then PREMULTIPLIED and ADDITIVE on top,
+        // rendering each with its blend function. Each batch adds its particles
+        // together and with one texture, so spriteBatch doesn't sort them at
+        // all. Then renders the GPU batches. The ALPHA function is set again at
+        // the end.
         void draw(SpriteBatch* spriteBatch);
 
     private:
+        // How often a CPU batch is updated
+        struct BatchLod {
+            int interval = 1; ///< Frames from one update to the next
+            int framesWaited = 0; ///< Frames since the last update
+            float pendingTime = 0.0f; ///< Time since the last update
+        };
+
+        // Draws and renders the CPU batches of blendMode, if there are any
+        void drawBlendMode(SpriteBatch* spriteBatch, ParticleBlendMode blendMode);
+        // Updates the emitters and the batches by deltaTime, the CPU batches
+        // only when their interval is up if useLod is set
+        void step(float deltaTime, bool useLod);
+        // Tells every CPU batch the time it is owed, so it back-dates the
+        // particles added meanwhile
+        void setPendingTimes();
+        // Draws every CPU batch ahead by its pending time plus drawAhead
+        void setDrawAhead(float drawAhead);
+        // Sets the interval and spawn scale of every CPU batch from the
+        // camera, or to the full rate without useLod
+        void computeUpdateIntervals(bool useLod);
+
         std::vector<ParticleBatch2D*> m_batches;
+        std::vector<GPUParticleBatch2D*> m_gpuBatches;
+        ThreadPool* m_threadPool = nullptr;
+        std::vector<std::pair<size_t, size_t>> m_updateJobs; ///< Batch and range of every job of update()
+        std::vector<ParticleEmitter2D*> m_emitters;
+        std::vector<BatchLod> m_lods; ///< Of each of m_batches
+        std::vector<size_t> m_dueBatches; ///< The batches update() updates this frame
+        const Camera2D* m_camera = nullptr;
+        float m_lodDistance = 0.0f;
+        size_t m_particleBudget = 0;
+        ParticleEngineStats m_stats;
+        float m_fixedStep = 0.0f;
+        float m_stepRemainder = 0.0f; ///< Time update() was given that no step took yet
+        int m_maxStepsPerUpdate = 8;
     };
 
 }
\ No newline at end of file
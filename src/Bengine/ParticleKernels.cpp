@@ -0,0 +1,668 @@
+#include "ParticleKernels.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define BENGINE_PARTICLE_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#define BENGINE_PARTICLE_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BENGINE_PARTICLE_NEON
+#endif
+
+namespace Bengine {
+
+namespace {
+
+    // Scalar integration of particles [begin, end), appends to deadIndices
+    size_t integrateRange(float* x, float* y, const float* vx, const float* vy, float* life,
+                          size_t begin, size_t end, float deltaTime, float decayRate, unsigned int* deadIndices) {
+        const float decay = decayRate * deltaTime;
+        size_t numDead = 0;
+        for (size_t i = begin; i < end; i++) {
+            if (life[i] > 0.0f) {
+                x[i] += vx[i] * deltaTime;
+                y[i] += vy[i] * deltaTime;
+                life[i] -= decay;
+                if (life[i] <= 0.0f) {
+                    deadIndices[numDead++] = (unsigned int)i;
+                }
+            }
+        }
+        return numDead;
+    }
+
+    // Life clamped to [0, 1], for blending start and end values
+    inline float clampLife(float life) {
+        return life < 0.0f ? 0.0f : (life > 1.0f ? 1.0f : life);
+    }
+
+    const float INV_TWO_PI = 0.159154943f;
+
+    // A parabola through the zeros and peaks of sin, then a correction step.
+    // The SIMD versions do the same operations in the same order.
+    inline float fastSin(float radians) {
+        // Turns, wrapped to [-0.5, 0.5]
+        float t = radians * INV_TWO_PI;
+        t -= (float)(int)(t + (t >= 0.0f ? 0.5f : -0.5f));
+        float y = 8.0f * t - 16.0f * t * std::abs(t);
+        return 0.225f * (y * std::abs(y) - y) + y;
+    }
+
+    void accelerateRange(float* vx, float* vy, size_t begin, size_t end, float dvx, float dvy) {
+        for (size_t i = begin; i < end; i++) {
+            vx[i] += dvx;
+            vy[i] += dvy;
+        }
+    }
+
+    void scaleVelocitiesRange(float* vx, float* vy, size_t begin, size_t end, float scale) {
+        for (size_t i = begin; i < end; i++) {
+            vx[i] *= scale;
+            vy[i] *= scale;
+        }
+    }
+
+    void blendColorsRange(const float* life, ColorRGBA8* color, size_t begin, size_t end,
+                          const ColorRGBA8& startColor, const ColorRGBA8& endColor) {
+        const float endR = endColor.r, endG = endColor.g, endB = endColor.b, endA = endColor.a;
+        const float rangeR = startColor.r - endR, rangeG = startColor.g - endG;
+        const float rangeB = startColor.b - endB, rangeA = startColor.a - endA;
+        for (size_t i = begin; i < end; i++) {
+            float t = clampLife(life[i]);
+            color[i].r = (GLubyte)(endR + rangeR * t + 0.5f);
+            color[i].g = (GLubyte)(endG + rangeG * t + 0.5f);
+            color[i].b = (GLubyte)(endB + rangeB * t + 0.5f);
+            color[i].a = (GLubyte)(endA + rangeA * t + 0.5f);
+        }
+    }
+
+    void blendWidthsRange(const float* life, float* width, size_t begin, size_t end, float startWidth, float endWidth) {
+        const float range = startWidth - endWidth;
+        for (size_t i = begin; i < end; i++) {
+            width[i] = endWidth + range * clampLife(life[i]);
+        }
+    }
+
+    void swirlRange(const float* x, const float* y, float* vx, float* vy, size_t begin, size_t end,
+                    float frequency, float phaseX, float phaseY, float dv) {
+        for (size_t i = begin; i < end; i++) {
+            vx[i] += dv * fastSin(y[i] * frequency + phaseX);
+            vy[i] += dv * fastSin(x[i] * frequency + phaseY);
+        }
+    }
+
+    const float HALF_PI = 1.57079633f;
+    const uint32_t ONE_BITS = 0x3f800000;
+
+    // Squirrel Eiserloh's Squirrel3 noise, a hash of position and seed that is
+    // good enough to use as a random number
+    const uint32_t NOISE1 = 0xb5297a4d;
+    const uint32_t NOISE2 = 0x68e31da4;
+    const uint32_t NOISE3 = 0x1b56c4e9;
+
+    inline uint32_t squirrelNoise(uint32_t position, uint32_t seed) {
+        uint32_t bits = position * NOISE1;
+        bits += seed;
+        bits ^= bits >> 8;
+        bits += NOISE2;
+        bits ^= bits << 8;
+        bits *= NOISE3;
+        bits ^= bits >> 8;
+        return bits;
+    }
+
+    // The top 23 bits as the mantissa of a float in [1, 2), minus 1
+    inline float unitFloat(uint32_t bits) {
+        uint32_t floatBits = (bits >> 9) | ONE_BITS;
+        float value;
+        std::memcpy(&value, &floatBits, sizeof(value));
+        return value - 1.0f;
+    }
+
+    // Value i is value position + i of the stream
+    void randomFloatsRange(const ParticleRandom& random, float* values, size_t begin, size_t end,
+                           float minValue, float range) {
+        for (size_t i = begin; i < end; i++) {
+            values[i] = minValue + range * unitFloat(squirrelNoise(random.position + (uint32_t)i, random.seed));
+        }
+    }
+
+    // The larger of two uniform numbers is distributed like the square root
+    // of one, which is what spreads points evenly over a disk. The first of
+    // radius i is value position + i of the stream, the second position +
+    // count + i.
+    void randomRadiiRange(const ParticleRandom& random, float* radii, size_t begin, size_t end, size_t count,
+                          float radius) {
+        for (size_t i = begin; i < end; i++) {
+            float a = unitFloat(squirrelNoise(random.position + (uint32_t)i, random.seed));
+            float b = unitFloat(squirrelNoise(random.position + (uint32_t)(count + i), random.seed));
+            radii[i] = radius * (a > b ? a : b);
+        }
+    }
+
+    void polarRange(const float* angle, const float* length, float* x, float* y, size_t begin, size_t end,
+                    float originX, float originY) {
+        for (size_t i = begin; i < end; i++) {
+            x[i] = originX + length[i] * fastSin(angle[i] + HALF_PI);
+            y[i] = originY + length[i] * fastSin(angle[i]);
+        }
+    }
+
+#if defined(BENGINE_PARTICLE_SSE)
+    // Returns how many particles were integrated, the rest is left to the scalar loop
+    size_t integrateSIMD(float* x, float* y, const float* vx, const float* vy, float* life,
+                         size_t count, float deltaTime, float decayRate, unsigned int* deadIndices, size_t& numDead) {
+        const __m128 dt = _mm_set1_ps(deltaTime);
+        const __m128 decay = _mm_set1_ps(decayRate * deltaTime);
+        const __m128 zero = _mm_setzero_ps();
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 l = _mm_loadu_ps(life + i);
+            // All bits set in the lanes of live particles, so and-ing zeroes the rest
+            __m128 alive = _mm_cmpgt_ps(l, zero);
+            __m128 dx = _mm_and_ps(alive, _mm_mul_ps(_mm_loadu_ps(vx + i), dt));
+            __m128 dy = _mm_and_ps(alive, _mm_mul_ps(_mm_loadu_ps(vy + i), dt));
+            _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), dx));
+            _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), dy));
+            l = _mm_sub_ps(l, _mm_and_ps(alive, decay));
+            _mm_storeu_ps(life + i, l);
+
+            int died = _mm_movemask_ps(_mm_andnot_ps(_mm_cmpgt_ps(l, zero), alive));
+            if (died) {
+                for (int k = 0; k < 4; k++) {
+                    if (died & (1 << k)) deadIndices[numDead++] = (unsigned int)(i + k);
+                }
+            }
+        }
+        return i;
+    }
+#elif defined(BENGINE_PARTICLE_AVX)
+    size_t integrateSIMD(float* x, float* y, const float* vx, const float* vy, float* life,
+                         size_t count, float deltaTime, float decayRate, unsigned int* deadIndices, size_t& numDead) {
+        const __m256 dt = _mm256_set1_ps(deltaTime);
+        const __m256 decay = _mm256_set1_ps(decayRate * deltaTime);
+        const __m256 zero = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 l = _mm256_loadu_ps(life + i);
+            __m256 alive = _mm256_cmp_ps(l, zero, _CMP_GT_OQ);
+            __m256 dx = _mm256_and_ps(alive, _mm256_mul_ps(_mm256_loadu_ps(vx + i), dt));
+            __m256 dy = _mm256_and_ps(alive, _mm256_mul_ps(_mm256_loadu_ps(vy + i), dt));
+            _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), dx));
+            _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), dy));
+            l = _mm256_sub_ps(l, _mm256_and_ps(alive, decay));
+            _mm256_storeu_ps(life + i, l);
+
+            int died = _mm256_movemask_ps(_mm256_andnot_ps(_mm256_cmp_ps(l, zero, _CMP_GT_OQ), alive));
+            if (died) {
+                for (int k = 0; k < 8; k++) {
+                    if (died & (1 << k)) deadIndices[numDead++] = (unsigned int)(i + k);
+                }
+            }
+        }
+        return i;
+    }
+#elif defined(BENGINE_PARTICLE_NEON)
+    size_t integrateSIMD(float* x, float* y, const float* vx, const float* vy, float* life,
+                         size_t count, float deltaTime, float decayRate, unsigned int* deadIndices, size_t& numDead) {
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const float32x4_t decay = vdupq_n_f32(decayRate * deltaTime);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t l = vld1q_f32(life + i);
+            uint32x4_t alive = vcgtq_f32(l, zero);
+            // Dead lanes keep their old values
+            vst1q_f32(x + i, vbslq_f32(alive, vmlaq_n_f32(vld1q_f32(x + i), vld1q_f32(vx + i), deltaTime), vld1q_f32(x + i)));
+            vst1q_f32(y + i, vbslq_f32(alive, vmlaq_n_f32(vld1q_f32(y + i), vld1q_f32(vy + i), deltaTime), vld1q_f32(y + i)));
+            l = vbslq_f32(alive, vsubq_f32(l, decay), l);
+            vst1q_f32(life + i, l);
+
+            // Lanes can't be picked by a variable, so the mask goes through memory
+            uint32_t died[4];
+            vst1q_u32(died, vbicq_u32(alive, vcgtq_f32(l, zero)));
+            for (int k = 0; k < 4; k++) {
+                if (died[k]) deadIndices[numDead++] = (unsigned int)(i + k);
+            }
+        }
+        return i;
+    }
+#else
+    size_t integrateSIMD(float*, float*, const float*, const float*, float*, size_t, float, float, unsigned int*, size_t&) {
+        return 0;
+    }
+#endif
+
+#if defined(BENGINE_PARTICLE_SSE) || defined(BENGINE_PARTICLE_AVX)
+    // The module passes are too light for 8 lanes to pay off, so AVX builds
+    // use these too
+
+    inline __m128 abs4(__m128 value) {
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+    }
+
+    // fastSin of 4 values
+    inline __m128 fastSin4(__m128 radians) {
+        __m128 t = _mm_mul_ps(radians, _mm_set1_ps(INV_TWO_PI));
+        // cvtps rounds to nearest
+        t = _mm_sub_ps(t, _mm_cvtepi32_ps(_mm_cvtps_epi32(t)));
+        __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(8.0f), t), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(16.0f), t), abs4(t)));
+        return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.225f), _mm_sub_ps(_mm_mul_ps(y, abs4(y)), y)), y);
+    }
+
+    // Like the integration, these return how many particles they did
+    size_t accelerateSIMD(float* vx, float* vy, size_t count, float dvx, float dvy) {
+        const __m128 dx = _mm_set1_ps(dvx);
+        const __m128 dy = _mm_set1_ps(dvy);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(vx + i, _mm_add_ps(_mm_loadu_ps(vx + i), dx));
+            _mm_storeu_ps(vy + i, _mm_add_ps(_mm_loadu_ps(vy + i), dy));
+        }
+        return i;
+    }
+
+    size_t scaleVelocitiesSIMD(float* vx, float* vy, size_t count, float scale) {
+        const __m128 s = _mm_set1_ps(scale);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(vx + i, _mm_mul_ps(_mm_loadu_ps(vx + i), s));
+            _mm_storeu_ps(vy + i, _mm_mul_ps(_mm_loadu_ps(vy + i), s));
+        }
+        return i;
+    }
+
+    size_t blendColorsSIMD(const float* life, ColorRGBA8* color, size_t count,
+                           const ColorRGBA8& startColor, const ColorRGBA8& endColor) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 endR = _mm_set1_ps(endColor.r), rangeR = _mm_set1_ps((float)startColor.r - endColor.r);
+        const __m128 endG = _mm_set1_ps(endColor.g), rangeG = _mm_set1_ps((float)startColor.g - endColor.g);
+        const __m128 endB = _mm_set1_ps(endColor.b), rangeB = _mm_set1_ps((float)startColor.b - endColor.b);
+        const __m128 endA = _mm_set1_ps(endColor.a), rangeA = _mm_set1_ps((float)startColor.a - endColor.a);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 t = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(life + i), zero), one);
+            __m128i r = _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(endR, _mm_mul_ps(rangeR, t)), half));
+            __m128i g = _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(endG, _mm_mul_ps(rangeG, t)), half));
+            __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(endB, _mm_mul_ps(rangeB, t)), half));
+            __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_add_ps(endA, _mm_mul_ps(rangeA, t)), half));
+            // ColorRGBA8 is r, g, b, a in memory, so r goes in the low byte
+            __m128i rgba = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                                        _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+            _mm_storeu_si128((__m128i*)(color + i), rgba);
+        }
+        return i;
+    }
+
+    size_t blendWidthsSIMD(const float* life, float* width, size_t count, float startWidth, float endWidth) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 end = _mm_set1_ps(endWidth);
+        const __m128 range = _mm_set1_ps(startWidth - endWidth);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 t = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(life + i), zero), one);
+            _mm_storeu_ps(width + i, _mm_add_ps(end, _mm_mul_ps(range, t)));
+        }
+        return i;
+    }
+
+    size_t swirlSIMD(const float* x, const float* y, float* vx, float* vy, size_t count,
+                     float frequency, float phaseX, float phaseY, float dv) {
+        const __m128 f = _mm_set1_ps(frequency);
+        const __m128 px = _mm_set1_ps(phaseX);
+        const __m128 py = _mm_set1_ps(phaseY);
+        const __m128 d = _mm_set1_ps(dv);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 sinY = fastSin4(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(y + i), f), px));
+            __m128 sinX = fastSin4(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(x + i), f), py));
+            _mm_storeu_ps(vx + i, _mm_add_ps(_mm_loadu_ps(vx + i), _mm_mul_ps(d, sinY)));
+            _mm_storeu_ps(vy + i, _mm_add_ps(_mm_loadu_ps(vy + i), _mm_mul_ps(d, sinX)));
+        }
+        return i;
+    }
+
+    // SSE2 has no 32 bit multiply that keeps the low halves, so the even and
+    // odd lanes are multiplied apart and put back together
+    inline __m128i multiply4(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+        return _mm_mullo_epi32(a, b);
+#else
+        __m128i even = _mm_mul_epu32(a, b);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+    }
+
+    inline __m128i squirrelNoise4(__m128i position, __m128i seed) {
+        __m128i bits = multiply4(position, _mm_set1_epi32((int)NOISE1));
+        bits = _mm_add_epi32(bits, seed);
+        bits = _mm_xor_si128(bits, _mm_srli_epi32(bits, 8));
+        bits = _mm_add_epi32(bits, _mm_set1_epi32((int)NOISE2));
+        bits = _mm_xor_si128(bits, _mm_slli_epi32(bits, 8));
+        bits = multiply4(bits, _mm_set1_epi32((int)NOISE3));
+        return _mm_xor_si128(bits, _mm_srli_epi32(bits, 8));
+    }
+
+    inline __m128 unitFloat4(__m128i bits) {
+        __m128i floatBits = _mm_or_si128(_mm_srli_epi32(bits, 9), _mm_set1_epi32((int)ONE_BITS));
+        return _mm_sub_ps(_mm_castsi128_ps(floatBits), _mm_set1_ps(1.0f));
+    }
+
+    // The positions of the values of lanes 0 to 3, from first on
+    inline __m128i lanePositions4(uint32_t first) {
+        return _mm_add_epi32(_mm_set1_epi32((int)first), _mm_setr_epi32(0, 1, 2, 3));
+    }
+
+    size_t randomFloatsSIMD(const ParticleRandom& random, float* values, size_t count, float minValue, float range) {
+        const __m128 low = _mm_set1_ps(minValue);
+        const __m128 r = _mm_set1_ps(range);
+        const __m128i seed = _mm_set1_epi32((int)random.seed);
+        const __m128i four = _mm_set1_epi32(4);
+        __m128i position = lanePositions4(random.position);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(values + i, _mm_add_ps(low, _mm_mul_ps(r, unitFloat4(squirrelNoise4(position, seed)))));
+            position = _mm_add_epi32(position, four);
+        }
+        return i;
+    }
+
+    size_t randomRadiiSIMD(const ParticleRandom& random, float* radii, size_t count, float radius) {
+        const __m128 r = _mm_set1_ps(radius);
+        const __m128i seed = _mm_set1_epi32((int)random.seed);
+        const __m128i four = _mm_set1_epi32(4);
+        __m128i positionA = lanePositions4(random.position);
+        __m128i positionB = lanePositions4(random.position + (uint32_t)count);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 a = unitFloat4(squirrelNoise4(positionA, seed));
+            __m128 b = unitFloat4(squirrelNoise4(positionB, seed));
+            _mm_storeu_ps(radii + i, _mm_mul_ps(r, _mm_max_ps(a, b)));
+            positionA = _mm_add_epi32(positionA, four);
+            positionB = _mm_add_epi32(positionB, four);
+        }
+        return i;
+    }
+
+    size_t polarSIMD(const float* angle, const float* length, float* x, float* y, size_t count,
+                     float originX, float originY) {
+        const __m128 ox = _mm_set1_ps(originX);
+        const __m128 oy = _mm_set1_ps(originY);
+        const __m128 quarter = _mm_set1_ps(HALF_PI);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 a = _mm_loadu_ps(angle + i);
+            __m128 l = _mm_loadu_ps(length + i);
+            _mm_storeu_ps(x + i, _mm_add_ps(ox, _mm_mul_ps(l, fastSin4(_mm_add_ps(a, quarter)))));
+            _mm_storeu_ps(y + i, _mm_add_ps(oy, _mm_mul_ps(l, fastSin4(a))));
+        }
+        return i;
+    }
+#elif defined(BENGINE_PARTICLE_NEON)
+    // fastSin of 4 values
+    inline float32x4_t fastSin4(float32x4_t radians) {
+        // Adding and taking away 1.5 * 2^23 rounds to the nearest integer
+        const float32x4_t roundMagic = vdupq_n_f32(12582912.0f);
+        float32x4_t t = vmulq_n_f32(radians, INV_TWO_PI);
+        t = vsubq_f32(t, vsubq_f32(vaddq_f32(t, roundMagic), roundMagic));
+        float32x4_t y = vsubq_f32(vmulq_n_f32(t, 8.0f), vmulq_f32(vmulq_n_f32(t, 16.0f), vabsq_f32(t)));
+        return vaddq_f32(vmulq_n_f32(vsubq_f32(vmulq_f32(y, vabsq_f32(y)), y), 0.225f), y);
+    }
+
+    size_t accelerateSIMD(float* vx, float* vy, size_t count, float dvx, float dvy) {
+        const float32x4_t dx = vdupq_n_f32(dvx);
+        const float32x4_t dy = vdupq_n_f32(dvy);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            vst1q_f32(vx + i, vaddq_f32(vld1q_f32(vx + i), dx));
+            vst1q_f32(vy + i, vaddq_f32(vld1q_f32(vy + i), dy));
+        }
+        return i;
+    }
+
+    size_t scaleVelocitiesSIMD(float* vx, float* vy, size_t count, float scale) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            vst1q_f32(vx + i, vmulq_n_f32(vld1q_f32(vx + i), scale));
+            vst1q_f32(vy + i, vmulq_n_f32(vld1q_f32(vy + i), scale));
+        }
+        return i;
+    }
+
+    size_t blendColorsSIMD(const float* life, ColorRGBA8* color, size_t count,
+                           const ColorRGBA8& startColor, const ColorRGBA8& endColor) {
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        const float32x4_t half = vdupq_n_f32(0.5f);
+        const float32x4_t endR = vdupq_n_f32(endColor.r), endG = vdupq_n_f32(endColor.g);
+        const float32x4_t endB = vdupq_n_f32(endColor.b), endA = vdupq_n_f32(endColor.a);
+        const float rangeR = (float)startColor.r - endColor.r, rangeG = (float)startColor.g - endColor.g;
+        const float rangeB = (float)startColor.b - endColor.b, rangeA = (float)startColor.a - endColor.a;
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t t = vminq_f32(vmaxq_f32(vld1q_f32(life + i), zero), one);
+            uint32x4_t r = vcvtq_u32_f32(vaddq_f32(vaddq_f32(endR, vmulq_n_f32(t, rangeR)), half));
+            uint32x4_t g = vcvtq_u32_f32(vaddq_f32(vaddq_f32(endG, vmulq_n_f32(t, rangeG)), half));
+            uint32x4_t b = vcvtq_u32_f32(vaddq_f32(vaddq_f32(endB, vmulq_n_f32(t, rangeB)), half));
+            uint32x4_t a = vcvtq_u32_f32(vaddq_f32(vaddq_f32(endA, vmulq_n_f32(t, rangeA)), half));
+            uint32x4_t rgba = vorrq_u32(vorrq_u32(r, vshlq_n_u32(g, 8)), vorrq_u32(vshlq_n_u32(b, 16), vshlq_n_u32(a, 24)));
+            vst1q_u32((uint32_t*)(color + i), rgba);
+        }
+        return i;
+    }
+
+    size_t blendWidthsSIMD(const float* life, float* width, size_t count, float startWidth, float endWidth) {
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        const float32x4_t end = vdupq_n_f32(endWidth);
+        const float range = startWidth - endWidth;
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t t = vminq_f32(vmaxq_f32(vld1q_f32(life + i), zero), one);
+            vst1q_f32(width + i, vaddq_f32(end, vmulq_n_f32(t, range)));
+        }
+        return i;
+    }
+
+    size_t swirlSIMD(const float* x, const float* y, float* vx, float* vy, size_t count,
+                     float frequency, float phaseX, float phaseY, float dv) {
+        const float32x4_t px = vdupq_n_f32(phaseX);
+        const float32x4_t py = vdupq_n_f32(phaseY);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t sinY = fastSin4(vaddq_f32(vmulq_n_f32(vld1q_f32(y + i), frequency), px));
+            float32x4_t sinX = fastSin4(vaddq_f32(vmulq_n_f32(vld1q_f32(x + i), frequency), py));
+            vst1q_f32(vx + i, vaddq_f32(vld1q_f32(vx + i), vmulq_n_f32(sinY, dv)));
+            vst1q_f32(vy + i, vaddq_f32(vld1q_f32(vy + i), vmulq_n_f32(sinX, dv)));
+        }
+        return i;
+    }
+
+    inline uint32x4_t squirrelNoise4(uint32x4_t position, uint32x4_t seed) {
+        uint32x4_t bits = vmulq_n_u32(position, NOISE1);
+        bits = vaddq_u32(bits, seed);
+        bits = veorq_u32(bits, vshrq_n_u32(bits, 8));
+        bits = vaddq_u32(bits, vdupq_n_u32(NOISE2));
+        bits = veorq_u32(bits, vshlq_n_u32(bits, 8));
+        bits = vmulq_n_u32(bits, NOISE3);
+        return veorq_u32(bits, vshrq_n_u32(bits, 8));
+    }
+
+    inline float32x4_t unitFloat4(uint32x4_t bits) {
+        uint32x4_t floatBits = vorrq_u32(vshrq_n_u32(bits, 9), vdupq_n_u32(ONE_BITS));
+        return vsubq_f32(vreinterpretq_f32_u32(floatBits), vdupq_n_f32(1.0f));
+    }
+
+    // The positions of the values of lanes 0 to 3, from first on
+    inline uint32x4_t lanePositions4(uint32_t first) {
+        const uint32_t lanes[4] = { 0, 1, 2, 3 };
+        return vaddq_u32(vdupq_n_u32(first), vld1q_u32(lanes));
+    }
+
+    size_t randomFloatsSIMD(const ParticleRandom& random, float* values, size_t count, float minValue, float range) {
+        const float32x4_t low = vdupq_n_f32(minValue);
+        const uint32x4_t seed = vdupq_n_u32(random.seed);
+        const uint32x4_t four = vdupq_n_u32(4);
+        uint32x4_t position = lanePositions4(random.position);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            vst1q_f32(values + i, vaddq_f32(low, vmulq_n_f32(unitFloat4(squirrelNoise4(position, seed)), range)));
+            position = vaddq_u32(position, four);
+        }
+        return i;
+    }
+
+    size_t randomRadiiSIMD(const ParticleRandom& random, float* radii, size_t count, float radius) {
+        const uint32x4_t seed = vdupq_n_u32(random.seed);
+        const uint32x4_t four = vdupq_n_u32(4);
+        uint32x4_t positionA = lanePositions4(random.position);
+        uint32x4_t positionB = lanePositions4(random.position + (uint32_t)count);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t a = unitFloat4(squirrelNoise4(positionA, seed));
+            float32x4_t b = unitFloat4(squirrelNoise4(positionB, seed));
+            vst1q_f32(radii + i, vmulq_n_f32(vmaxq_f32(a, b), radius));
+            positionA = vaddq_u32(positionA, four);
+            positionB = vaddq_u32(positionB, four);
+        }
+        return i;
+    }
+
+    size_t polarSIMD(const float* angle, const float* length, float* x, float* y, size_t count,
+                     float originX, float originY) {
+        const float32x4_t ox = vdupq_n_f32(originX);
+        const float32x4_t oy = vdupq_n_f32(originY);
+        const float32x4_t quarter = vdupq_n_f32(HALF_PI);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t a = vld1q_f32(angle + i);
+            float32x4_t l = vld1q_f32(length + i);
+            vst1q_f32(x + i, vaddq_f32(ox, vmulq_f32(l, fastSin4(vaddq_f32(a, quarter)))));
+            vst1q_f32(y + i, vaddq_f32(oy, vmulq_f32(l, fastSin4(a))));
+        }
+        return i;
+    }
+#else
+    size_t accelerateSIMD(float*, float*, size_t, float, float) {
+        return 0;
+    }
+
+    size_t scaleVelocitiesSIMD(float*, float*, size_t, float) {
+        return 0;
+    }
+
+    size_t blendColorsSIMD(const float*, ColorRGBA8*, size_t, const ColorRGBA8&, const ColorRGBA8&) {
+        return 0;
+    }
+
+    size_t blendWidthsSIMD(const float*, float*, size_t, float, float) {
+        return 0;
+    }
+
+    size_t swirlSIMD(const float*, const float*, float*, float*, size_t, float, float, float, float) {
+        return 0;
+    }
+
+    size_t randomFloatsSIMD(const ParticleRandom&, float*, size_t, float, float) {
+        return 0;
+    }
+
+    size_t randomRadiiSIMD(const ParticleRandom&, float*, size_t, float) {
+        return 0;
+    }
+
+    size_t polarSIMD(const float*, const float*, float*, float*, size_t, float, float) {
+        return 0;
+    }
+#endif
+
+}
+
+    size_t integrateParticles(float* x, float* y, const float* vx, const float* vy, float* life,
+                              size_t count, float deltaTime, float decayRate, unsigned int* deadIndices) {
+        size_t numDead = 0;
+        size_t done = integrateSIMD(x, y, vx, vy, life, count, deltaTime, decayRate, deadIndices, numDead);
+        numDead += integrateRange(x, y, vx, vy, life, done, count, deltaTime, decayRate, deadIndices + numDead);
+        return numDead;
+    }
+
+    size_t integrateParticlesScalar(float* x, float* y, const float* vx, const float* vy, float* life,
+                                    size_t count, float deltaTime, float decayRate, unsigned int* deadIndices) {
+        return integrateRange(x, y, vx, vy, life, 0, count, deltaTime, decayRate, deadIndices);
+    }
+
+    void accelerateParticles(float* vx, float* vy, size_t count, float dvx, float dvy) {
+        size_t done = accelerateSIMD(vx, vy, count, dvx, dvy);
+        accelerateRange(vx, vy, done, count, dvx, dvy);
+    }
+
+    void scaleParticleVelocities(float* vx, float* vy, size_t count, float scale) {
+        size_t done = scaleVelocitiesSIMD(vx, vy, count, scale);
+        scaleVelocitiesRange(vx, vy, done, count, scale);
+    }
+
+    void blendParticleColors(const float* life, ColorRGBA8* color, size_t count,
+                             const ColorRGBA8& startColor, const ColorRGBA8& endColor) {
+        size_t done = blendColorsSIMD(life, color, count, startColor, endColor);
+        blendColorsRange(life, color, done, count, startColor, endColor);
+    }
+
+    void blendParticleWidths(const float* life, float* width, size_t count, float startWidth, float endWidth) {
+        size_t done = blendWidthsSIMD(life, width, count, startWidth, endWidth);
+        blendWidthsRange(life, width, done, count, startWidth, endWidth);
+    }
+
+    void swirlParticles(const float* x, const float* y, float* vx, float* vy, size_t count,
+                        float frequency, float phaseX, float phaseY, float dv) {
+        size_t done = swirlSIMD(x, y, vx, vy, count, frequency, phaseX, phaseY, dv);
+        swirlRange(x, y, vx, vy, done, count, frequency, phaseX, phaseY, dv);
+    }
+
+    void seedParticleRandom(ParticleRandom& random, uint32_t seed) {
+        // The finalizer of MurmurHash3, so nearby seeds end up far apart
+        uint32_t h = seed;
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35;
+        h ^= h >> 16;
+        random.seed = h;
+        random.position = 0;
+    }
+
+    void skipParticleRandom(ParticleRandom& random, uint32_t count) {
+        random.position += count;
+    }
+
+    void randomParticleFloats(ParticleRandom& random, float* values, size_t count, float minValue, float maxValue) {
+        const float range = maxValue - minValue;
+        size_t done = randomFloatsSIMD(random, values, count, minValue, range);
+        randomFloatsRange(random, values, done, count, minValue, range);
+        skipParticleRandom(random, (uint32_t)count);
+    }
+
+    void randomParticleRadii(ParticleRandom& random, float* radii, size_t count, float radius) {
+        size_t done = randomRadiiSIMD(random, radii, count, radius);
+        randomRadiiRange(random, radii, done, count, count, radius);
+        skipParticleRandom(random, (uint32_t)(2 * count));
+    }
+
+    void polarToParticles(const float* angle, const float* length, float* x, float* y, size_t count,
+                          float originX, float originY) {
+        size_t done = polarSIMD(angle, length, x, y, count, originX, originY);
+        polarRange(angle, length, x, y, done, count, originX, originY);
+    }
+
+}
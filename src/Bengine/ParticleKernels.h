@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Vertex.h"
+
+namespace Bengine {
+
+    // Moves the live particles of [0, count) by their velocity and takes
+    // decayRate * deltaTime off their life. Dead particles, with life <= 0,
+    // are left alone. Writes the indices of the particles that died to
+    // deadIndices, in order, and returns how many there are.
+    // Uses AVX, SSE2 or NEON when the compiler targets them.
+    size_t integrateParticles(float* x, float* y, const float* vx, const float* vy, float* life,
+                              size_t count, float deltaTime, float decayRate, unsigned int* deadIndices);
+
+    // Plain C++ version of integrateParticles, used for the leftover particles
+    // and on targets without SIMD
+    size_t integrateParticlesScalar(float* x, float* y, const float* vx, const float* vy, float* life,
+                                    size_t count, float deltaTime, float decayRate, unsigned int* deadIndices);
+
+    // The passes of the ParticleModules. Each one works on particles [0, count)
+    // and uses SSE2 or NEON when the compiler targets them.
+
+    // Adds (dvx, dvy) to every velocity
+    void accelerateParticles(float* vx, float* vy, size_t count, float dvx, float dvy);
+
+    // Multiplies every velocity by scale
+    void scaleParticleVelocities(float* vx, float* vy, size_t count, float scale);
+
+    // Sets each color to endColor + (startColor - endColor) * life, with life
+    // clamped to [0, 1]
+    void blendParticleColors(const float* life, ColorRGBA8* color, size_t count,
+                             const ColorRGBA8& startColor, const ColorRGBA8& endColor);
+
+    // Sets each width to endWidth + (startWidth - endWidth) * life, with life
+    // clamped to [0, 1]
+    void blendParticleWidths(const float* life, float* width, size_t count, float startWidth, float endWidth);
+
+    // Adds dv * sin(y * frequency + phaseX) to vx and dv * sin(x * frequency + phaseY)
+    // to vy, with a sine good to about 0.001
+    void swirlParticles(const float* x, const float* y, float* vx, float* vy, size_t count,
+                        float frequency, float phaseX, float phaseY, float dv);
+
+    // A counter based generator for spawning particles. Value n of the stream
+    // is a hash of n and the seed, so the SIMD lanes make theirs side by side,
+    // and skipping values only moves the position.
+    struct ParticleRandom {
+        uint32_t seed;
+        uint32_t position; ///< Of the next value
+    };
+
+    // Starts the stream of seed, so different seeds give unrelated numbers
+    void seedParticleRandom(ParticleRandom& random, uint32_t seed);
+
+    // Moves past count values as if they were made
+    void skipParticleRandom(ParticleRandom& random, uint32_t count);
+
+    // The passes of the ParticleEmitter2D. Like the modules, they use SSE2 or
+    // NEON when the compiler targets them.
+
+    // Fills values with random numbers in [minValue, maxValue), using count
+    // values of the stream
+    void randomParticleFloats(ParticleRandom& random, float* values, size_t count, float minValue, float maxValue);
+
+    // Fills radii with random distances in [0, radius), more of them further
+    // out, so points at those distances are spread evenly over a disk. Uses
+    // 2 * count values of the stream.
+    void randomParticleRadii(ParticleRandom& random, float* radii, size_t count, float radius);
+
+    // Sets x and y to origin plus length in the direction of angle, with a
+    // sine and cosine good to about 0.001
+    void polarToParticles(const float* angle, const float* length, float* x, float* y, size_t count,
+                          float originX, float originY);
+
+}
@@ -0,0 +1,40 @@
+#include "ParticleModules.h"
+#include "ParticleCollisionGrid.h"
+#include "ParticleKernels.h"
+
+#include <algorithm>
+
+namespace Bengine {
+
+    void GravityModule::apply(ParticlePool2D& particles, size_t first, size_t last, float deltaTime) {
+        accelerateParticles(particles.vx.data() + first, particles.vy.data() + first, last - first,
+                            acceleration.x * deltaTime, acceleration.y * deltaTime);
+    }
+
+    void DragModule::apply(ParticlePool2D& particles, size_t first, size_t last, float deltaTime) {
+        // Never turns particles around, however long the frame
+        float scale = std::max(1.0f - drag * deltaTime, 0.0f);
+        scaleParticleVelocities(particles.vx.data() + first, particles.vy.data() + first, last - first, scale);
+    }
+
+    void ColorOverLifeModule::apply(ParticlePool2D& particles, size_t first, size_t last, float) {
+        blendParticleColors(particles.life.data() + first, particles.color.data() + first, last - first, startColor, endColor);
+    }
+
+    void SizeOverLifeModule::apply(ParticlePool2D& particles, size_t first, size_t last, float) {
+        blendParticleWidths(particles.life.data() + first, particles.width.data() + first, last - first, startWidth, endWidth);
+    }
+
+    void TurbulenceModule::apply(ParticlePool2D& particles, size_t first, size_t last, float deltaTime) {
+        swirlParticles(particles.x.data() + first, particles.y.data() + first,
+                       particles.vx.data() + first, particles.vy.data() + first,
+                       last - first, frequency, getPhaseX(), getPhaseY(), strength * deltaTime);
+    }
+
+    void CollisionModule::apply(ParticlePool2D& particles, size_t first, size_t last, float deltaTime) {
+        grid->collide(particles.x.data() + first, particles.y.data() + first,
+                      particles.vx.data() + first, particles.vy.data() + first,
+                      last - first, deltaTime, restitution, friction);
+    }
+
+}
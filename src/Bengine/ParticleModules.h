@@ -0,0 +1,151 @@
+#pragma once
+
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <glm/glm.hpp>
+
+#include "ParticlePool2D.h"
+#include "Vertex.h"
+
+namespace Bengine {
+
+    class ParticleCollisionGrid;
+
+    // Extra work a ParticleBatch2D does to its live particles every update(),
+    // before they are moved by their velocity and decayed. See
+    // ParticleBatch2D::setModules().
+    class ParticleUpdater {
+    public:
+        virtual ~ParticleUpdater() { }
+        // Called once per update, before any of its ranges
+        virtual void advance(float) { }
+        // Works on the live particles in [first, last). The ranges of one
+        // update can run on different threads at the same time.
+        virtual void update(ParticlePool2D& particles, size_t first, size_t last, float deltaTime) = 0;
+    };
+
+    // Each module is one pass over a range of the arrays of the live particles,
+    // done by a kernel from ParticleKernels.h. State that changes over time is
+    // stepped in advance(), since apply() runs once per range.
+    struct ParticleModule {
+        void advance(float) { }
+    };
+
+    // Accelerates every particle by acceleration, in units per second squared
+    struct GravityModule : ParticleModule {
+        GravityModule(const glm::vec2& acceleration) : acceleration(acceleration) { }
+        void apply(ParticlePool2D& particles, size_t first, size_t last, float deltaTime);
+
+        glm::vec2 acceleration;
+    };
+
+    // Slows particles down by drag times their velocity per second
+    struct DragModule : ParticleModule {
+        DragModule(float drag) : drag(drag) { }
+        void apply(ParticlePool2D& particles, size_t first, size_t last, float deltaTime);
+
+        float drag;
+    };
+
+    // Fades the color from startColor at full life to endColor at death,
+    // replacing the color the particle was added with
+    struct ColorOverLifeModule : ParticleModule {
+        ColorOverLifeModule(const ColorRGBA8& startColor, const ColorRGBA8& endColor) :
+            startColor(startColor), endColor(endColor) { }
+        void apply(ParticlePool2D& particles, size_t first, size_t last, float deltaTime);
+
+        ColorRGBA8 startColor;
+        ColorRGBA8 endColor;
+    };
+
+    // Scales the width from startWidth at full life to endWidth at death,
+    // replacing the width the particle was added with
+    struct SizeOverLifeModule : ParticleModule {
+        SizeOverLifeModule(float startWidth, float endWidth) : startWidth(startWidth), endWidth(endWidth) { }
+        void apply(ParticlePool2D& particles, size_t first, size_t last, float deltaTime);
+
+        float startWidth;
+        float endWidth;
+    };
+
+    // Pushes particles around in a swirling flow field that drifts over time.
+    // strength is the acceleration, frequency how many swirls there are per
+    // world unit and speed how fast the field drifts.
+    struct TurbulenceModule : ParticleModule {
+        TurbulenceModule(float strength, float frequency, float speed = 1.0f) :
+            strength(strength), frequency(frequency), speed(speed) { }
+        void advance(float deltaTime) { time += deltaTime * speed; }
+
+        // The x push only depends on y and the other way around, which makes
+        // the field swirl instead of bunching particles up. The y phase is a
+        // quarter turn ahead and drifts slower, so the two don't line up.
+        float getPhaseX() const { return time; }
+        float getPhaseY() const { return time * 0.7f + 1.57079633f; }
+        void apply(ParticlePool2D& particles, size_t first, size_t last, float deltaTime);
+
+        float strength;
+        float frequency;
+        float speed;
+        float time = 0.0f;
+    };
+
+    // Bounces particles off the static geometry baked into grid, which isn't
+    // owned and has to outlive the module. Put it last, so it sees the
+    // velocities the particles are about to move with. The whole way a
+    // particle moves is checked, so the long updates of batches the camera
+    // holds back don't tunnel through thin walls either.
+    struct CollisionModule : ParticleModule {
+        CollisionModule(const ParticleCollisionGrid* grid, float restitution = 0.5f, float friction = 0.1f) :
+            grid(grid), restitution(restitution), friction(friction) { }
+        void apply(ParticlePool2D& particles, size_t first, size_t last, float deltaTime);
+
+        const ParticleCollisionGrid* grid;
+        float restitution; ///< Speed kept along the normal, 1 for a perfect bounce
+        float friction; ///< Part of the speed along the surface lost on a bounce
+    };
+
+    // Runs the apply() passes of Modules in order. The modules are known at
+    // compile time, so there is only one virtual call per range. A module is
+    // anything with advance(float) and apply(ParticlePool2D&, size_t, size_t, float).
+    template<typename... Modules>
+    class ParticleModules : public ParticleUpdater {
+    public:
+        ParticleModules(const Modules&... modules) : m_modules(modules...) { }
+
+        void advance(float deltaTime) override {
+            advanceAll(deltaTime, std::index_sequence_for<Modules...>());
+        }
+
+        void update(ParticlePool2D& particles, size_t first, size_t last, float deltaTime) override {
+            applyAll(particles, first, last, deltaTime, std::index_sequence_for<Modules...>());
+        }
+
+        // Gives access to module I, to change its settings while the batch runs
+        template<size_t I>
+        typename std::tuple_element<I, std::tuple<Modules...>>::type& getModule() { return std::get<I>(m_modules); }
+
+    private:
+        template<size_t... I>
+        void advanceAll(float deltaTime, std::index_sequence<I...>) {
+            int expand[] = { 0, (std::get<I>(m_modules).advance(deltaTime), 0)... };
+            (void)expand;
+        }
+
+        template<size_t... I>
+        void applyAll(ParticlePool2D& particles, size_t first, size_t last, float deltaTime, std::index_sequence<I...>) {
+            // Expands to one apply() per module, in order
+            int expand[] = { 0, (std::get<I>(m_modules).apply(particles, first, last, deltaTime), 0)... };
+            (void)expand;
+        }
+
+        std::tuple<Modules...> m_modules;
+    };
+
+    // makeParticleModules(GravityModule(...), DragModule(...)) for ParticleBatch2D::setModules()
+    template<typename... Modules>
+    std::unique_ptr<ParticleModules<Modules...>> makeParticleModules(const Modules&... modules) {
+        return std::unique_ptr<ParticleModules<Modules...>>(new ParticleModules<Modules...>(modules...));
+    }
+
+}
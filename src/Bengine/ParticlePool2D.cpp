@@ -0,0 +1,37 @@
+#include "ParticlePool2D.h"
+
+namespace Bengine {
+
+    void ParticlePool2D::setCapacity(size_t capacity) {
+        x.resize(capacity, 0.0f);
+        y.resize(capacity, 0.0f);
+        vx.resize(capacity, 0.0f);
+        vy.resize(capacity, 0.0f);
+        life.resize(capacity, 0.0f);
+        width.resize(capacity, 0.0f);
+        color.resize(capacity);
+        if (m_numAlive > capacity) {
+            m_numAlive = capacity;
+        }
+    }
+
+    void ParticlePool2D::removeDead(const unsigned int* deadIndices, size_t numDead) {
+        // Going from the back, everything after the current dead particle is
+        // already alive, so the last particle can always be moved in
+        for (size_t k = numDead; k > 0; k--) {
+            m_numAlive--;
+            move(m_numAlive, deadIndices[k - 1]);
+        }
+    }
+
+    void ParticlePool2D::move(size_t from, size_t to) {
+        x[to] = x[from];
+        y[to] = y[from];
+        vx[to] = vx[from];
+        vy[to] = vy[from];
+        life[to] = life[from];
+        width[to] = width[from];
+        color[to] = color[from];
+    }
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+
+namespace Bengine {
+
+    class Particle2D {
+    public:
+        glm::vec2 position = glm::vec2(0.0f);
+        glm::vec2 velocity = glm::vec2(0.0f);
+        ColorRGBA8 color;
+        float life = 0.0f;
+        float width = 0.0f;
+    };
+
+    // The particles of a ParticleBatch2D, stored one array per field, so the
+    // kernels in ParticleKernels.h stream through them with SIMD. The live
+    // particles are kept packed in [0, getNumAlive()), so nothing has to look
+    // at the dead ones. A particle dies once its life drops to 0.
+    class ParticlePool2D {
+    public:
+        // Resizes every array to capacity. Particles past a smaller capacity are lost.
+        void setCapacity(size_t capacity);
+        size_t getCapacity() const { return life.size(); }
+
+        size_t getNumAlive() const { return m_numAlive; }
+        bool isFull() const { return m_numAlive == life.size(); }
+
+        // Returns the index of a new particle after the live ones, for the
+        // caller to fill in. The pool must not be full.
+        size_t add() { return m_numAlive++; }
+        // Like add(), for count particles in a row. Returns the index of the first.
+        size_t add(size_t count) {
+            size_t first = m_numAlive;
+            m_numAlive += count;
+            return first;
+        }
+
+        // Moves the last live particle into the place of each dead one.
+        // deadIndices must be in increasing order, like integrateParticles()
+        // writes them. Indices of live particles stay valid until this is called.
+        void removeDead(const unsigned int* deadIndices, size_t numDead);
+
+        // Kills every particle
+        void clear() { m_numAlive = 0; }
+
+        // Copies particle i out of and back into the arrays, for code that
+        // works on one Particle2D at a time
+        Particle2D get(size_t i) const {
+            Particle2D particle;
+            particle.position = glm::vec2(x[i], y[i]);
+            particle.velocity = glm::vec2(vx[i], vy[i]);
+            particle.color = color[i];
+            particle.life = life[i];
+            particle.width = width[i];
+            return particle;
+        }
+        void set(size_t i, const Particle2D& particle) {
+            x[i] = particle.position.x;
+            y[i] = particle.position.y;
+            vx[i] = particle.velocity.x;
+            vy[i] = particle.velocity.y;
+            color[i] = particle.color;
+            life[i] = particle.life;
+            width[i] = particle.width;
+        }
+
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> vx;
+        std::vector<float> vy;
+        std::vector<float> life;
+        std::vector<float> width;
+        std::vector<ColorRGBA8> color;
+
+    private:
+        // Copies every field of particle from over particle to
+        void move(size_t from, size_t to);
+
+        size_t m_numAlive = 0;
+    };
+
+}
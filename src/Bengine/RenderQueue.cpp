@@ -0,0 +1,299 @@
+#include "RenderQueue.h"
+#include "GLSLProgram.h"
+#include "GLStateCache.h"
+#include "Window.h"
+
+#include <chrono>
+
+namespace Bengine {
+
+    void RenderCommandList::reset() {
+        m_commands.clear();
+        m_floats.clear();
+        m_ints.clear();
+        m_numSpriteRecorders = 0;
+        m_numDebugRecorders = 0;
+    }
+
+    void RenderCommandList::clear(GLbitfield mask, const glm::vec4& color /* black */) {
+        addCommand(RenderCommandType::CLEAR, nullptr, mask, 0, m_floats.size());
+        m_floats.insert(m_floats.end(), &color[0], &color[0] + 4);
+    }
+
+    void RenderCommandList::setViewport(int x, int y, int width, int height) {
+        addCommand(RenderCommandType::VIEWPORT, nullptr, 0, 0, m_ints.size());
+        m_ints.push_back(x);
+        m_ints.push_back(y);
+        m_ints.push_back(width);
+        m_ints.push_back(height);
+    }
+
+    void RenderCommandList::setFrameUniforms(FrameUniforms& frameUniforms, const FrameUniformData& data) {
+        addCommand(RenderCommandType::FRAME_UNIFORMS, &frameUniforms, 0, 0, m_floats.size());
+        const GLfloat* values = (const GLfloat*)&data;
+        m_floats.insert(m_floats.end(), values, values + sizeof(FrameUniformData) / sizeof(GLfloat));
+    }
+
+    void RenderCommandList::useProgram(GLSLProgram& program) {
+        addCommand(RenderCommandType::USE_PROGRAM, &program);
+    }
+
+    void RenderCommandList::unuseProgram(GLSLProgram& program) {
+        addCommand(RenderCommandType::UNUSE_PROGRAM, &program);
+    }
+
+    void RenderCommandList::setUniform(const char* name, GLint value) {
+        addCommand(RenderCommandType::UNIFORM, nullptr, (GLenum)UniformType::INT, GLSLProgram::hashUniformName(name), m_ints.size());
+        m_commands.back().name = name;
+        m_ints.push_back(value);
+    }
+
+    void RenderCommandList::setUniform(const char* name, float value) {
+        addUniform(name, UniformType::FLOAT, &value, 1);
+    }
+
+    void RenderCommandList::setUniform(const char* name, const glm::vec2& value) {
+        addUniform(name, UniformType::VEC2, &value[0], 2);
+    }
+
+    void RenderCommandList::setUniform(const char* name, const glm::vec4& value) {
+        addUniform(name, UniformType::VEC4, &value[0], 4);
+    }
+
+    void RenderCommandList::setUniform(const char* name, const glm::mat4& value) {
+        addUniform(name, UniformType::MAT4, &value[0][0], 16);
+    }
+
+    void RenderCommandList::bindTexture(GLuint unit, GLuint texture, GLenum target /* GL_TEXTURE_2D */) {
+        addCommand(RenderCommandType::BIND_TEXTURE, nullptr, target, unit);
+        m_commands.back().texture = texture;
+    }
+
+    SpriteBatch& RenderCommandList::beginSprites(SpriteBatch& batch, GlyphSortType sortType /* GlyphSortType::TEXTURE */) {
+        if (m_numSpriteRecorders == m_spriteRecorders.size()) {
+            m_spriteRecorders.emplace_back(new SpriteBatch());
+        }
+        addCommand(RenderCommandType::SPRITES, &batch, (GLenum)sortType, (GLuint)m_numSpriteRecorders);
+
+        SpriteBatch& recorder = *m_spriteRecorders[m_numSpriteRecorders++];
+        recorder.begin(sortType);
+        return recorder;
+    }
+
+    SpriteBatch& RenderCommandList::beginSprites(SpriteBatch& batch, const glm::vec4& viewRect,
+                                                 GlyphSortType sortType /* GlyphSortType::TEXTURE */) {
+        SpriteBatch& recorder = beginSprites(batch, sortType);
+        recorder.begin(viewRect, sortType);
+        return recorder;
+    }
+
+    void RenderCommandList::endSprites() {
+        // Nothing to do yet, the recorder is handed over when the command runs
+    }
+
+    DebugRenderer& RenderCommandList::beginDebugLines(DebugRenderer& renderer) {
+        if (m_numDebugRecorders == m_debugRecorders.size()) {
+            m_debugRecorders.emplace_back(new DebugRenderer());
+        }
+        addCommand(RenderCommandType::DEBUG_LINES, &renderer, 0, (GLuint)m_numDebugRecorders);
+
+        DebugRenderer& recorder = *m_debugRecorders[m_numDebugRecorders++];
+        recorder.clear();
+        return recorder;
+    }
+
+    void RenderCommandList::endDebugLines(float lineWidth) {
+        RenderCommand& command = m_commands.back();
+        command.first = m_floats.size();
+        m_floats.push_back(lineWidth);
+    }
+
+    void RenderCommandList::execute() {
+        GLSLProgram* program = nullptr;
+
+        for (const RenderCommand& command : m_commands) {
+            switch (command.type) {
+                case RenderCommandType::CLEAR: {
+                    const GLfloat* color = &m_floats[command.first];
+                    glClearColor(color[0], color[1], color[2], color[3]);
+                    glClear(command.value);
+                    break;
+                }
+                case RenderCommandType::VIEWPORT: {
+                    const GLint* viewport = &m_ints[command.first];
+                    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+                    break;
+                }
+                case RenderCommandType::FRAME_UNIFORMS:
+                    ((FrameUniforms*)command.object)->update(*(const FrameUniformData*)&m_floats[command.first]);
+                    break;
+                case RenderCommandType::USE_PROGRAM:
+                    program = (GLSLProgram*)command.object;
+                    program->use();
+                    break;
+                case RenderCommandType::UNUSE_PROGRAM:
+                    ((GLSLProgram*)command.object)->unuse();
+                    program = nullptr;
+                    break;
+                case RenderCommandType::UNIFORM: {
+                    GLint location;
+                    if (program) {
+                        location = program->getUniformLocation(command.index);
+                    } else {
+                        GLint currentProgram = 0;
+                        glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+                        location = glGetUniformLocation(currentProgram, command.name);
+                    }
+                    const GLfloat* values = &m_floats[command.first];
+                    switch ((UniformType)command.value) {
+                        case UniformType::INT:
+                            glUniform1i(location, m_ints[command.first]);
+                            break;
+                        case UniformType::FLOAT:
+                            glUniform1f(location, values[0]);
+                            break;
+                        case UniformType::VEC2:
+                            glUniform2fv(location, 1, values);
+                            break;
+                        case UniformType::VEC4:
+                            glUniform4fv(location, 1, values);
+                            break;
+                        case UniformType::MAT4:
+                            glUniformMatrix4fv(location, 1, GL_FALSE, values);
+                            break;
+                    }
+                    break;
+                }
+                case RenderCommandType::BIND_TEXTURE:
+                    GLStateCache::bindTexture(command.value, command.texture, command.index);
+                    break;
+                case RenderCommandType::SPRITES: {
+                    SpriteBatch& batch = *(SpriteBatch*)command.object;
+                    batch.begin((GlyphSortType)command.value);
+                    batch.drawGlyphs(*m_spriteRecorders[command.index]);
+                    batch.end();
+                    batch.renderBatch();
+                    break;
+                }
+                case RenderCommandType::DEBUG_LINES: {
+                    DebugRenderer& renderer = *(DebugRenderer*)command.object;
+                    renderer.drawLines(*m_debugRecorders[command.index]);
+                    renderer.end();
+                    renderer.render(m_floats[command.first]);
+                    break;
+                }
+            }
+        }
+    }
+
+    void RenderCommandList::addCommand(RenderCommandType type, void* object /* nullptr */, GLenum value /* 0 */,
+                                       GLuint index /* 0 */, size_t first /* 0 */) {
+        RenderCommand command;
+        command.type = type;
+        command.object = object;
+        command.name = nullptr;
+        command.value = value;
+        command.index = index;
+        command.texture = 0;
+        command.first = first;
+        m_commands.push_back(command);
+    }
+
+    void RenderCommandList::addUniform(const char* name, UniformType type, const float* values, size_t count) {
+        addCommand(RenderCommandType::UNIFORM, nullptr, (GLenum)type, GLSLProgram::hashUniformName(name), m_floats.size());
+        m_commands.back().name = name;
+        m_floats.insert(m_floats.end(), values, values + count);
+    }
+
+    RenderQueue::RenderQueue() {
+        // Empty
+    }
+
+    RenderQueue::~RenderQueue() {
+        dispose();
+    }
+
+    void RenderQueue::init(Window* window) {
+        if (m_window) return;
+
+        m_window = window;
+        m_recordIndex = 0;
+        m_lists[0].reset();
+        m_lists[1].reset();
+        m_pending = nullptr;
+        m_rendering = false;
+        m_quit = false;
+
+        // The render thread makes the context current, and it can't be current here too
+        m_window->releaseCurrent();
+        m_thread = std::thread(&RenderQueue::renderLoop, this);
+    }
+
+    void RenderQueue::dispose() {
+        if (!m_window) return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+
+        m_window->makeCurrent();
+        m_window = nullptr;
+    }
+
+    void RenderQueue::submitFrame() {
+        auto waitStart = std::chrono::high_resolution_clock::now();
+        {
+            // The other list is only free once the render thread is done with it
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_pending == nullptr && !m_rendering; });
+            m_pending = &m_lists[m_recordIndex];
+        }
+        m_condition.notify_all();
+        m_submitWaitMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - waitStart).count();
+
+        m_recordIndex = 1 - m_recordIndex;
+        m_lists[m_recordIndex].reset();
+    }
+
+    double RenderQueue::getRenderMs() {
+        // Written by the render thread
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_renderMs;
+    }
+
+    void RenderQueue::renderLoop() {
+        m_window->makeCurrent();
+
+        while (true) {
+            RenderCommandList* list;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_pending != nullptr || m_quit; });
+                // A submitted frame is still drawn before quitting
+                if (m_pending == nullptr) break;
+                list = m_pending;
+                m_pending = nullptr;
+                m_rendering = true;
+            }
+
+            auto renderStart = std::chrono::high_resolution_clock::now();
+            list->execute();
+            m_window->swapBuffer();
+            double renderMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - renderStart).count();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_renderMs = renderMs;
+                m_rendering = false;
+            }
+            m_condition.notify_all();
+        }
+
+        // Give the context back for dispose()
+        m_window->releaseCurrent();
+    }
+
+}
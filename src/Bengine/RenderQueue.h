@@ -0,0 +1,158 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SpriteBatch.h"
+#include "DebugRenderer.h"
+#include "FrameUniforms.h"
+
+namespace Bengine {
+
+    class GLSLProgram;
+    class Window;
+
+    enum class RenderCommandType {
+        CLEAR,
+        VIEWPORT,
+        FRAME_UNIFORMS,
+        USE_PROGRAM,
+        UNUSE_PROGRAM,
+        UNIFORM,
+        BIND_TEXTURE,
+        SPRITES,
+        DEBUG_LINES
+    };
+
+    // The kinds of values setUniform() records
+    enum class UniformType { INT, FLOAT, VEC2, VEC4, MAT4 };
+
+    // One recorded call. Which fields are used depends on type.
+    struct RenderCommand {
+        RenderCommandType type;
+        void* object; ///< The GLSLProgram, SpriteBatch, DebugRenderer or FrameUniforms
+        const char* name; ///< Uniform name
+        GLenum value; ///< Clear mask, UniformType, GlyphSortType or texture target
+        GLuint index; ///< Texture unit, recorder or uniform name hash
+        GLuint texture;
+        size_t first; ///< Of the values in the data of the list
+    };
+
+    // The draw calls of one frame, recorded without touching GL so any thread
+    // can fill it. execute() replays them on the thread that has the context.
+    // Sprites and debug lines are drawn into recorders, which are a SpriteBatch
+    // or DebugRenderer that is never initialized. SpriteFont::draw() works with
+    // the sprite recorder too. Everything the commands point to must stay
+    // alive until the frame has been executed.
+    class RenderCommandList {
+    public:
+        // Removes every command. Recorders and data storage are kept for reuse.
+        void reset();
+
+        void clear(GLbitfield mask, const glm::vec4& color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        void setViewport(int x, int y, int width, int height);
+
+        // Uploads data to frameUniforms when the command runs
+        void setFrameUniforms(FrameUniforms& frameUniforms, const FrameUniformData& data);
+
+        void useProgram(GLSLProgram& program);
+        void unuseProgram(GLSLProgram& program);
+
+        // Sets a uniform of the program in use when the command runs. name is
+        // kept as a pointer, so it must outlive the frame, like a string literal.
+        void setUniform(const char* name, GLint value);
+        void setUniform(const char* name, float value);
+        void setUniform(const char* name, const glm::vec2& value);
+        void setUniform(const char* name, const glm::vec4& value);
+        void setUniform(const char* name, const glm::mat4& value);
+
+        // Binds texture to unit, e.g. 0 for GL_TEXTURE0
+        void bindTexture(GLuint unit, GLuint texture, GLenum target = GL_TEXTURE_2D);
+
+        // Returns the recorder to draw() sprites into. When the command runs,
+        // batch gets them with drawGlyphs() between its own begin() and end(),
+        // and renders them.
+        SpriteBatch& beginSprites(SpriteBatch& batch, GlyphSortType sortType = GlyphSortType::TEXTURE);
+        // Like beginSprites, but the recorder culls against viewRect right away
+        SpriteBatch& beginSprites(SpriteBatch& batch, const glm::vec4& viewRect, GlyphSortType sortType = GlyphSortType::TEXTURE);
+        void endSprites();
+
+        // Returns the recorder to draw debug lines into. When the command runs,
+        // renderer gets them with drawLines(), then ends and renders them with
+        // the FrameUniforms set at that point.
+        DebugRenderer& beginDebugLines(DebugRenderer& renderer);
+        void endDebugLines(float lineWidth);
+
+        // Replays the commands. Needs a current GL context.
+        void execute();
+
+        size_t getNumCommands() const { return m_commands.size(); }
+
+    private:
+        void addCommand(RenderCommandType type, void* object = nullptr, GLenum value = 0, GLuint index = 0, size_t first = 0);
+        void addUniform(const char* name, UniformType type, const float* values, size_t count);
+
+        std::vector<RenderCommand> m_commands;
+        std::vector<GLfloat> m_floats; ///< Uniform values, clear colors, frame uniforms and line widths
+        std::vector<GLint> m_ints; ///< Viewports and int uniforms
+
+        // Created on first use and reused every frame, so their storage stays warm
+        std::vector<std::unique_ptr<SpriteBatch>> m_spriteRecorders;
+        std::vector<std::unique_ptr<DebugRenderer>> m_debugRecorders;
+        size_t m_numSpriteRecorders = 0;
+        size_t m_numDebugRecorders = 0;
+    };
+
+    // Runs a render thread that owns the window's GL context. The simulation
+    // thread records frame N into getCommands() while the render thread executes
+    // frame N - 1 and swaps buffers. submitFrame() hands a frame over and waits
+    // for the one before it, so rendering is never more than one frame behind.
+    class RenderQueue {
+    public:
+        RenderQueue();
+        ~RenderQueue();
+
+        // Takes the GL context from the calling thread and starts the render thread
+        void init(Window* window);
+        // Finishes the frame in flight, stops the render thread and makes the
+        // context current on the calling thread again
+        void dispose();
+
+        bool isRunning() const { return m_window != nullptr; }
+
+        // The list for the frame being recorded
+        RenderCommandList& getCommands() { return m_lists[m_recordIndex]; }
+
+        // Hands the recorded frame to the render thread, waiting first until it
+        // is done with the previous one
+        void submitFrame();
+
+        // Milliseconds the last submitFrame() waited for the render thread
+        double getSubmitWaitMs() const { return m_submitWaitMs; }
+        // Milliseconds the render thread took for the last frame, swap included
+        double getRenderMs();
+
+    private:
+        void renderLoop();
+
+        Window* m_window = nullptr;
+        RenderCommandList m_lists[2];
+        int m_recordIndex = 0;
+
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        RenderCommandList* m_pending = nullptr; ///< Submitted, but not picked up yet
+        bool m_rendering = false;
+        bool m_quit = false;
+
+        double m_submitWaitMs = 0.0;
+        double m_renderMs = 0.0;
+    };
+
+}
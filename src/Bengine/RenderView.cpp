@@ -0,0 +1,30 @@
+#include "RenderView.h"
+#include "Camera2D.h"
+#include "FrameUniforms.h"
+#include "SpriteBatch.h"
+
+namespace Bengine {
+
+    void renderViews(SpriteBatch& batch, FrameUniforms& frameUniforms, const RenderView* views, size_t numViews, float time) {
+        GLint windowViewport[4];
+        glGetIntegerv(GL_VIEWPORT, windowViewport);
+        // Copied, since update() overwrites the data getData() refers to
+        const FrameUniformData frameData = frameUniforms.getData();
+
+        // The viewport doesn't limit clears or wide lines, the scissor rect does
+        glEnable(GL_SCISSOR_TEST);
+        for (size_t i = 0; i < numViews; i++) {
+            const RenderView& view = views[i];
+            glViewport(view.viewport.x, view.viewport.y, view.viewport.z, view.viewport.w);
+            glScissor(view.viewport.x, view.viewport.y, view.viewport.z, view.viewport.w);
+
+            frameUniforms.update(view.camera->getCameraMatrix(), glm::vec4(view.viewport), time);
+            batch.renderBatch(view.camera->getViewRect());
+        }
+        glDisable(GL_SCISSOR_TEST);
+
+        glViewport(windowViewport[0], windowViewport[1], windowViewport[2], windowViewport[3]);
+        frameUniforms.update(frameData);
+    }
+
+}
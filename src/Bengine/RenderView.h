@@ -0,0 +1,29 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+
+namespace Bengine {
+
+    class Camera2D;
+    class FrameUniforms;
+    class SpriteBatch;
+
+    // A camera and the part of the window it is drawn into, for split screen
+    // and minimaps. Init the camera with the viewport's size, so it keeps its
+    // aspect ratio.
+    struct RenderView {
+        const Camera2D* camera;
+        glm::ivec4 viewport; ///< x, y, width and height in pixels, from the bottom left
+    };
+
+    // Draws batch once per view. Each view gets its viewport and scissor rect,
+    // its camera matrix and viewport in frameUniforms, and only the glyphs in its
+    // camera's view rect. The glyphs are sorted and uploaded once by batch.end(),
+    // the views only add draw calls. Call it with the program in use, like
+    // renderBatch(). Restores the viewport and the frameUniforms data and
+    // disables the scissor test after.
+    void renderViews(SpriteBatch& batch, FrameUniforms& frameUniforms, const RenderView* views, size_t numViews, float time);
+
+}
@@ -0,0 +1,57 @@
+#include "SlotBuffer.h"
+
+namespace Bengine {
+
+// Dirty ranges closer than this many slots are uploaded as one range, since a
+// few extra bytes are cheaper than another glBufferSubData call
+const GLuint DIRTY_RANGE_MERGE_GAP = 10;
+
+SlotBuffer::SlotBuffer(GLuint elementsPerSlot) : _elementsPerSlot(elementsPerSlot), _needsRebuild(false)
+{
+}
+
+void SlotBuffer::markDirty(int slot) {
+    GLuint offset = getOffset(slot);
+    _dirtyRanges.push_back({ offset, offset + _elementsPerSlot });
+}
+
+void SlotBuffer::clear() {
+    _order.clear();
+    _slotOffsets.clear();
+    _dirtyRanges.clear();
+    _needsRebuild = false;
+}
+
+void SlotBuffer::uploadDirtyRanges(GLuint vbo, const void* data, size_t elementSize) {
+    if (_dirtyRanges.empty()) return;
+
+    std::sort(_dirtyRanges.begin(), _dirtyRanges.end(), [](const DirtyRange& a, const DirtyRange& b) {
+        return a.begin < b.begin;
+    });
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    const GLuint mergeGap = DIRTY_RANGE_MERGE_GAP * _elementsPerSlot;
+    const char* bytes = (const char*)data;
+    DirtyRange range = _dirtyRanges[0];
+    for (size_t i = 1; i <= _dirtyRanges.size(); i++) {
+        // Grow the range while the next one is close enough
+        if (i < _dirtyRanges.size() && _dirtyRanges[i].begin <= range.end + mergeGap) {
+            range.end = std::max(range.end, _dirtyRanges[i].end);
+            continue;
+        }
+
+        glBufferSubData(GL_ARRAY_BUFFER, range.begin * elementSize, (range.end - range.begin) * elementSize,
+                        bytes + range.begin * elementSize);
+
+        if (i < _dirtyRanges.size()) {
+            range = _dirtyRanges[i];
+        }
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    _dirtyRanges.clear();
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace Bengine {
+
+// The bookkeeping StaticSpriteBatch and AnimatedSpriteBatch share. Sprites are
+// addressed by the slot draw() returned, while the GPU buffer holds them sorted
+// by texture, so this maps each slot to its place in the buffer. Changed slots
+// are remembered as dirty ranges and uploaded merged, and a changed texture
+// flags the whole buffer for a rebuild.
+class SlotBuffer
+{
+public:
+    // elementsPerSlot is how many buffer elements one sprite takes, such as 6
+    // vertices or 1 instance
+    explicit SlotBuffer(GLuint elementsPerSlot);
+
+    // Orders numSlots slots by getTexture(slot), keeping the draw order within
+    // a texture, and gives each slot its place in the buffer. Clears the dirty
+    // ranges and the rebuild flag, since the caller uploads everything next.
+    // Returns the slots in buffer order.
+    template <typename GetTexture>
+    const std::vector<int>& sortSlots(size_t numSlots, GetTexture getTexture);
+
+    // First element of slot in the buffer. Only slots of the last
+    // sortSlots() are valid.
+    GLuint getOffset(int slot) const {
+        assert(slot >= 0 && (size_t)slot < _slotOffsets.size());
+        return _slotOffsets[slot];
+    }
+    // How many slots the last sortSlots() placed, 0 after clear()
+    size_t getNumSlots() const { return _slotOffsets.size(); }
+
+    // Marks the elements of slot for the next uploadDirtyRanges()
+    void markDirty(int slot);
+    // The slot's texture changed, so the buffer must be sorted again
+    void markNeedsRebuild() { _needsRebuild = true; }
+    bool needsRebuild() const { return _needsRebuild; }
+    bool hasDirtyRanges() const { return !_dirtyRanges.empty(); }
+
+    // Forgets the slots, the dirty ranges and the rebuild flag
+    void clear();
+
+    // Uploads the dirty ranges of data, the CPU copy of vbo whose elements are
+    // elementSize bytes, and forgets them
+    void uploadDirtyRanges(GLuint vbo, const void* data, size_t elementSize);
+
+private:
+    struct DirtyRange {
+        GLuint begin;
+        GLuint end;
+    };
+
+    GLuint _elementsPerSlot;
+    bool _needsRebuild;
+
+    std::vector<int> _order; ///< Slots in buffer order
+    std::vector<GLuint> _slotOffsets; ///< First element of each slot in the buffer
+    std::vector<DirtyRange> _dirtyRanges; ///< In elements
+};
+
+template <typename GetTexture>
+const std::vector<int>& SlotBuffer::sortSlots(size_t numSlots, GetTexture getTexture) {
+    clear();
+
+    // Sort the slots instead of the sprites, so slots stay valid
+    _order.resize(numSlots);
+    for (size_t i = 0; i < numSlots; i++) {
+        _order[i] = (int)i;
+    }
+    std::stable_sort(_order.begin(), _order.end(), [&getTexture](int a, int b) {
+        return getTexture(a) < getTexture(b);
+    });
+
+    _slotOffsets.resize(numSlots);
+    for (size_t i = 0; i < numSlots; i++) {
+        _slotOffsets[_order[i]] = (GLuint)i * _elementsPerSlot;
+    }
+    return _order;
+}
+
+}
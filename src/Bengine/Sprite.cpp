@@ -1,6 +1,7 @@
 #include "Sprite.h"
 #include "Vertex.h"
 #include "ResourceManager.h"
+#include "GLStateCache.h"
 
 #include <cstddef>
 
@@ -84,7 +85,10 @@ namespace Bengine {
     //Draws the sprite to the screen
     void Sprite::draw() {
 
-        glBindTexture(GL_TEXTURE_2D, _texture.id);
+        //The attributes are set on the default vertex array, not on a batch's VAO
+        GLStateCache::bindVertexArray(0);
+
+        GLStateCache::bindTexture(GL_TEXTURE_2D, _texture.id);
 
         //bind the buffer object
         glBindBuffer(GL_ARRAY_BUFFER, _vboID);
@@ -1,13 +1,22 @@
 #include "SpriteBatch.h"
+#include "TextureArrayCache.h"
+#include "GlyphKernels.h"
+#include "BengineErrors.h"
+#include "GLSLProgram.h"
+#include "GLStateCache.h"
 
 #include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string>
 
 namespace Bengine {
 
 
     Glyph::Glyph(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint Texture, float Depth, const ColorRGBA8& color) :
         texture(Texture),
-        depth(Depth) {
+        depth(Depth),
+        layer(0) {
 
         topLeft.color = color;
         topLeft.setPosition(destRect.x, destRect.y + destRect.w);
@@ -27,8 +36,14 @@ namespace Bengine {
     }
 
     Glyph::Glyph(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint Texture, float Depth, const ColorRGBA8& color, float angle) :
+        Glyph(destRect, uvRect, Texture, Depth, color, glm::vec2(cos(angle), sin(angle))) {
+        // Only one cos and sin per glyph, the corners reuse them
+    }
+
+    Glyph::Glyph(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint Texture, float Depth, const ColorRGBA8& color, const glm::vec2& rotation) :
         texture(Texture),
-        depth(Depth) {
+        depth(Depth),
+        layer(0) {
 
         glm::vec2 halfDims(destRect.z / 2.0f, destRect.w / 2.0f);
 
@@ -39,10 +54,10 @@ namespace Bengine {
         glm::vec2 tr(halfDims.x, halfDims.y);
 
         // Rotate the points
-        tl = rotatePoint(tl, angle) + halfDims;
-        bl = rotatePoint(bl, angle) + halfDims;
-        br = rotatePoint(br, angle) + halfDims;
-        tr = rotatePoint(tr, angle) + halfDims;
+        tl = rotatePoint(tl, rotation) + halfDims;
+        bl = rotatePoint(bl, rotation) + halfDims;
+        br = rotatePoint(br, rotation) + halfDims;
+        tr = rotatePoint(tr, rotation) + halfDims;
 
         topLeft.color = color;
         topLeft.setPosition(destRect.x + tl.x, destRect.y + tl.y);
@@ -61,15 +76,74 @@ namespace Bengine {
         topRight.setUV(uvRect.x + uvRect.z, uvRect.y + uvRect.w);
     }
 
-    glm::vec2 Glyph::rotatePoint(const glm::vec2& pos, float angle) {
+    Glyph::Glyph(const Position& tl, const Position& bl, const Position& br, const Position& tr,
+                 const glm::vec4& uvRect, GLuint Texture, float Depth, const ColorRGBA8& color) :
+        texture(Texture),
+        depth(Depth),
+        layer(0) {
+
+        topLeft.color = color;
+        topLeft.position = tl;
+        topLeft.setUV(uvRect.x, uvRect.y + uvRect.w);
+
+        bottomLeft.color = color;
+        bottomLeft.position = bl;
+        bottomLeft.setUV(uvRect.x, uvRect.y);
+
+        bottomRight.color = color;
+        bottomRight.position = br;
+        bottomRight.setUV(uvRect.x + uvRect.z, uvRect.y);
+
+        topRight.color = color;
+        topRight.position = tr;
+        topRight.setUV(uvRect.x + uvRect.z, uvRect.y + uvRect.w);
+    }
+
+    glm::vec2 Glyph::rotatePoint(const glm::vec2& pos, const glm::vec2& rotation) {
         glm::vec2 newv;
-        newv.x = pos.x * cos(angle) - pos.y * sin(angle);
-        newv.y = pos.x * sin(angle) + pos.y * cos(angle);
+        newv.x = pos.x * rotation.x - pos.y * rotation.y;
+        newv.y = pos.x * rotation.y + pos.y * rotation.x;
         return newv;
     }
 
-SpriteBatch::SpriteBatch() : _vbo(0), _vao(0)
+const size_t SpriteBatch::ROTATED_CHUNK_SIZE;
+const GLuint SpriteBatch::MULTI_DRAW_TEXTURE_UNITS;
+
+// Looks up a uniform of whatever program is in use, since SpriteBatch isn't
+// told which one that is. A GLSLProgram answers from its table, anything else
+// is asked by name.
+static GLint getCurrentUniformLocation(const char* uniformName, GLuint nameHash) {
+    const GLSLProgram* current = GLSLProgram::getCurrent();
+    if (current) {
+        return current->getUniformLocation(nameHash);
+    }
+    GLint program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    return glGetUniformLocation(program, uniformName);
+}
+
+static constexpr GLuint BATCH_ORIGIN_HASH = GLSLProgram::hashUniformName("batchOrigin");
+static constexpr GLuint SAMPLERS_HASH = GLSLProgram::hashUniformName("mySamplers");
+static constexpr GLuint ALPHA_CUTOFF_HASH = GLSLProgram::hashUniformName("alphaCutoff");
+
+// Grows scratch to at least size elements. It never shrinks, so once it is big
+// enough it isn't reallocated or cleared again.
+template<typename T>
+static void growScratch(std::vector<T>& scratch, size_t size) {
+    if (scratch.size() < size) {
+        scratch.resize(size);
+    }
+}
+
+const float SpriteBatch::OPAQUE_ALPHA_CUTOFF = 0.5f;
+
+SpriteBatch::SpriteBatch() : _vbo(0), _vao(0), _layerVbo(0), _drawUnitVbo(0), _indirectBuffer(0), _depthVbo(0),
+    _multiDrawIndirect(false), _numDrawCalls(0), _numRenderedGlyphs(0), _vertexFormat(VertexFormat::STANDARD),
+    _batchOrigin(0.0f), _numUploadedBytes(0), _depthBuffer(false), _nearDepth(0.0f), _farDepth(1.0f),
+    _numOpaqueGlyphs(0), _numOpaqueBatches(0), _numOpaqueGroups(0), _profiling(false), _cullGlyphs(false),
+    _numSubmittedGlyphs(0), _numCulledGlyphs(0), _glyphBoundsValid(false), _numVisibleGlyphs(0), _numAllocations(0), _textureArrays(nullptr)
 {
+    std::fill(std::begin(_capacities), std::end(_capacities), 0);
 }
 
 SpriteBatch::~SpriteBatch()
@@ -82,6 +156,7 @@ void SpriteBatch::init() {
 
 void SpriteBatch::dispose() {
     if (_vao != 0) {
+        GLStateCache::forgetVertexArray(_vao);
         glDeleteVertexArrays(1, &_vao);
         _vao = 0;
     }
@@ -89,6 +164,22 @@ void SpriteBatch::dispose() {
         glDeleteBuffers(1, &_vbo);
         _vbo = 0;
     }
+    if (_layerVbo != 0) {
+        glDeleteBuffers(1, &_layerVbo);
+        _layerVbo = 0;
+    }
+    if (_drawUnitVbo != 0) {
+        glDeleteBuffers(1, &_drawUnitVbo);
+        _drawUnitVbo = 0;
+    }
+    if (_indirectBuffer != 0) {
+        glDeleteBuffers(1, &_indirectBuffer);
+        _indirectBuffer = 0;
+    }
+    if (_depthVbo != 0) {
+        glDeleteBuffers(1, &_depthVbo);
+        _depthVbo = 0;
+    }
 }
 
 void SpriteBatch::begin(GlyphSortType sortType /* GlyphSortType::TEXTURE */) {
@@ -98,9 +189,28 @@ void SpriteBatch::begin(GlyphSortType sortType /* GlyphSortType::TEXTURE */) {
     // Makes _glpyhs.size() == 0, however it does not free internal memory.
     // So when we later call emplace_back it doesn't need to internally call new.
     _glyphs.clear();
+
+    _cullGlyphs = false;
+    _numSubmittedGlyphs = 0;
+    _numCulledGlyphs = 0;
+}
+
+void SpriteBatch::begin(const glm::vec4& viewRect, GlyphSortType sortType /* GlyphSortType::TEXTURE */) {
+    begin(sortType);
+    _cullGlyphs = true;
+    _viewRect = viewRect;
 }
 
 void SpriteBatch::end() {
+    if (_profiling) {
+        _timings = SpriteBatchTimings();
+        _stageStart = std::chrono::high_resolution_clock::now();
+    }
+
+    if (_textureArrays) {
+        resolveTextureArrays();
+    }
+
     // Set up all pointers for fast sorting
     _glyphPointers.resize(_glyphs.size());
     for (size_t i = 0; i < _glyphs.size(); i++) {
@@ -108,94 +218,512 @@ void SpriteBatch::end() {
     }
 
     sortGlyphs();
+    endStage(_timings.sort);
+
     createRenderBatches();
+    _glyphBoundsValid = false;
+
+    countAllocations();
+}
+
+void SpriteBatch::reserve(size_t numGlyphs) {
+    _glyphs.reserve(numGlyphs);
+    _glyphPointers.reserve(numGlyphs);
+    _renderBatches.reserve(numGlyphs);
+    growScratch(_sortEntries, numGlyphs);
+    growScratch(_sortScratch, numGlyphs);
+    if (_vertexFormat == VertexFormat::PACKED) {
+        growScratch(_packedVertices, numGlyphs * 6);
+    } else {
+        growScratch(_vertices, numGlyphs * 6);
+    }
+    if (_textureArrays) {
+        growScratch(_layers, numGlyphs * 6);
+    }
+    if (_depthBuffer) {
+        growScratch(_depths, numGlyphs * 6);
+    }
+    if (_multiDrawIndirect) {
+        _multiDrawGroups.reserve(numGlyphs);
+        growScratch(_indirectCommands, numGlyphs);
+    }
+
+    // Growing on request isn't what the counter is for
+    size_t numAllocations = _numAllocations;
+    countAllocations();
+    _numAllocations = numAllocations;
 }
 
 void SpriteBatch::draw(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color) {
+    if (!acceptGlyph(destRect, false)) return;
     _glyphs.emplace_back(destRect, uvRect, texture, depth, color);
 }
 
 void SpriteBatch::draw(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color, float angle) {
+    if (!acceptGlyph(destRect, true)) return;
     _glyphs.emplace_back(destRect, uvRect, texture, depth, color, angle);
 }
 
 void SpriteBatch::draw(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color, const glm::vec2& dir) {
-    const glm::vec2 right(1.0f, 0.0f);
-    float angle = acos(glm::dot(right, dir));
-    if (dir.y < 0.0f) angle = -angle;
+    if (!acceptGlyph(destRect, true)) return;
 
-    _glyphs.emplace_back(destRect, uvRect, texture, depth, color, angle);
+    // A normalized direction already is (cos(angle), sin(angle)), no need for acos
+    float length = glm::length(dir);
+    glm::vec2 rotation = (length > 0.0f) ? dir / length : glm::vec2(1.0f, 0.0f);
+
+    _glyphs.emplace_back(destRect, uvRect, texture, depth, color, rotation);
+}
+
+void SpriteBatch::drawGlyphs(const SpriteBatch& other) {
+    _glyphs.insert(_glyphs.end(), other._glyphs.begin(), other._glyphs.end());
+    _numSubmittedGlyphs += other._numSubmittedGlyphs;
+    _numCulledGlyphs += other._numCulledGlyphs;
+}
+
+void SpriteBatch::drawRotated(const glm::vec4* destRects, const float* angles, size_t count,
+                              const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color) {
+    glm::vec4 rects[ROTATED_CHUNK_SIZE];
+    float cosines[ROTATED_CHUNK_SIZE];
+    float sines[ROTATED_CHUNK_SIZE];
+    unsigned int visible[ROTATED_CHUNK_SIZE];
+
+    _numSubmittedGlyphs += count;
+
+    for (size_t start = 0; start < count; start += ROTATED_CHUNK_SIZE) {
+        size_t n = std::min(ROTATED_CHUNK_SIZE, count - start);
+        // Cull first so culled glyphs never pay for cos and sin
+        size_t numVisible = cullRotatedChunk(destRects + start, n, visible);
+        for (size_t i = 0; i < numVisible; i++) {
+            size_t index = start + visible[i];
+            rects[i] = destRects[index];
+            cosines[i] = cos(angles[index]);
+            sines[i] = sin(angles[index]);
+        }
+        addRotatedGlyphs(rects, cosines, sines, numVisible, uvRect, texture, depth, color);
+    }
+}
+
+void SpriteBatch::drawRotated(const glm::vec4* destRects, const glm::vec2* dirs, size_t count,
+                              const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color) {
+    glm::vec4 rects[ROTATED_CHUNK_SIZE];
+    float cosines[ROTATED_CHUNK_SIZE];
+    float sines[ROTATED_CHUNK_SIZE];
+    unsigned int visible[ROTATED_CHUNK_SIZE];
+
+    _numSubmittedGlyphs += count;
+
+    for (size_t start = 0; start < count; start += ROTATED_CHUNK_SIZE) {
+        size_t n = std::min(ROTATED_CHUNK_SIZE, count - start);
+        size_t numVisible = cullRotatedChunk(destRects + start, n, visible);
+        for (size_t i = 0; i < numVisible; i++) {
+            size_t index = start + visible[i];
+            rects[i] = destRects[index];
+            const glm::vec2& dir = dirs[index];
+            float length = glm::length(dir);
+            if (length > 0.0f) {
+                cosines[i] = dir.x / length;
+                sines[i] = dir.y / length;
+            } else {
+                cosines[i] = 1.0f;
+                sines[i] = 0.0f;
+            }
+        }
+        addRotatedGlyphs(rects, cosines, sines, numVisible, uvRect, texture, depth, color);
+    }
 }
 
 void SpriteBatch::renderBatch() {
+    if (_profiling) {
+        _stageStart = std::chrono::high_resolution_clock::now();
+        _timings.render = 0.0;
+    }
+
+    render(false);
 
+    endStage(_timings.render);
+}
+
+void SpriteBatch::renderBatch(const glm::vec4& viewRect) {
+    if (_profiling) {
+        _stageStart = std::chrono::high_resolution_clock::now();
+        _timings.render = 0.0;
+    }
+
+    if (!_glyphBoundsValid) {
+        computeGlyphBounds();
+    }
+    growScratch(_visibleGlyphs, _glyphPointers.size());
+    _numVisibleGlyphs = findVisibleRects(_glyphBounds.data(), _glyphPointers.size(), viewRect, false, _visibleGlyphs.data());
+
+    render(true);
+
+    endStage(_timings.render);
+}
+
+void SpriteBatch::render(bool visibleOnly) {
     // Bind our VAO. This sets up the opengl state we need, including the 
     // vertex attribute pointers and it binds the VBO
-    glBindVertexArray(_vao);
+    GLStateCache::bindVertexArray(_vao);
 
-    for (size_t i = 0; i < _renderBatches.size(); i++) {
-        glBindTexture(GL_TEXTURE_2D, _renderBatches[i].texture);
+    if (_vertexFormat == VertexFormat::PACKED) {
+        // The packed positions are relative to the batch origin
+        GLint originLocation = getCurrentUniformLocation("batchOrigin", BATCH_ORIGIN_HASH);
+        if (originLocation != -1) {
+            glUniform2f(originLocation, _batchOrigin.x, _batchOrigin.y);
+        }
+    }
+
+    _numDrawCalls = 0;
+    _numRenderedGlyphs = 0;
+    if (_multiDrawIndirect) {
+        // Sampler i reads texture unit i
+        GLint units[MULTI_DRAW_TEXTURE_UNITS];
+        for (GLuint i = 0; i < MULTI_DRAW_TEXTURE_UNITS; i++) {
+            units[i] = (GLint)i;
+        }
+        GLint samplersLocation = getCurrentUniformLocation("mySamplers", SAMPLERS_HASH);
+        if (samplersLocation != -1) {
+            glUniform1iv(samplersLocation, MULTI_DRAW_TEXTURE_UNITS, units);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer);
+    }
 
-        glDrawArrays(GL_TRIANGLES, _renderBatches[i].offset, _renderBatches[i].numVertices);
+    if (_depthBuffer) {
+        GLint cutoffLocation = getCurrentUniformLocation("alphaCutoff", ALPHA_CUTOFF_HASH);
+
+        // Opaque glyphs first, so everything behind them fails the depth test
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LEQUAL);
+        glDepthMask(GL_TRUE);
+        if (cutoffLocation != -1) {
+            glUniform1f(cutoffLocation, OPAQUE_ALPHA_CUTOFF);
+        }
+        submitBatches(false, visibleOnly);
+
+        // Translucent glyphs still test against the opaque ones, but blend with
+        // each other back to front instead of hiding each other
+        glDepthMask(GL_FALSE);
+        if (cutoffLocation != -1) {
+            glUniform1f(cutoffLocation, 0.0f);
+        }
+        submitBatches(true, visibleOnly);
+
+        glDepthMask(GL_TRUE);
+        glDisable(GL_DEPTH_TEST);
+    } else {
+        // Without the depth buffer every batch counts as opaque
+        submitBatches(false, visibleOnly);
+    }
+
+    if (_multiDrawIndirect) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
     }
 
-    glBindVertexArray(0);
+    // The VAO stays bound, so rendering this batch again doesn't rebind it
 }
 
-void SpriteBatch::createRenderBatches() {
-    // This will store all the vertices that we need to upload
-    std::vector <Vertex> vertices;
-    // Resize the buffer to the exact size we need so we can treat
-    // it like an array
-    vertices.resize(_glyphPointers.size() * 6);
+void SpriteBatch::submitBatches(bool translucent, bool visibleOnly) {
+    // Texture arrays are bound to their own target
+    GLenum target = _textureArrays ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+
+    if (_multiDrawIndirect) {
+        // Groups never straddle the opaque and translucent batches
+        size_t first = translucent ? _numOpaqueGroups : 0;
+        size_t last = translucent ? _multiDrawGroups.size() : _numOpaqueGroups;
+        for (size_t g = first; g < last; g++) {
+            const MultiDrawGroup& group = _multiDrawGroups[g];
+            for (GLuint i = 0; i < group.numTextures; i++) {
+                GLStateCache::bindTexture(target, group.textures[i], i);
+            }
+
+            glMultiDrawArraysIndirect(GL_TRIANGLES, (void*)(group.firstCommand * sizeof(DrawArraysIndirectCommand)),
+                                      group.numCommands, 0);
+            _numDrawCalls++;
+        }
+        _numRenderedGlyphs += translucent ? _glyphPointers.size() - _numOpaqueGlyphs : _numOpaqueGlyphs;
+    } else if (visibleOnly) {
+        submitVisibleRuns(translucent ? _numOpaqueBatches : 0, translucent ? _renderBatches.size() : _numOpaqueBatches);
+    } else {
+        size_t first = translucent ? _numOpaqueBatches : 0;
+        size_t last = translucent ? _renderBatches.size() : _numOpaqueBatches;
+        for (size_t i = first; i < last; i++) {
+            GLStateCache::bindTexture(target, _renderBatches[i].texture);
+
+            glDrawArrays(GL_TRIANGLES, _renderBatches[i].offset, _renderBatches[i].numVertices);
+            _numRenderedGlyphs += _renderBatches[i].numVertices / 6;
+        }
+        _numDrawCalls += last - first;
+    }
+}
+
+void SpriteBatch::submitVisibleRuns(size_t first, size_t last) {
+    GLenum target = _textureArrays ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
 
+    for (size_t i = first; i < last; i++) {
+        const RenderBatch& batch = _renderBatches[i];
+        const unsigned int firstGlyph = batch.offset / 6;
+        const unsigned int endGlyph = firstGlyph + batch.numVertices / 6;
+
+        // Glyphs are in vertex order, so the visible ones of a batch are together
+        const unsigned int* visibleBegin = _visibleGlyphs.data();
+        const unsigned int* visibleEnd = visibleBegin + _numVisibleGlyphs;
+        const unsigned int* it = std::lower_bound(visibleBegin, visibleEnd, firstGlyph);
+        size_t numRuns = 0;
+        for (; it != visibleEnd && *it < endGlyph; ++it) {
+            // Glyphs that follow each other in the buffer extend the current run
+            if (numRuns > 0 && (GLint)(*it * 6) == _runFirsts[numRuns - 1] + _runCounts[numRuns - 1]) {
+                _runCounts[numRuns - 1] += 6;
+            } else {
+                growScratch(_runFirsts, numRuns + 1);
+                growScratch(_runCounts, numRuns + 1);
+                _runFirsts[numRuns] = (GLint)(*it * 6);
+                _runCounts[numRuns] = 6;
+                numRuns++;
+            }
+            _numRenderedGlyphs++;
+        }
+        if (numRuns == 0) continue;
+
+        GLStateCache::bindTexture(target, batch.texture);
+        glMultiDrawArrays(GL_TRIANGLES, _runFirsts.data(), _runCounts.data(), (GLsizei)numRuns);
+        _numDrawCalls++;
+    }
+}
+
+void SpriteBatch::computeGlyphBounds() {
+    _glyphBoundsValid = true;
+    growScratch(_glyphBounds, _glyphPointers.size());
+
+    for (size_t i = 0; i < _glyphPointers.size(); i++) {
+        const Glyph& glyph = *_glyphPointers[i];
+        // The corners of rotated glyphs can be in any order
+        glm::vec2 minCorner(glyph.topLeft.position.x, glyph.topLeft.position.y);
+        glm::vec2 maxCorner = minCorner;
+        const Position* corners[3] = { &glyph.bottomLeft.position, &glyph.topRight.position, &glyph.bottomRight.position };
+        for (const Position* corner : corners) {
+            minCorner = glm::min(minCorner, glm::vec2(corner->x, corner->y));
+            maxCorner = glm::max(maxCorner, glm::vec2(corner->x, corner->y));
+        }
+        _glyphBounds[i] = glm::vec4(minCorner, maxCorner - minCorner);
+    }
+}
+
+void SpriteBatch::createRenderBatches() {
+    _numUploadedBytes = 0;
+    _numOpaqueBatches = 0;
+    _numOpaqueGroups = 0;
     if (_glyphPointers.empty()) {
         return;
     }
 
     int offset = 0; // current offset
-    int cv = 0; // current vertex
 
     //Add the first batch
     _renderBatches.emplace_back(offset, 6, _glyphPointers[0]->texture);
-    vertices[cv++] = _glyphPointers[0]->topLeft;
-    vertices[cv++] = _glyphPointers[0]->bottomLeft;
-    vertices[cv++] = _glyphPointers[0]->bottomRight;
-    vertices[cv++] = _glyphPointers[0]->bottomRight;
-    vertices[cv++] = _glyphPointers[0]->topRight;
-    vertices[cv++] = _glyphPointers[0]->topLeft;
     offset += 6;
 
     //Add all the rest of the glyphs
     for (size_t cg = 1; cg < _glyphPointers.size(); cg++) {
 
         // Check if this glyph can be part of the current batch
-        if (_glyphPointers[cg]->texture != _glyphPointers[cg - 1]->texture) {
+        if (cg == _numOpaqueGlyphs) {
+            // The translucent glyphs are drawn in their own pass
+            _numOpaqueBatches = _renderBatches.size();
+            _renderBatches.emplace_back(offset, 6, _glyphPointers[cg]->texture);
+        } else if (_glyphPointers[cg]->texture != _glyphPointers[cg - 1]->texture) {
             // Make a new batch
             _renderBatches.emplace_back(offset, 6, _glyphPointers[cg]->texture);
         } else {
             // If its part of the current batch, just increase numVertices
             _renderBatches.back().numVertices += 6;
         }
+        offset += 6;
+    }
+    if (_numOpaqueGlyphs == _glyphPointers.size()) {
+        _numOpaqueBatches = _renderBatches.size();
+    }
+
+    endStage(_timings.vertexBuild);
+
+    if (_multiDrawIndirect) {
+        createIndirectCommands();
+    }
+
+    // Bind our VBO
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+    if (_vertexFormat == VertexFormat::PACKED) {
+        uploadPackedVertices();
+    } else {
+        uploadVertices();
+    }
+
+    if (_textureArrays) {
+        // Every vertex of a glyph samples the same layer
+        size_t numLayers = _glyphPointers.size() * 6;
+        growScratch(_layers, numLayers);
+        for (size_t cg = 0; cg < _glyphPointers.size(); cg++) {
+            std::fill(_layers.begin() + cg * 6, _layers.begin() + cg * 6 + 6, (GLfloat)_glyphPointers[cg]->layer);
+        }
+        endStage(_timings.vertexBuild);
+
+        glBindBuffer(GL_ARRAY_BUFFER, _layerVbo);
+        glBufferData(GL_ARRAY_BUFFER, numLayers * sizeof(GLfloat), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, numLayers * sizeof(GLfloat), _layers.data());
+        _numUploadedBytes += numLayers * sizeof(GLfloat);
+        endStage(_timings.upload);
+    }
+
+    if (_depthBuffer) {
+        size_t numDepths = _glyphPointers.size() * 6;
+        growScratch(_depths, numDepths);
+        for (size_t cg = 0; cg < _glyphPointers.size(); cg++) {
+            std::fill(_depths.begin() + cg * 6, _depths.begin() + cg * 6 + 6, getDepthBufferValue(_glyphPointers[cg]->depth));
+        }
+        endStage(_timings.vertexBuild);
+
+        glBindBuffer(GL_ARRAY_BUFFER, _depthVbo);
+        glBufferData(GL_ARRAY_BUFFER, numDepths * sizeof(GLfloat), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, numDepths * sizeof(GLfloat), _depths.data());
+        _numUploadedBytes += numDepths * sizeof(GLfloat);
+        endStage(_timings.upload);
+    }
+
+    // Unbind the VBO
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+}
+
+void SpriteBatch::createIndirectCommands() {
+    _multiDrawGroups.clear();
+
+    growScratch(_indirectCommands, _renderBatches.size());
+    DrawArraysIndirectCommand* commands = _indirectCommands.data();
+    for (size_t i = 0; i < _renderBatches.size(); i++) {
+        const RenderBatch& batch = _renderBatches[i];
+
+        // The translucent batches start their own group, since they are drawn
+        // with different depth state
+        bool translucentStart = (i == _numOpaqueBatches);
+        if (translucentStart) {
+            _numOpaqueGroups = _multiDrawGroups.size();
+        }
+
+        // Reuse the unit if the group already has this texture, which happens
+        // a lot when sorting by depth
+        GLuint unit = MULTI_DRAW_TEXTURE_UNITS;
+        if (!_multiDrawGroups.empty() && !translucentStart) {
+            const MultiDrawGroup& group = _multiDrawGroups.back();
+            for (GLuint u = 0; u < group.numTextures; u++) {
+                if (group.textures[u] == batch.texture) {
+                    unit = u;
+                    break;
+                }
+            }
+        }
+
+        if (unit == MULTI_DRAW_TEXTURE_UNITS) {
+            // Start a new group once every unit is taken
+            if (_multiDrawGroups.empty() || translucentStart ||
+                _multiDrawGroups.back().numTextures == MULTI_DRAW_TEXTURE_UNITS) {
+                _multiDrawGroups.emplace_back();
+                _multiDrawGroups.back().firstCommand = (GLuint)i;
+                _multiDrawGroups.back().numCommands = 0;
+                _multiDrawGroups.back().numTextures = 0;
+            }
+            MultiDrawGroup& group = _multiDrawGroups.back();
+            unit = group.numTextures++;
+            group.textures[unit] = batch.texture;
+        }
+        _multiDrawGroups.back().numCommands++;
+
+        // baseInstance picks the texture unit out of _drawUnitVbo
+        commands[i].count = batch.numVertices;
+        commands[i].instanceCount = 1;
+        commands[i].first = batch.offset;
+        commands[i].baseInstance = unit;
+    }
+    if (_numOpaqueBatches == _renderBatches.size()) {
+        _numOpaqueGroups = _multiDrawGroups.size();
+    }
+
+    endStage(_timings.vertexBuild);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer);
+    const size_t commandsSize = _renderBatches.size() * sizeof(DrawArraysIndirectCommand);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commandsSize, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandsSize, commands);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    endStage(_timings.upload);
+}
+
+void SpriteBatch::uploadVertices() {
+    // Make sure the staging buffer is big enough to treat it like an array
+    const size_t numVertices = _glyphPointers.size() * 6;
+    growScratch(_vertices, numVertices);
+    Vertex* vertices = _vertices.data();
+
+    int cv = 0; // current vertex
+    for (size_t cg = 0; cg < _glyphPointers.size(); cg++) {
         vertices[cv++] = _glyphPointers[cg]->topLeft;
         vertices[cv++] = _glyphPointers[cg]->bottomLeft;
         vertices[cv++] = _glyphPointers[cg]->bottomRight;
         vertices[cv++] = _glyphPointers[cg]->bottomRight;
         vertices[cv++] = _glyphPointers[cg]->topRight;
         vertices[cv++] = _glyphPointers[cg]->topLeft;
-        offset += 6;
     }
+    endStage(_timings.vertexBuild);
 
-    // Bind our VBO
-    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
     // Orphan the buffer (for speed)
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
     // Upload the data
-    glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex), vertices.data());
+    glBufferSubData(GL_ARRAY_BUFFER, 0, numVertices * sizeof(Vertex), vertices);
+    _numUploadedBytes += numVertices * sizeof(Vertex);
+    endStage(_timings.upload);
+}
 
-    // Unbind the VBO
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+void SpriteBatch::uploadPackedVertices() {
+    // The four corners of a glyph are next to each other, so they can be packed in one go
+    static_assert(offsetof(Glyph, bottomLeft) == offsetof(Glyph, topLeft) + sizeof(Vertex) &&
+                  offsetof(Glyph, topRight) == offsetof(Glyph, topLeft) + sizeof(Vertex) * 2 &&
+                  offsetof(Glyph, bottomRight) == offsetof(Glyph, topLeft) + sizeof(Vertex) * 3,
+                  "Glyph corners must be contiguous");
 
+    // Center the origin on the batch, where the half floats are most precise
+    glm::vec2 minPos(_glyphPointers[0]->topLeft.position.x, _glyphPointers[0]->topLeft.position.y);
+    glm::vec2 maxPos = minPos;
+    for (size_t cg = 0; cg < _glyphPointers.size(); cg++) {
+        const Vertex* corners = &_glyphPointers[cg]->topLeft;
+        for (int i = 0; i < 4; i++) {
+            glm::vec2 pos(corners[i].position.x, corners[i].position.y);
+            minPos = glm::min(minPos, pos);
+            maxPos = glm::max(maxPos, pos);
+        }
+    }
+    _batchOrigin = (minPos + maxPos) * 0.5f;
+
+    const size_t numVertices = _glyphPointers.size() * 6;
+    growScratch(_packedVertices, numVertices);
+    PackedVertex* vertices = _packedVertices.data();
+
+    int cv = 0; // current vertex
+    PackedVertex corners[4]; // topLeft, bottomLeft, topRight, bottomRight
+    for (size_t cg = 0; cg < _glyphPointers.size(); cg++) {
+        // Pack the 4 distinct corners once, then emit the 6 vertices
+        packVertices(&_glyphPointers[cg]->topLeft, 4, _batchOrigin, corners);
+        vertices[cv++] = corners[0];
+        vertices[cv++] = corners[1];
+        vertices[cv++] = corners[3];
+        vertices[cv++] = corners[3];
+        vertices[cv++] = corners[2];
+        vertices[cv++] = corners[0];
+    }
+    endStage(_timings.vertexBuild);
+
+    glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(PackedVertex), nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, numVertices * sizeof(PackedVertex), vertices);
+    _numUploadedBytes += numVertices * sizeof(PackedVertex);
+    endStage(_timings.upload);
 }
 
 void SpriteBatch::createVertexArray() {
@@ -206,7 +734,7 @@ void SpriteBatch::createVertexArray() {
     }
     
     // Bind the VAO. All subsequent opengl calls will modify it's state.
-    glBindVertexArray(_vao);
+    GLStateCache::bindVertexArray(_vao);
 
     //G enerate the VBO if it isn't already generated
     if (_vbo == 0) {
@@ -219,42 +747,351 @@ void SpriteBatch::createVertexArray() {
     glEnableVertexAttribArray(1);
     glEnableVertexAttribArray(2);
 
-    //This is the position attribute pointer
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-    //This is the color attribute pointer
-    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
-    //This is the UV attribute pointer
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+    if (_vertexFormat == VertexFormat::PACKED) {
+        //Half float positions, the shader adds the batch origin
+        glVertexAttribPointer(0, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, color));
+        //Normalized 16 bit UVs come out as floats in [0, 1]
+        glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, uv));
+    } else {
+        //This is the position attribute pointer
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+        //This is the color attribute pointer
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+        //This is the UV attribute pointer
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+    }
+
+    GLStateCache::bindVertexArray(0);
+
+}
+
+void SpriteBatch::setVertexFormat(VertexFormat vertexFormat) {
+    _vertexFormat = vertexFormat;
+    // Point the attributes at the new layout
+    createVertexArray();
+}
+
+void SpriteBatch::setDepthBuffer(bool enabled, float nearDepth /* 0.0f */, float farDepth /* 1.0f */) {
+    _depthBuffer = enabled;
+    _nearDepth = nearDepth;
+    _farDepth = farDepth;
+
+    GLStateCache::bindVertexArray(_vao);
+    if (_depthBuffer) {
+        if (_depthVbo == 0) {
+            glGenBuffers(1, &_depthVbo);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, _depthVbo);
+
+        //This is the depth attribute pointer
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat), (void*)0);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    } else {
+        glDisableVertexAttribArray(5);
+    }
+    GLStateCache::bindVertexArray(0);
+}
+
+bool SpriteBatch::isMultiDrawIndirectSupported() {
+    // baseInstance in the commands needs ARB_base_instance, both are core in 4.3
+    return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+bool SpriteBatch::setMultiDrawIndirect(bool enabled) {
+    if (enabled && !isMultiDrawIndirectSupported()) {
+        enabled = false;
+    }
+    if (enabled == _multiDrawIndirect) return enabled;
+    _multiDrawIndirect = enabled;
+
+    GLStateCache::bindVertexArray(_vao);
+    if (_multiDrawIndirect) {
+        if (_indirectBuffer == 0) {
+            glGenBuffers(1, &_indirectBuffer);
+        }
+        if (_drawUnitVbo == 0) {
+            glGenBuffers(1, &_drawUnitVbo);
+
+            // Instance i of a draw reads element baseInstance + i, and every
+            // command draws one instance, so element u just holds u
+            GLint units[MULTI_DRAW_TEXTURE_UNITS];
+            for (GLuint i = 0; i < MULTI_DRAW_TEXTURE_UNITS; i++) {
+                units[i] = (GLint)i;
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, _drawUnitVbo);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(units), units, GL_STATIC_DRAW);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, _drawUnitVbo);
+
+        //This is the texture unit attribute pointer, one value per instance
+        glEnableVertexAttribArray(4);
+        glVertexAttribIPointer(4, 1, GL_INT, sizeof(GLint), (void*)0);
+        glVertexAttribDivisor(4, 1);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    } else {
+        glDisableVertexAttribArray(4);
+    }
+    GLStateCache::bindVertexArray(0);
+
+    return _multiDrawIndirect;
+}
+
+void SpriteBatch::setTextureArrays(const TextureArrayCache* textureArrays) {
+    _textureArrays = textureArrays;
+
+    GLStateCache::bindVertexArray(_vao);
+    if (_textureArrays) {
+        if (_layerVbo == 0) {
+            glGenBuffers(1, &_layerVbo);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, _layerVbo);
+
+        //This is the texture array layer attribute pointer
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat), (void*)0);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    } else {
+        glDisableVertexAttribArray(3);
+    }
+    GLStateCache::bindVertexArray(0);
+}
+
+void SpriteBatch::resolveTextureArrays() {
+    TextureArrayLayer arrayLayer;
+    for (auto& glyph : _glyphs) {
+        if (!_textureArrays->getLayer(glyph.texture, arrayLayer)) {
+            fatalError("Texture " + std::to_string(glyph.texture) + " was not added to the TextureArrayCache!");
+        }
+        if (arrayLayer.arrayID == 0) {
+            fatalError("TextureArrayCache::build() was not called!");
+        }
+        glyph.texture = arrayLayer.arrayID;
+        glyph.layer = arrayLayer.layer;
+    }
+}
+
+bool SpriteBatch::acceptGlyph(const glm::vec4& destRect, bool rotated) {
+    _numSubmittedGlyphs++;
+    if (!_cullGlyphs) return true;
+
+    glm::vec2 minPos(destRect.x, destRect.y);
+    glm::vec2 maxPos(destRect.x + destRect.z, destRect.y + destRect.w);
+    if (rotated) {
+        glm::vec2 center = (minPos + maxPos) * 0.5f;
+        float radius = 0.5f * sqrt(destRect.z * destRect.z + destRect.w * destRect.w);
+        minPos = center - radius;
+        maxPos = center + radius;
+    }
+
+    if (minPos.x < _viewRect.x + _viewRect.z && maxPos.x > _viewRect.x &&
+        minPos.y < _viewRect.y + _viewRect.w && maxPos.y > _viewRect.y) {
+        return true;
+    }
+    _numCulledGlyphs++;
+    return false;
+}
+
+size_t SpriteBatch::cullRotatedChunk(const glm::vec4* destRects, size_t count, unsigned int* visibleIndices) {
+    if (!_cullGlyphs) {
+        for (size_t i = 0; i < count; i++) {
+            visibleIndices[i] = (unsigned int)i;
+        }
+        return count;
+    }
+
+    size_t numVisible = findVisibleRects(destRects, count, _viewRect, true, visibleIndices);
+    _numCulledGlyphs += count - numVisible;
+    return numVisible;
+}
+
+void SpriteBatch::addRotatedGlyphs(const glm::vec4* destRects, const float* cosines, const float* sines, size_t count,
+                                   const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color) {
+    Position corners[ROTATED_CHUNK_SIZE * 4];
+    computeRotatedCorners(destRects, cosines, sines, count, corners);
+
+    // Grow once, then fill the new glyphs in place
+    size_t first = _glyphs.size();
+    _glyphs.resize(first + count);
+    for (size_t i = 0; i < count; i++) {
+        _glyphs[first + i] = Glyph(corners[i], corners[count + i], corners[count * 2 + i], corners[count * 3 + i],
+                                   uvRect, texture, depth, color);
+    }
+}
 
-    glBindVertexArray(0);
+void SpriteBatch::countAllocations() {
+    const size_t capacities[] = {
+        _glyphs.capacity(),
+        _glyphPointers.capacity(),
+        _renderBatches.capacity(),
+        _multiDrawGroups.capacity(),
+        _vertices.capacity(),
+        _packedVertices.capacity(),
+        _layers.capacity(),
+        _depths.capacity(),
+        _indirectCommands.capacity(),
+        _sortEntries.capacity(),
+        _sortScratch.capacity(),
+        _glyphBounds.capacity(),
+        _visibleGlyphs.capacity(),
+        _runFirsts.capacity(),
+        _runCounts.capacity()
+    };
+    static_assert(sizeof(capacities) == sizeof(_capacities), "_capacities must match the containers");
 
+    for (size_t i = 0; i < sizeof(capacities) / sizeof(capacities[0]); i++) {
+        if (capacities[i] != _capacities[i]) {
+            _numAllocations++;
+            _capacities[i] = capacities[i];
+        }
+    }
+}
+
+void SpriteBatch::endStage(double& stageMs) {
+    if (!_profiling) return;
+
+    auto now = std::chrono::high_resolution_clock::now();
+    stageMs += std::chrono::duration<double, std::milli>(now - _stageStart).count();
+    _stageStart = now;
 }
 
 void SpriteBatch::sortGlyphs() {
-   
-    switch (_sortType) {
-        case GlyphSortType::BACK_TO_FRONT:
-            std::stable_sort(_glyphPointers.begin(), _glyphPointers.end(), compareBackToFront);
-            break;
-        case GlyphSortType::FRONT_TO_BACK:
-            std::stable_sort(_glyphPointers.begin(), _glyphPointers.end(), compareFrontToBack);
-            break;
-        case GlyphSortType::TEXTURE:
-            std::stable_sort(_glyphPointers.begin(), _glyphPointers.end(), compareTexture);
-            break;
+    const size_t numGlyphs = _glyphPointers.size();
+    _numOpaqueGlyphs = numGlyphs;
+    if (_depthBuffer) {
+        sortDepthBufferGlyphs();
+        return;
+    }
+    if (_sortType == GlyphSortType::NONE || numGlyphs == 0) return;
+
+    growScratch(_sortEntries, numGlyphs);
+    growScratch(_sortScratch, numGlyphs);
+    for (size_t i = 0; i < numGlyphs; i++) {
+        Glyph* glyph = _glyphPointers[i];
+        GLuint key;
+        switch (_sortType) {
+            case GlyphSortType::FRONT_TO_BACK:
+                key = depthSortKey(glyph->depth);
+                break;
+            case GlyphSortType::BACK_TO_FRONT:
+                key = ~depthSortKey(glyph->depth);
+                break;
+            default:
+                key = glyph->texture;
+                break;
+        }
+        _sortEntries[i].key = key;
+        _sortEntries[i].glyph = glyph;
+    }
+
+    radixSort(_sortEntries.data(), _sortScratch.data(), numGlyphs);
+
+    for (size_t i = 0; i < numGlyphs; i++) {
+        _glyphPointers[i] = _sortEntries[i].glyph;
     }
 }
 
-bool SpriteBatch::compareFrontToBack(Glyph* a, Glyph* b) {
-    return (a->depth < b->depth);
+void SpriteBatch::sortDepthBufferGlyphs() {
+    const size_t numGlyphs = _glyphPointers.size();
+    growScratch(_sortEntries, numGlyphs);
+    growScratch(_sortScratch, numGlyphs);
+
+    // Every corner has the glyph's color, so the top left speaks for all of them
+    size_t numOpaque = 0;
+    for (size_t i = 0; i < numGlyphs; i++) {
+        if (_glyphPointers[i]->topLeft.color.a == 255) numOpaque++;
+    }
+
+    // Opaque glyphs go in front, keyed by their depth buffer value at 16 bits,
+    // which is plenty for front to back. Translucent ones go after them keyed
+    // back to front.
+    size_t opaque = 0;
+    size_t translucent = numOpaque;
+    GLuint maxTexture = 0;
+    for (size_t i = 0; i < numGlyphs; i++) {
+        Glyph* glyph = _glyphPointers[i];
+        if (glyph->topLeft.color.a == 255) {
+            _sortEntries[opaque].key = (GLuint)(getDepthBufferValue(glyph->depth) * 65535.0f + 0.5f);
+            _sortEntries[opaque++].glyph = glyph;
+            maxTexture = std::max(maxTexture, glyph->texture);
+        } else {
+            _sortEntries[translucent].key = ~depthSortKey(glyph->depth);
+            _sortEntries[translucent++].glyph = glyph;
+        }
+    }
+
+    if (maxTexture <= 0xffff) {
+        // Texture names are usually small, so the texture fits in the top half
+        // of the key and one sort does both
+        for (size_t i = 0; i < numOpaque; i++) {
+            _sortEntries[i].key |= _sortEntries[i].glyph->texture << 16;
+        }
+        radixSort(_sortEntries.data(), _sortScratch.data(), numOpaque);
+    } else {
+        // Both sorts are stable, so sorting by texture keeps each texture front to back
+        radixSort(_sortEntries.data(), _sortScratch.data(), numOpaque);
+        for (size_t i = 0; i < numOpaque; i++) {
+            _sortEntries[i].key = _sortEntries[i].glyph->texture;
+        }
+        radixSort(_sortEntries.data(), _sortScratch.data(), numOpaque);
+    }
+    radixSort(_sortEntries.data() + numOpaque, _sortScratch.data() + numOpaque, numGlyphs - numOpaque);
+
+    for (size_t i = 0; i < numGlyphs; i++) {
+        _glyphPointers[i] = _sortEntries[i].glyph;
+    }
+    _numOpaqueGlyphs = numOpaque;
+}
+
+float SpriteBatch::getDepthBufferValue(float depth) const {
+    float value = (depth - _nearDepth) / (_farDepth - _nearDepth);
+    return std::min(std::max(value, 0.0f), 1.0f);
 }
 
-bool SpriteBatch::compareBackToFront(Glyph* a, Glyph* b) {
-    return (a->depth > b->depth);
+GLuint SpriteBatch::depthSortKey(float depth) {
+    // Adding zero turns -0 into +0 so the two compare equal
+    depth += 0.0f;
+    GLuint bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    // Flipping the sign bit of positive floats and every bit of negative ones
+    // makes the bits order like the floats do
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
 }
 
-bool SpriteBatch::compareTexture(Glyph* a, Glyph* b) {
-    return (a->texture < b->texture);
+void SpriteBatch::radixSort(SortEntry* entries, SortEntry* scratch, size_t count) {
+    // Least significant byte first. Each pass is stable, so equal keys stay in
+    // submission order without std::stable_sort's per-call buffer.
+    if (count == 0) return;
+
+    SortEntry* src = entries;
+    SortEntry* dst = scratch;
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t offsets[256] = {};
+        for (size_t i = 0; i < count; i++) {
+            offsets[(src[i].key >> shift) & 0xff]++;
+        }
+        // Skip the pass when every key has the same byte here, which is most
+        // of them for texture IDs
+        if (offsets[(src[0].key >> shift) & 0xff] == count) continue;
+
+        size_t total = 0;
+        for (size_t& offset : offsets) {
+            size_t bucketSize = offset;
+            offset = total;
+            total += bucketSize;
+        }
+        for (size_t i = 0; i < count; i++) {
+            dst[offsets[(src[i].key >> shift) & 0xff]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    if (src != entries) {
+        std::copy(src, src + count, entries);
+    }
 }
 
 }
\ No newline at end of file
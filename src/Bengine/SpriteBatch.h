@@ -2,12 +2,15 @@
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <chrono>
 #include <vector>
 
 #include "Vertex.h"
 
 namespace Bengine{
 
+class TextureArrayCache;
+
 // Determines how we should sort the glyphs
 enum class GlyphSortType {
     NONE,
@@ -16,23 +19,43 @@ enum class GlyphSortType {
     TEXTURE
 };
 
+// The vertex layout SpriteBatch uploads
+enum class VertexFormat {
+    STANDARD, ///< Vertex, 20 bytes
+    PACKED ///< PackedVertex, 12 bytes. Needs the packedShading or packedTextureArrayShading vertex shader.
+};
+
+// Wall time spent in each stage of a SpriteBatch frame, in milliseconds
+struct SpriteBatchTimings {
+    double sort = 0.0; ///< Texture array lookup and sortGlyphs()
+    double vertexBuild = 0.0; ///< RenderBatches, indirect commands and vertex data
+    double upload = 0.0; ///< Buffer uploads
+    double render = 0.0; ///< renderBatch(), CPU side only
+};
+
 // A glyph is a single quad. These are added via SpriteBatch::draw
 class Glyph {
 public:
     Glyph() {};
     Glyph(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint Texture, float Depth, const ColorRGBA8& color);
     Glyph(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint Texture, float Depth, const ColorRGBA8& color, float angle);
+    // rotation is (cos(angle), sin(angle)), so a normalized direction can be passed as is
+    Glyph(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint Texture, float Depth, const ColorRGBA8& color, const glm::vec2& rotation);
+    // Uses corners that are already rotated, see computeRotatedCorners
+    Glyph(const Position& tl, const Position& bl, const Position& br, const Position& tr,
+          const glm::vec4& uvRect, GLuint Texture, float Depth, const ColorRGBA8& color);
 
     GLuint texture;
     float depth;
+    GLuint layer; ///< Texture array layer, only used with SpriteBatch::setTextureArrays
     
     Vertex topLeft;
     Vertex bottomLeft;
     Vertex topRight;
     Vertex bottomRight;
 private:
-    // Rotates a point about (0,0) by angle
-    glm::vec2 rotatePoint(const glm::vec2& pos, float angle);
+    // Rotates a point about (0,0) by the angle whose cosine and sine are in rotation
+    glm::vec2 rotatePoint(const glm::vec2& pos, const glm::vec2& rotation);
 };
 
 // Each render batch is used for a single draw call
@@ -59,6 +82,9 @@ public:
 
     // Begins the spritebatch
     void begin(GlyphSortType sortType = GlyphSortType::TEXTURE);
+    // Begins the spritebatch and drops every glyph that lies outside viewRect
+    // (x, y, width, height in world space, see Camera2D::getViewRect)
+    void begin(const glm::vec4& viewRect, GlyphSortType sortType = GlyphSortType::TEXTURE);
 
     // Ends the spritebatch
     void end();
@@ -70,32 +96,250 @@ public:
     // Adds a glyph to the spritebatch with rotation
     void draw(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color, const glm::vec2& dir);
 
+    // Adds the glyphs drawn into other since its begin(), culled ones already
+    // left out. other doesn't need init(), so it can be filled on another thread
+    // and handed over, see RenderCommandList.
+    void drawGlyphs(const SpriteBatch& other);
+
+    // Adds count glyphs that share a uvRect, texture, depth and color, each rotated
+    // by its angle. Much cheaper than calling draw() count times.
+    void drawRotated(const glm::vec4* destRects, const float* angles, size_t count,
+                     const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color);
+    // Adds count glyphs that share a uvRect, texture, depth and color, each rotated
+    // to face its direction. No trigonometry is needed at all.
+    void drawRotated(const glm::vec4* destRects, const glm::vec2* dirs, size_t count,
+                     const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color);
+
     // Renders the entire SpriteBatch to the screen
     void renderBatch();
+    // Renders only the glyphs that overlap viewRect (x, y, width, height in
+    // world space), reusing what the last end() sorted and uploaded. Call it
+    // once per camera to draw the same glyphs into several views, see
+    // renderViews(). With multi draw indirect nothing is skipped, the viewport
+    // clips the glyphs outside instead.
+    void renderBatch(const glm::vec4& viewRect);
+
+    // Draws through the texture arrays of textureArrays instead of the regular
+    // textures, so batches only break when the array changes. Every texture drawn
+    // must have been added to textureArrays, and the textureArrayShading shaders
+    // must be used. Pass nullptr to go back to regular textures. Call after init().
+    void setTextureArrays(const TextureArrayCache* textureArrays);
+
+    // Switches the vertex layout. PACKED stores positions as half floats relative
+    // to the center of the batch, so keep the batch within a couple of thousand
+    // units of it (a view rect in begin() does that) and UVs within [0, 1].
+    // The origin is set as the batchOrigin uniform of the current program in
+    // renderBatch(). Call after init().
+    void setVertexFormat(VertexFormat vertexFormat);
+
+    // Submits the RenderBatches with glMultiDrawArraysIndirect instead of one draw
+    // call each. The textures of up to MULTI_DRAW_TEXTURE_UNITS batches are bound
+    // to their own units, so a single call covers that many texture switches.
+    // Needs the multiDrawShading or multiDrawTextureArrayShading shaders. Returns
+    // false and keeps the draw loop if the driver lacks GL 4.3 or
+    // ARB_multi_draw_indirect. Call after init().
+    bool setMultiDrawIndirect(bool enabled);
+    static bool isMultiDrawIndirectSupported();
+
+    // Orders glyphs with the depth test instead of the CPU. Each vertex gets its
+    // glyph depth mapped from [nearDepth, farDepth] to [0, 1] on attribute 5,
+    // so the depthShading shaders must be used and the depth buffer cleared
+    // every frame. Glyphs whose color alpha is 255 are opaque: they are sorted
+    // by texture, front to back within a texture for early depth rejection, and
+    // pixels below OPAQUE_ALPHA_CUTOFF are discarded. The rest are drawn
+    // afterwards back to front without writing depth. The sort type given to
+    // begin() is ignored while this is on. Opaque glyphs at the same depth no
+    // longer keep their draw() order: those with different textures are drawn
+    // in texture order, and the later one wins where they overlap. Give them
+    // different depths if the order matters. Call after init().
+    void setDepthBuffer(bool enabled, float nearDepth = 0.0f, float farDepth = 1.0f);
+    bool isDepthBuffer() const { return _depthBuffer; }
+
+    // The alphaCutoff uniform during the opaque pass of the depth buffer mode
+    static const float OPAQUE_ALPHA_CUTOFF;
+
+    // The multiDraw shaders declare a sampler array of this size
+    static const GLuint MULTI_DRAW_TEXTURE_UNITS = 16;
+
+    // Draw calls the last renderBatch() issued
+    size_t getNumDrawCalls() const { return _numDrawCalls; }
+    // Glyphs the last renderBatch() drew
+    size_t getNumRenderedGlyphs() const { return _numRenderedGlyphs; }
+
+    // Measures how long each stage takes, see getTimings(). Off by default,
+    // since reading the clock isn't free.
+    void setProfiling(bool profiling) { _profiling = profiling; }
+    // Timings of the last end() and renderBatch()
+    const SpriteBatchTimings& getTimings() const { return _timings; }
+
+    // Reserves room for numGlyphs glyphs per frame in every buffer the batch
+    // keeps, so the first frames don't have to grow them
+    void reserve(size_t numGlyphs);
+
+    // Times the batch's own storage had to grow since it was created. After
+    // warm-up frames of the same size, this stays the same.
+    size_t getNumAllocations() const { return _numAllocations; }
+
+    // Glyphs the last end() drew in the opaque pass of the depth buffer mode
+    size_t getNumOpaqueGlyphs() const { return _numOpaqueGlyphs; }
+
+    // Bytes of vertex data the last end() uploaded
+    size_t getNumUploadedBytes() const { return _numUploadedBytes; }
+
+    // Glyphs passed to draw() or drawRotated() since begin(), culled ones included
+    size_t getNumSubmittedGlyphs() const { return _numSubmittedGlyphs; }
+    // Glyphs since begin() that were outside the view rect and never added
+    size_t getNumCulledGlyphs() const { return _numCulledGlyphs; }
 
 private:
     // Creates all the needed RenderBatches
     void createRenderBatches();
 
+    // Writes a draw command per RenderBatch and groups them by texture units
+    void createIndirectCommands();
+
+    // Fill the bound VBO with the sorted glyphs in the current vertex format
+    void uploadVertices();
+    void uploadPackedVertices();
+
     // Generates our VAO and VBO
     void createVertexArray();
 
     // Sorts glyphs according to _sortType
     void sortGlyphs();
+    // Puts the opaque glyphs first, sorted by texture and then front to back,
+    // followed by the translucent ones back to front
+    void sortDepthBufferGlyphs();
+
+    // Sets up the state and submits both passes. With visibleOnly only the
+    // glyphs in _visibleGlyphs are drawn.
+    void render(bool visibleOnly);
 
-    // Comparators used by sortGlyphs()
-    static bool compareFrontToBack(Glyph* a, Glyph* b);
-    static bool compareBackToFront(Glyph* a, Glyph* b);
-    static bool compareTexture(Glyph* a, Glyph* b);
+    // Issues the draw calls of the opaque or the translucent RenderBatches, or
+    // of their MultiDrawGroups with multi draw indirect
+    void submitBatches(bool translucent, bool visibleOnly);
+
+    // Draws the runs of consecutive glyphs of each RenderBatch in
+    // [first, last) that are in _visibleGlyphs, one glMultiDrawArrays per batch
+    void submitVisibleRuns(size_t first, size_t last);
+
+    // Fills _glyphBounds from the sorted glyphs, once after each end()
+    void computeGlyphBounds();
+
+    // depth mapped from [_nearDepth, _farDepth] to [0, 1]
+    float getDepthBufferValue(float depth) const;
+
+    // Swaps the texture of each glyph for its texture array and layer
+    void resolveTextureArrays();
+
+    // Adds count glyphs rotated by cosines and sines. count must not be larger
+    // than ROTATED_CHUNK_SIZE.
+    void addRotatedGlyphs(const glm::vec4* destRects, const float* cosines, const float* sines, size_t count,
+                          const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color);
+
+    // Counts the glyph and returns true if it should be added. Rotated glyphs are
+    // tested with their half diagonal, which covers any angle.
+    bool acceptGlyph(const glm::vec4& destRect, bool rotated);
+
+    // Writes the indices of the visible destRects to visibleIndices, counts the
+    // culled ones and returns how many are visible
+    size_t cullRotatedChunk(const glm::vec4* destRects, size_t count, unsigned int* visibleIndices);
+
+    // drawRotated works on this many glyphs at a time, so its scratch space stays in cache
+    static const size_t ROTATED_CHUNK_SIZE = 64;
+
+    // Counts the containers whose capacity changed since the last call
+    void countAllocations();
+
+    // Adds the time since the last stage ended to stageMs when profiling
+    void endStage(double& stageMs);
+
+    // A glyph and the key it is sorted by
+    struct SortEntry {
+        GLuint key;
+        Glyph* glyph;
+    };
+
+    // Maps a depth to a key that sorts the same way as an unsigned int
+    static GLuint depthSortKey(float depth);
+
+    // Stable radix sort of entries by key, with scratch as the second buffer
+    static void radixSort(SortEntry* entries, SortEntry* scratch, size_t count);
 
     GLuint _vbo;
     GLuint _vao;
+    GLuint _layerVbo; ///< One texture array layer per vertex
+    GLuint _drawUnitVbo; ///< The texture unit of each draw command, read through baseInstance
+    GLuint _indirectBuffer;
+    GLuint _depthVbo; ///< One depth buffer value per vertex
+
+    // Layout of a command in the GL_DRAW_INDIRECT_BUFFER
+    struct DrawArraysIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint first;
+        GLuint baseInstance;
+    };
+
+    // The draw commands of one glMultiDrawArraysIndirect call and the textures they use
+    struct MultiDrawGroup {
+        GLuint firstCommand;
+        GLuint numCommands;
+        GLuint numTextures;
+        GLuint textures[MULTI_DRAW_TEXTURE_UNITS];
+    };
+    bool _multiDrawIndirect;
+    std::vector<MultiDrawGroup> _multiDrawGroups;
+    size_t _numDrawCalls;
+    size_t _numRenderedGlyphs;
 
     GlyphSortType _sortType;
+    VertexFormat _vertexFormat;
+    glm::vec2 _batchOrigin; ///< Packed positions are relative to this
+    size_t _numUploadedBytes;
+
+    bool _depthBuffer;
+    float _nearDepth;
+    float _farDepth;
+    size_t _numOpaqueGlyphs; ///< The glyphs in front of this are drawn with depth writes
+    size_t _numOpaqueBatches;
+    size_t _numOpaqueGroups;
+
+    bool _profiling;
+    SpriteBatchTimings _timings;
+    std::chrono::high_resolution_clock::time_point _stageStart;
+
+    bool _cullGlyphs; ///< Only true when begin() got a view rect
+    glm::vec4 _viewRect;
+    size_t _numSubmittedGlyphs;
+    size_t _numCulledGlyphs;
 
     std::vector<Glyph*> _glyphPointers; ///< This is for sorting
     std::vector<Glyph> _glyphs; ///< These are the actual glyphs
     std::vector<RenderBatch> _renderBatches;
+
+    // Staging for the uploads, kept across frames. They only ever grow, so only
+    // the front of each is used.
+    std::vector<Vertex> _vertices;
+    std::vector<PackedVertex> _packedVertices;
+    std::vector<GLfloat> _layers;
+    std::vector<GLfloat> _depths;
+    std::vector<DrawArraysIndirectCommand> _indirectCommands;
+    std::vector<SortEntry> _sortEntries;
+    std::vector<SortEntry> _sortScratch;
+
+    // For renderBatch(viewRect), filled on the first call after end()
+    bool _glyphBoundsValid;
+    std::vector<glm::vec4> _glyphBounds; ///< Bounding rect of each sorted glyph
+    std::vector<unsigned int> _visibleGlyphs; ///< Sorted glyphs in the current view, in order
+    size_t _numVisibleGlyphs; ///< The front of _visibleGlyphs that is valid
+    std::vector<GLint> _runFirsts;
+    std::vector<GLsizei> _runCounts;
+
+    size_t _numAllocations;
+    size_t _capacities[15]; ///< Of every container above, as of the last countAllocations()
+
+    const TextureArrayCache* _textureArrays;
 };
 
 }
\ No newline at end of file
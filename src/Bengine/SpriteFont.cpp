@@ -1,6 +1,7 @@
 #include "SpriteFont.h"
 
 #include "SpriteBatch.h"
+#include "GLStateCache.h"
 
 #include <SDL2/SDL.h>
 
@@ -95,7 +96,7 @@ namespace Bengine {
         }
         // Create the texture
         glGenTextures(1, &_texID);
-        glBindTexture(GL_TEXTURE_2D, _texID);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, _texID);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, bestWidth, bestHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 
         // Now draw all the glyphs
@@ -163,7 +164,7 @@ namespace Bengine {
         _glyphs[_regLength].size = _glyphs[0].size;
         _glyphs[_regLength].uvRect = glm::vec4(0, 0, (float)rs / (float)bestWidth, (float)rs / (float)bestHeight);
 
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
         delete[] glyphRects;
         delete[] bestPartition;
         TTF_CloseFont(f);
@@ -171,6 +172,7 @@ namespace Bengine {
 
     void SpriteFont::dispose() {
         if (_texID != 0) {
+            GLStateCache::forgetTexture(_texID);
             glDeleteTextures(1, &_texID);
             _texID = 0;
         }
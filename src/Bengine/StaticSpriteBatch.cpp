@@ -0,0 +1,152 @@
+#include "StaticSpriteBatch.h"
+#include "GLStateCache.h"
+
+#include <cassert>
+
+namespace Bengine {
+
+StaticSpriteBatch::StaticSpriteBatch() : _vbo(0), _vao(0), _slots(6)
+{
+}
+
+StaticSpriteBatch::~StaticSpriteBatch()
+{
+}
+
+void StaticSpriteBatch::init() {
+    // Generate the VAO if it isn't already generated
+    if (_vao == 0) {
+        glGenVertexArrays(1, &_vao);
+    }
+    GLStateCache::bindVertexArray(_vao);
+
+    // Generate the VBO if it isn't already generated
+    if (_vbo == 0) {
+        glGenBuffers(1, &_vbo);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+
+    // Same attributes as SpriteBatch, so the same shaders can be used
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+
+    GLStateCache::bindVertexArray(0);
+}
+
+void StaticSpriteBatch::dispose() {
+    if (_vao != 0) {
+        GLStateCache::forgetVertexArray(_vao);
+        glDeleteVertexArrays(1, &_vao);
+        _vao = 0;
+    }
+    if (_vbo != 0) {
+        glDeleteBuffers(1, &_vbo);
+        _vbo = 0;
+    }
+}
+
+void StaticSpriteBatch::begin() {
+    _glyphs.clear();
+    _renderBatches.clear();
+    _slots.clear();
+}
+
+int StaticSpriteBatch::draw(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color) {
+    _glyphs.emplace_back(destRect, uvRect, texture, depth, color);
+    return (int)_glyphs.size() - 1;
+}
+
+int StaticSpriteBatch::draw(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color, float angle) {
+    _glyphs.emplace_back(destRect, uvRect, texture, depth, color, angle);
+    return (int)_glyphs.size() - 1;
+}
+
+void StaticSpriteBatch::end() {
+    rebuild();
+}
+
+void StaticSpriteBatch::update(int slot, const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color) {
+    setGlyph(slot, Glyph(destRect, uvRect, texture, depth, color));
+}
+
+void StaticSpriteBatch::update(int slot, const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color, float angle) {
+    setGlyph(slot, Glyph(destRect, uvRect, texture, depth, color, angle));
+}
+
+void StaticSpriteBatch::renderBatch() {
+    if (_slots.needsRebuild()) {
+        rebuild();
+    } else if (_slots.hasDirtyRanges()) {
+        _slots.uploadDirtyRanges(_vbo, _vertices.data(), sizeof(Vertex));
+    }
+
+    GLStateCache::bindVertexArray(_vao);
+
+    for (size_t i = 0; i < _renderBatches.size(); i++) {
+        GLStateCache::bindTexture(GL_TEXTURE_2D, _renderBatches[i].texture);
+
+        glDrawArrays(GL_TRIANGLES, _renderBatches[i].offset, _renderBatches[i].numVertices);
+    }
+}
+
+void StaticSpriteBatch::rebuild() {
+    _renderBatches.clear();
+
+    const std::vector<int>& order = _slots.sortSlots(_glyphs.size(), [this](int slot) {
+        return _glyphs[slot].texture;
+    });
+
+    _vertices.resize(_glyphs.size() * 6);
+
+    for (size_t i = 0; i < order.size(); i++) {
+        const Glyph& glyph = _glyphs[order[i]];
+        GLuint offset = _slots.getOffset(order[i]);
+
+        // Check if this glyph can be part of the current batch
+        if (i == 0 || glyph.texture != _glyphs[order[i - 1]].texture) {
+            _renderBatches.emplace_back(offset, 6, glyph.texture);
+        } else {
+            _renderBatches.back().numVertices += 6;
+        }
+
+        writeVertices(glyph, &_vertices[offset]);
+    }
+
+    // The data rarely changes, so let the driver keep it in video memory
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+    glBufferData(GL_ARRAY_BUFFER, _vertices.size() * sizeof(Vertex), _vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void StaticSpriteBatch::setGlyph(int slot, const Glyph& glyph) {
+    assert(slot >= 0 && slot < getNumSprites());
+    // Only sprites end() placed in the buffer can be updated
+    assert(_slots.getNumSlots() == _glyphs.size());
+
+    // A new texture moves the slot to another RenderBatch
+    if (glyph.texture != _glyphs[slot].texture) {
+        _slots.markNeedsRebuild();
+    }
+    _glyphs[slot] = glyph;
+
+    if (!_slots.needsRebuild()) {
+        writeVertices(glyph, &_vertices[_slots.getOffset(slot)]);
+        _slots.markDirty(slot);
+    }
+}
+
+void StaticSpriteBatch::writeVertices(const Glyph& glyph, Vertex* vertices) {
+    vertices[0] = glyph.topLeft;
+    vertices[1] = glyph.bottomLeft;
+    vertices[2] = glyph.bottomRight;
+    vertices[3] = glyph.bottomRight;
+    vertices[4] = glyph.topRight;
+    vertices[5] = glyph.topLeft;
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "SlotBuffer.h"
+#include "SpriteBatch.h"
+
+namespace Bengine {
+
+// A sprite batch for geometry that rarely moves, such as level tiles. It is built
+// once and then stays resident in a GPU buffer. Single sprites can be changed
+// through the slot draw() returned, and only the dirty ranges of the buffer are
+// uploaded again. It uses the same vertex layout and shaders as SpriteBatch.
+class StaticSpriteBatch
+{
+public:
+    StaticSpriteBatch();
+    ~StaticSpriteBatch();
+
+    // Generates our VAO and VBO
+    void init();
+    void dispose();
+
+    // Begins building the batch. This removes all sprites, so the slots
+    // draw() returned before are no longer valid.
+    void begin();
+
+    // Adds a sprite and returns the slot used to update it later
+    int draw(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color);
+    // Adds a sprite with rotation and returns the slot used to update it later
+    int draw(const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color, float angle);
+
+    // Sorts the sprites by texture and uploads all of them
+    void end();
+
+    // Replaces the sprite in slot, which must come from draw() since the
+    // last begin(), after end(). Changing the texture is allowed, but means
+    // the whole batch is sorted and uploaded again on the next renderBatch().
+    void update(int slot, const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color);
+    void update(int slot, const glm::vec4& destRect, const glm::vec4& uvRect, GLuint texture, float depth, const ColorRGBA8& color, float angle);
+
+    // Uploads the dirty ranges and renders the batch
+    void renderBatch();
+
+    int getNumSprites() const { return (int)_glyphs.size(); }
+
+private:
+    // Sorts the glyphs, builds the RenderBatches and uploads every vertex
+    void rebuild();
+
+    // Replaces a glyph and marks its vertices dirty
+    void setGlyph(int slot, const Glyph& glyph);
+
+    // Writes the 6 vertices of a glyph
+    static void writeVertices(const Glyph& glyph, Vertex* vertices);
+
+    GLuint _vbo;
+    GLuint _vao;
+
+    SlotBuffer _slots; ///< Where each slot's vertices are, and which changed
+
+    std::vector<Glyph> _glyphs; ///< Indexed by slot
+    std::vector<Vertex> _vertices; ///< Copy of the buffer, dirty ranges are uploaded from it
+    std::vector<RenderBatch> _renderBatches;
+};
+
+}
@@ -0,0 +1,118 @@
+#include "TextureArrayCache.h"
+#include "picoPNG.h"
+#include "IOManager.h"
+#include "BengineErrors.h"
+#include "GLStateCache.h"
+
+#include <cstring>
+
+namespace Bengine {
+
+    TextureArrayCache::TextureArrayCache() : _maxLayers(0)
+    {
+    }
+
+    TextureArrayCache::~TextureArrayCache()
+    {
+    }
+
+    void TextureArrayCache::addTexture(const GLTexture& texture) {
+        std::vector<unsigned char> in;
+        std::vector<unsigned char> out;
+        unsigned long width, height;
+
+        //Decode the png again, since the GL texture can't be read back on every platform
+        if (IOManager::readFileToBuffer(texture.filePath, in) == false) {
+            fatalError("Failed to load PNG file " + texture.filePath + " to buffer!");
+        }
+        int errorCode = decodePNG(out, width, height, &(in[0]), in.size());
+        if (errorCode != 0) {
+            fatalError("decodePNG failed with error: " + std::to_string(errorCode));
+        }
+
+        addTexture(texture.id, (int)width, (int)height, &(out[0]));
+    }
+
+    void TextureArrayCache::addTexture(GLuint textureID, int width, int height, const unsigned char* pixels) {
+        // Adding the same texture twice is harmless
+        if (_layers.find(textureID) != _layers.end()) return;
+
+        int index = findArray(width, height);
+        TextureArray& array = _arrays[index];
+
+        const size_t layerSize = (size_t)width * height * 4;
+        array.pixels.resize(layerSize * (array.numLayers + 1));
+        std::memcpy(&(array.pixels[layerSize * array.numLayers]), pixels, layerSize);
+
+        _layers[textureID] = std::make_pair(index, (GLuint)array.numLayers);
+        array.numLayers++;
+    }
+
+    void TextureArrayCache::build() {
+        for (auto& array : _arrays) {
+            if (array.id != 0) continue;
+
+            glGenTextures(1, &(array.id));
+            GLStateCache::bindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+
+            //Upload every layer at once
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, array.width, array.height, array.numLayers, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, &(array.pixels[0]));
+
+            //Same parameters as ImageLoader::loadPNG
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+            GLStateCache::bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+            //The pixels live on the GPU now, so free the staging memory
+            std::vector<unsigned char>().swap(array.pixels);
+        }
+    }
+
+    bool TextureArrayCache::getLayer(GLuint textureID, TextureArrayLayer& rvLayer) const {
+        auto it = _layers.find(textureID);
+        if (it == _layers.end()) return false;
+
+        rvLayer.arrayID = _arrays[it->second.first].id;
+        rvLayer.layer = it->second.second;
+        return true;
+    }
+
+    void TextureArrayCache::dispose() {
+        for (auto& array : _arrays) {
+            if (array.id != 0) {
+                GLStateCache::forgetTexture(array.id);
+                glDeleteTextures(1, &(array.id));
+            }
+        }
+        _arrays.clear();
+        _layers.clear();
+    }
+
+    int TextureArrayCache::findArray(int width, int height) {
+        if (_maxLayers == 0) {
+            glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &_maxLayers);
+        }
+
+        for (size_t i = 0; i < _arrays.size(); i++) {
+            const TextureArray& array = _arrays[i];
+            if (array.id == 0 && array.width == width && array.height == height && array.numLayers < _maxLayers) {
+                return (int)i;
+            }
+        }
+
+        //No room in an existing array, so start a new one
+        _arrays.emplace_back();
+        TextureArray& array = _arrays.back();
+        array.width = width;
+        array.height = height;
+        array.numLayers = 0;
+        array.id = 0;
+        return (int)_arrays.size() - 1;
+    }
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <GL/glew.h>
+#include <unordered_map>
+#include <vector>
+
+#include "GLTexture.h"
+
+namespace Bengine {
+
+    // Where a texture ended up after being packed into a texture array
+    struct TextureArrayLayer {
+        GLuint arrayID;
+        GLuint layer;
+    };
+
+    // Packs textures of the same size into the layers of GL_TEXTURE_2D_ARRAYs, so
+    // that a SpriteBatch can draw sprites with different textures in one call.
+    // Textures are queued with addTexture() and uploaded together by build().
+    class TextureArrayCache
+    {
+    public:
+        TextureArrayCache();
+        ~TextureArrayCache();
+
+        // Queues a texture that was loaded by the ResourceManager. The pixels
+        // are decoded again from texture.filePath.
+        void addTexture(const GLTexture& texture);
+        // Queues width * height RGBA8 pixels for the texture textureID
+        void addTexture(GLuint textureID, int width, int height, const unsigned char* pixels);
+
+        // Uploads every queued texture to its array. Textures queued after a build
+        // go into new arrays, so build() can be called again at any time.
+        void build();
+
+        // Looks up the array and layer of a texture. Returns false if the texture
+        // was never added.
+        bool getLayer(GLuint textureID, TextureArrayLayer& rvLayer) const;
+
+        int getNumArrays() const { return (int)_arrays.size(); }
+        GLuint getArrayID(int index) const { return _arrays[index].id; }
+
+        void dispose();
+
+    private:
+        struct TextureArray {
+            int width;
+            int height;
+            int numLayers;
+            GLuint id; ///< 0 until build() uploads it
+            std::vector<unsigned char> pixels; ///< Pixels of all layers waiting for build()
+        };
+
+        // Returns the index of an unbuilt array of the given size with a free layer
+        int findArray(int width, int height);
+
+        std::vector<TextureArray> _arrays;
+        std::unordered_map<GLuint, std::pair<int, GLuint>> _layers; ///< Texture ID -> (array index, layer)
+        GLint _maxLayers;
+    };
+
+}
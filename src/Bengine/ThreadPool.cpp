@@ -0,0 +1,99 @@
+#include "ThreadPool.h"
+
+namespace Bengine {
+
+    ThreadPool::ThreadPool() : m_nextJob(0) {
+        // Empty
+    }
+
+    ThreadPool::~ThreadPool() {
+        dispose();
+    }
+
+    void ThreadPool::init(unsigned int numThreads /* 0 */) {
+        if (!m_threads.empty()) return;
+
+        if (numThreads == 0) {
+            unsigned int hardwareThreads = std::thread::hardware_concurrency();
+            numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+        }
+
+        m_quit = false;
+        m_numWorking = 0;
+        for (unsigned int i = 0; i < numThreads; i++) {
+            m_threads.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    void ThreadPool::dispose() {
+        if (m_threads.empty()) return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_condition.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+        m_threads.clear();
+    }
+
+    void ThreadPool::parallelFor(size_t numJobs, const std::function<void(size_t)>& job) {
+        // Waking the workers costs more than a single job saves
+        if (m_threads.empty() || numJobs <= 1) {
+            for (size_t i = 0; i < numJobs; i++) {
+                job(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job = &job;
+            m_numJobs = numJobs;
+            m_nextJob = 0;
+            m_numWorking = (unsigned int)m_threads.size();
+            m_generation++;
+        }
+        m_condition.notify_all();
+
+        runJobs();
+
+        // The jobs are all taken, but workers may still be running theirs
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCondition.wait(lock, [this]() { return m_numWorking == 0; });
+        m_job = nullptr;
+    }
+
+    void ThreadPool::workerLoop() {
+        unsigned int generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this, generation]() { return m_generation != generation || m_quit; });
+                if (m_quit) break;
+                generation = m_generation;
+            }
+
+            runJobs();
+
+            bool last;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                last = --m_numWorking == 0;
+            }
+            if (last) {
+                m_doneCondition.notify_one();
+            }
+        }
+    }
+
+    void ThreadPool::runJobs() {
+        size_t i;
+        while ((i = m_nextJob.fetch_add(1)) < m_numJobs) {
+            (*m_job)(i);
+        }
+    }
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Bengine {
+
+    // Worker threads that split a loop between them. parallelFor() hands out
+    // the jobs one at a time, so jobs that take longer don't hold the others up.
+    class ThreadPool {
+    public:
+        ThreadPool();
+        ~ThreadPool();
+
+        // Starts numThreads workers. 0 starts one less than the hardware has,
+        // since the thread calling parallelFor() works too.
+        void init(unsigned int numThreads = 0);
+        // Waits for the workers to finish and stops them
+        void dispose();
+
+        // Calls job(i) for every i in [0, numJobs), on the workers and the
+        // calling thread, and returns once all of them are done. Must only be
+        // called from one thread at a time, and not from inside a job.
+        void parallelFor(size_t numJobs, const std::function<void(size_t)>& job);
+
+        // Worker threads, not counting the one calling parallelFor()
+        unsigned int getNumThreads() const { return (unsigned int)m_threads.size(); }
+
+    private:
+        void workerLoop();
+        // Takes jobs until there are none left
+        void runJobs();
+
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_condition; ///< Wakes the workers for a new parallelFor()
+        std::condition_variable m_doneCondition; ///< Wakes parallelFor() when the last worker is done
+
+        const std::function<void(size_t)>* m_job = nullptr;
+        size_t m_numJobs = 0;
+        std::atomic<size_t> m_nextJob;
+        unsigned int m_generation = 0; ///< Counts the parallelFor() calls, so workers can tell a new one
+        unsigned int m_numWorking = 0; ///< Workers that haven't finished the current parallelFor()
+        bool m_quit = false;
+    };
+
+}
@@ -56,4 +56,13 @@ namespace Bengine {
         }
     };
 
+    //A 12 byte vertex, used by SpriteBatch with VertexFormat::PACKED.
+    //The position is a pair of half floats relative to the batch origin and
+    //the UVs are normalized 16 bit integers, so they must lie in [0, 1].
+    struct PackedVertex {
+        GLushort position[2];
+        ColorRGBA8 color;
+        GLushort uv[2];
+    };
+
 }
\ No newline at end of file
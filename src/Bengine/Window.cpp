@@ -1,15 +1,21 @@
 #include "Window.h"
 #include "BengineErrors.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 
 namespace Bengine {
 
-    Window::Window()
+    Window::Window() : _sdlWindow(nullptr), _glContext(nullptr), _framebuffer(0), _colorRenderbuffer(0), _depthRenderbuffer(0)
     {
     }
 
 
     Window::~Window()
     {
+        deleteOffscreenTarget();
     }
 
     int Window::create(std::string windowName, int screenWidth, int screenHeight, unsigned int currentFlags) {
@@ -18,7 +24,7 @@ namespace Bengine {
         _screenWidth = screenWidth;
         _screenHeight = screenHeight;
 
-        if (currentFlags & INVISIBLE) {
+        if (currentFlags & (INVISIBLE | HEADLESS)) {
             flags |= SDL_WINDOW_HIDDEN;
         }
         if (currentFlags & FULLSCREEN) {
@@ -40,8 +46,8 @@ namespace Bengine {
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
     
         //Set up our OpenGL context
-        SDL_GLContext glContext = SDL_GL_CreateContext(_sdlWindow);
-        if (glContext == nullptr) {
+        _glContext = SDL_GL_CreateContext(_sdlWindow);
+        if (_glContext == nullptr) {
             fatalError("SDL_GL context could not be created!");
         }
 
@@ -54,6 +60,11 @@ namespace Bengine {
         //Check the OpenGL version
         std::printf("***   OpenGL Version: %s   ***\n", glGetString(GL_VERSION));
 
+        //Hidden windows may not have a default framebuffer to draw to
+        if (currentFlags & HEADLESS) {
+            createOffscreenTarget();
+        }
+
         //Set the background color to blue
         glClearColor(0.0f, 0.0f, 1.0f, 1.0f);
 
@@ -61,14 +72,124 @@ namespace Bengine {
         SDL_GL_SetSwapInterval(0);
 
         // Enable alpha blend
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GLStateCache::setBlendEnabled(true);
+        GLStateCache::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
         return 0;
     }
 
     void Window::swapBuffer() {
+        if (_framebuffer != 0) {
+            glFlush();
+            return;
+        }
         SDL_GL_SwapWindow(_sdlWindow);
     }
 
+    void Window::makeCurrent() {
+        if (SDL_GL_MakeCurrent(_sdlWindow, _glContext) != 0) {
+            fatalError("Could not make the GL context current!");
+        }
+    }
+
+    void Window::releaseCurrent() {
+        SDL_GL_MakeCurrent(_sdlWindow, nullptr);
+    }
+
+    void Window::readFrame(std::vector<GLubyte>& rvPixels) {
+        const size_t rowSize = (size_t)_screenWidth * 4;
+        rvPixels.resize(rowSize * _screenHeight);
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        if (_framebuffer == 0) {
+            glReadBuffer(GL_BACK);
+        }
+        glReadPixels(0, 0, _screenWidth, _screenHeight, GL_RGBA, GL_UNSIGNED_BYTE, rvPixels.data());
+
+        //OpenGL reads bottom row first, flip so the top comes first
+        std::vector<GLubyte> row(rowSize);
+        for (int y = 0; y < _screenHeight / 2; y++) {
+            GLubyte* top = &rvPixels[y * rowSize];
+            GLubyte* bottom = &rvPixels[(_screenHeight - 1 - y) * rowSize];
+            std::copy(top, top + rowSize, row.begin());
+            std::copy(bottom, bottom + rowSize, top);
+            std::copy(row.begin(), row.end(), bottom);
+        }
+    }
+
+    bool Window::saveFrame(const std::string& filePath) {
+        std::vector<GLubyte> pixels;
+        readFrame(pixels);
+
+        FILE* file = std::fopen(filePath.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+
+        //PPM has no alpha, so drop it
+        std::fprintf(file, "P6\n%d %d\n255\n", _screenWidth, _screenHeight);
+        std::vector<GLubyte> rgb(pixels.size() / 4 * 3);
+        for (size_t i = 0, j = 0; i < pixels.size(); i += 4, j += 3) {
+            rgb[j] = pixels[i];
+            rgb[j + 1] = pixels[i + 1];
+            rgb[j + 2] = pixels[i + 2];
+        }
+        bool success = std::fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+        std::fclose(file);
+        return success;
+    }
+
+    size_t Window::compareFrames(const std::vector<GLubyte>& a, const std::vector<GLubyte>& b, int tolerance) {
+        if (a.size() != b.size()) {
+            return std::max(a.size(), b.size()) / 4;
+        }
+
+        size_t numDifferent = 0;
+        for (size_t i = 0; i < a.size(); i += 4) {
+            for (size_t c = 0; c < 4; c++) {
+                if (std::abs((int)a[i + c] - (int)b[i + c]) > tolerance) {
+                    numDifferent++;
+                    break;
+                }
+            }
+        }
+        return numDifferent;
+    }
+
+    void Window::createOffscreenTarget() {
+        glGenFramebuffers(1, &_framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+
+        glGenRenderbuffers(1, &_colorRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, _colorRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, _screenWidth, _screenHeight);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorRenderbuffer);
+
+        glGenRenderbuffers(1, &_depthRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, _depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, _screenWidth, _screenHeight);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthRenderbuffer);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            fatalError("Offscreen framebuffer could not be created!");
+        }
+
+        //It stays bound, so everything draws into it
+        glViewport(0, 0, _screenWidth, _screenHeight);
+    }
+
+    void Window::deleteOffscreenTarget() {
+        if (_framebuffer == 0) return;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &_framebuffer);
+        glDeleteRenderbuffers(1, &_colorRenderbuffer);
+        glDeleteRenderbuffers(1, &_depthRenderbuffer);
+        _framebuffer = 0;
+        _colorRenderbuffer = 0;
+        _depthRenderbuffer = 0;
+    }
+
 }
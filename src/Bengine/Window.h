@@ -2,10 +2,15 @@
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #include <string>
+#include <vector>
 
 namespace Bengine {
 
-    enum WindowFlags { INVISIBLE = 0x1, FULLSCREEN = 0x2, BORDERLESS = 0x4 };
+    // HEADLESS hides the window and renders into an offscreen framebuffer of the
+    // window's size, which is deleted with the Window. On machines without a display, run with
+    // SDL_VIDEODRIVER=offscreen (and LIBGL_ALWAYS_SOFTWARE=1 for Mesa's llvmpipe
+    // when there is no GPU either).
+    enum WindowFlags { INVISIBLE = 0x1, FULLSCREEN = 0x2, BORDERLESS = 0x4, HEADLESS = 0x8 };
 
     class Window
     {
@@ -15,13 +20,41 @@ namespace Bengine {
 
         int create(std::string windowName, int screenWidth, int screenHeight, unsigned int currentFlags);
 
+        // Shows the frame. Headless windows have nothing to show, so this only flushes.
         void swapBuffer();
 
+        // Reads the current frame back as RGBA8, top row first
+        void readFrame(std::vector<GLubyte>& rvPixels);
+        // Writes the current frame to a binary PPM file. Returns false if it can't be written.
+        bool saveFrame(const std::string& filePath);
+
+        // Counts the pixels of two frames that differ by more than tolerance in any
+        // channel, for golden image checks. Frames of different size differ everywhere.
+        static size_t compareFrames(const std::vector<GLubyte>& a, const std::vector<GLubyte>& b, int tolerance = 0);
+
+        // Makes the window's GL context current on the calling thread. A context
+        // can only be current on one thread, so release it on the other first.
+        void makeCurrent();
+        void releaseCurrent();
+
         int getScreenWidth() { return _screenWidth; }
         int getScreenHeight() { return _screenHeight; }
+        bool isHeadless() const { return _framebuffer != 0; }
+        // The framebuffer frames are drawn to, 0 unless headless
+        GLuint getFramebuffer() const { return _framebuffer; }
     private:
+        // Creates the framebuffer a headless window draws to and binds it
+        void createOffscreenTarget();
+        // Deletes it again, if there is one. The window's GL context has to
+        // be current.
+        void deleteOffscreenTarget();
+
         SDL_Window* _sdlWindow;
+        SDL_GLContext _glContext;
         int _screenWidth, _screenHeight;
+        GLuint _framebuffer;
+        GLuint _colorRenderbuffer;
+        GLuint _depthRenderbuffer;
     };
 
 }
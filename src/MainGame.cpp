@@ -5,6 +5,9 @@
 #include <iostream>
 #include <string>
 
+//Uniform name hashes, computed at compile time
+constexpr GLuint SAMPLER_UNIFORM = Bengine::GLSLProgram::hashUniformName("mySampler");
+
 //Constructor, just initializes private member variables
 MainGame::MainGame() : 
     _screenWidth(1024),
@@ -39,6 +42,7 @@ void MainGame::initSystems() {
 
     initShaders();
 
+    _frameUniforms.init();
     _spriteBatch.init();
     _fpsLimiter.init(_maxFPS);
 }
@@ -161,20 +165,17 @@ void MainGame::drawGame() {
     //Enable the shader
     _colorProgram.use();
 
-    //We are using texture unit 0
-    glActiveTexture(GL_TEXTURE0);
-    //Get the uniform location
-    GLint textureLocation = _colorProgram.getUniformLocation("mySampler");
-    //Tell the shader that the texture is in texture unit 0
+    //Get the uniform location. It was looked up when the shader was linked.
+    GLint textureLocation = _colorProgram.getUniformLocation(SAMPLER_UNIFORM);
+    //Tell the shader that the texture is in texture unit 0, where the sprite batch binds it
     glUniform1i(textureLocation, 0);
 
-    //Set the camera matrix
-    GLint pLocation = _colorProgram.getUniformLocation("P");
+    //Set the camera matrix and time for every shader at once
     glm::mat4 cameraMatrix = _camera.getCameraMatrix();
+    _frameUniforms.update(cameraMatrix, glm::vec4(0.0f, 0.0f, _screenWidth, _screenHeight), _time);
 
-    glUniformMatrix4fv(pLocation, 1, GL_FALSE, &(cameraMatrix[0][0]));
-
-    _spriteBatch.begin();
+    //Bullets that fly off screen are culled by the sprite batch
+    _spriteBatch.begin(_camera.getViewRect());
 
     glm::vec4 pos(0.0f, 0.0f, 50.0f, 50.0f);
     glm::vec4 uv(0.0f, 0.0f, 1.0f, 1.0f);
@@ -195,10 +196,8 @@ void MainGame::drawGame() {
 
     _spriteBatch.renderBatch();
 
-    //unbind the texture
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    //disable the shader
+    //disable the shader. The texture and the program stay bound, so the state
+    //cache can skip binding them again next frame.
     _colorProgram.unuse();
 
     //Swap our buffer and draw everything to the screen!
@@ -5,6 +5,7 @@
 
 #include <Bengine/Bengine.h>
 #include <Bengine/GLSLProgram.h>
+#include <Bengine/FrameUniforms.h>
 #include <Bengine/GLTexture.h>
 #include <Bengine/Sprite.h>
 #include <Bengine/Window.h>
@@ -43,6 +44,7 @@ private:
     GameState _gameState;
 
     Bengine::GLSLProgram _colorProgram;
+    Bengine::FrameUniforms _frameUniforms;
     Bengine::Camera2D _camera;
 
     Bengine::SpriteBatch _spriteBatch;